@@ -82,7 +82,7 @@ void transmitter() {
   String msg = "Hello DW1000, it's #"; msg += sentNum;
   DW1000.setData(msg);
   // delay sending the message for the given amount
-  DW1000Time deltaTime = DW1000Time(10, DW1000Time::MILLISECONDS);
+  DW1000Time deltaTime = DW1000Time(10, DW1000Time::TimeUnit::MILLISECONDS);
   DW1000.setDelay(deltaTime);
   DW1000.startTransmit();
   delaySent = millis();
@@ -136,7 +136,7 @@ void transmitPollAck() {
     DW1000.setDefaults();
     data[0] = POLL_ACK;
     // delay the same amount as ranging tag
-    DW1000Time deltaTime = DW1000Time(replyDelayTimeUS, DW1000Time::MICROSECONDS);
+    DW1000Time deltaTime = DW1000Time(replyDelayTimeUS, DW1000Time::TimeUnit::MICROSECONDS);
     DW1000.setDelay(deltaTime);
     DW1000.setData(data, LEN_DATA);
     DW1000.startTransmit();
@@ -36,9 +36,9 @@ void loop() {
   // unit test
   Serial.println(F("simple test for + - "));
   Serial.print(F("Time1 is   (0)[us] ... ")); Serial.println(time1.getAsMicroSeconds(), 4);
-  time1 += DW1000Time(10, DW1000Time::MICROSECONDS);
+  time1 += DW1000Time(10, DW1000Time::TimeUnit::MICROSECONDS);
   Serial.print(F("Time1 is  (10)[us] ... ")); Serial.println(time1.getAsMicroSeconds(), 4);
-  time1 -= DW1000Time(500, DW1000Time::NANOSECONDS);
+  time1 -= DW1000Time(500, DW1000Time::TimeUnit::NANOSECONDS);
   Serial.print(F("Time1 is (9.5)[us] ... ")); Serial.println(time1.getAsMicroSeconds(), 4);
   Serial.println();
   
@@ -46,7 +46,7 @@ void loop() {
   time2 = time1;
   time2 += DW1000Time(10.0f);
   Serial.print(F("Time2 == Time1  (NO)... ")); Serial.println(time1 == time2 ? "YES" : "NO");
-  time1 += DW1000Time(10000, DW1000Time::NANOSECONDS);
+  time1 += DW1000Time(10000, DW1000Time::TimeUnit::NANOSECONDS);
   Serial.print(F("Time2 == Time1 (YES)... ")); Serial.println(time1 == time2 ? "YES" : "NO");
   Serial.println();
   
@@ -57,7 +57,7 @@ void loop() {
   Serial.print(F("Time2 is             (512) ... ")); Serial.println(time2);
   Serial.print(F("Time2 is      (0.0080)[us] ... ")); Serial.println(time2.getAsMicroSeconds(), 4);
   Serial.print(F("Time2 range is (2.4022)[m] ... ")); Serial.println(time2.getAsMeters(), 4);
-  time3 = DW1000Time(10, DW1000Time::SECONDS);
+  time3 = DW1000Time(10, DW1000Time::TimeUnit::SECONDS);
   time3.getTimestamp(stamp);
   time3.setTimestamp(stamp);
   Serial.print(F("Time3 is (10)[s]           ... ")); Serial.println(time3.getAsMicroSeconds() * 1.0e-6, 4);
@@ -37,6 +37,7 @@ void (*DW1000Class::_handleReceived)(void) = 0;
 void (*DW1000Class::_handleReceiveFailed)(void) = 0;
 void (*DW1000Class::_handleReceiveTimeout)(void) = 0;
 void (*DW1000Class::_handleReceiveTimestampAvailable)(void) = 0;
+uint32_t DW1000Class::_interruptMicros = 0;
 
 // registers
 byte DW1000Class::_syscfg[LEN_SYS_CFG];
@@ -106,6 +107,61 @@ const SPISettings DW1000Class::_fastSPI = SPISettings(16000000L, MSBFIRST, SPI_M
 #endif
 const SPISettings DW1000Class::_slowSPI = SPISettings(2000000L, MSBFIRST, SPI_MODE0);
 const SPISettings *DW1000Class::_currentSPI = &_fastSPI;
+DW1000SpiTransport DW1000Class::_spiTransport;
+DW1000Transport *DW1000Class::_transport = &_spiTransport;
+
+// configuration registers the chip only changes on reset, shadowed in _cache
+struct CachedRegister
+{
+	byte reg;
+	uint16_t offset;
+	uint8_t length;
+};
+
+static constexpr CachedRegister CACHED_REGISTERS[] = {
+	{PANADR, 0, LEN_PANADR},
+	{SYS_CFG, 0, LEN_SYS_CFG},
+	{SYS_MASK, 0, LEN_SYS_MASK},
+	{TX_FCTRL, 0, LEN_TX_FCTRL},
+	{CHAN_CTRL, 0, LEN_CHAN_CTRL},
+	{TX_ANTD, 0, LEN_TX_ANTD},
+	{LDE_IF, LDE_RXANTD_SUB, LEN_LDE_RXANTD},
+	{AGC_TUNE, AGC_TUNE1_SUB, LEN_AGC_TUNE1},
+	{AGC_TUNE, AGC_TUNE2_SUB, LEN_AGC_TUNE2},
+	{AGC_TUNE, AGC_TUNE3_SUB, LEN_AGC_TUNE3},
+	{DRX_TUNE, DRX_TUNE0b_SUB, LEN_DRX_TUNE0b},
+	{DRX_TUNE, DRX_TUNE1a_SUB, LEN_DRX_TUNE1a},
+	{DRX_TUNE, DRX_TUNE1b_SUB, LEN_DRX_TUNE1b},
+	{DRX_TUNE, DRX_TUNE2_SUB, LEN_DRX_TUNE2},
+	{DRX_TUNE, DRX_TUNE4H_SUB, LEN_DRX_TUNE4H},
+	{LDE_IF, LDE_CFG1_SUB, LEN_LDE_CFG1},
+	{LDE_IF, LDE_CFG2_SUB, LEN_LDE_CFG2},
+	{LDE_IF, LDE_REPC_SUB, LEN_LDE_REPC},
+	{TX_POWER, 0, LEN_TX_POWER},
+	{RF_CONF, RF_RXCTRLH_SUB, LEN_RF_RXCTRLH},
+	{RF_CONF, RF_TXCTRL_SUB, LEN_RF_TXCTRL},
+	{TX_CAL, TC_PGDELAY_SUB, LEN_TC_PGDELAY},
+	{FS_CTRL, FS_PLLTUNE_SUB, LEN_FS_PLLTUNE},
+	{FS_CTRL, FS_PLLCFG_SUB, LEN_FS_PLLCFG},
+	{FS_CTRL, FS_XTALT_SUB, LEN_FS_XTALT},
+};
+#define CACHED_REGISTER_COUNT (sizeof(CACHED_REGISTERS) / sizeof(CACHED_REGISTERS[0]))
+
+// sum of the lengths from entry i on
+static constexpr uint16_t cachedLength(uint8_t i)
+{
+	return i < CACHED_REGISTER_COUNT ? CACHED_REGISTERS[i].length + cachedLength(i + 1) : 0;
+}
+#define LEN_CACHE cachedLength(0)
+
+static_assert(CACHED_REGISTER_COUNT <= 32, "_cacheValid has one bit per cached register");
+
+static byte _cache[LEN_CACHE];
+
+boolean DW1000Class::_registerCache = true;
+uint32_t DW1000Class::_cacheValid = 0; // one bit per cached register
+uint32_t DW1000Class::_savedTransactions = 0;
+uint32_t DW1000Class::_savedBytes = 0;
 
 /* ###########################################################################
  * #### Init and end #######################################################
@@ -113,6 +169,7 @@ const SPISettings *DW1000Class::_currentSPI = &_fastSPI;
 
 void DW1000Class::end()
 {
+	_transport->flush();
 	SPI.end();
 }
 
@@ -188,6 +245,8 @@ void DW1000Class::begin(uint8_t irq, uint8_t rst)
 
 void DW1000Class::manageLDE()
 {
+	// loading the LDE microcode runs with the chip's own defaults
+	invalidateRegisterCache();
 	// transfer any ldo tune values
 	byte ldoTune[LEN_OTP_RDAT];
 	readBytesOTP(0x04, ldoTune); // TODO #define
@@ -312,6 +371,8 @@ void DW1000Class::deepSleep()
 
 void DW1000Class::spiWakeup()
 {
+	// configuration is restored from AON (or lost), reread before trusting the cache
+	invalidateRegisterCache();
 	digitalWrite(_ss, LOW);
 	delay(2);
 	digitalWrite(_ss, HIGH);
@@ -323,6 +384,7 @@ void DW1000Class::spiWakeup()
 
 void DW1000Class::reset()
 {
+	invalidateRegisterCache();
 	if (_rst == 0xff)
 	{
 		softReset();
@@ -342,6 +404,7 @@ void DW1000Class::reset()
 
 void DW1000Class::softReset()
 {
+	invalidateRegisterCache();
 	byte pmscctrl0[LEN_PMSC_CTRL0];
 	readBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, LEN_PMSC_CTRL0);
 	pmscctrl0[0] = 0x01;
@@ -971,56 +1034,105 @@ void DW1000Class::tune()
  * #### Interrupt handling ###################################################
  * ######################################################################### */
 
+// passes over the events of one interrupt, frames arriving back to back
+// must not keep the CPU in the handler
+#define INTERRUPT_PASSES 4
+
 void DW1000Class::handleInterrupt()
 {
+	byte handled[LEN_SYS_STATUS];
+	uint8_t passes = 0;
 	// read current status and handle via callbacks
+	_interruptMicros = micros();
 	readSystemEventStatusRegister();
-	if (isClockProblem() /* TODO and others */ && _handleError != 0)
-	{
-		(*_handleError)();
-	}
-	if (isTransmitDone() && _handleSent != 0)
-	{
-		(*_handleSent)();
-		clearTransmitStatus();
-	}
-	if (isReceiveTimestampAvailable() && _handleReceiveTimestampAvailable != 0)
-	{
-		(*_handleReceiveTimestampAvailable)();
-		clearReceiveTimestampAvailableStatus();
-	}
-	if (isReceiveFailed() && _handleReceiveFailed != 0)
+	do
 	{
-		(*_handleReceiveFailed)();
-		clearReceiveStatus();
-		if (_permanentReceive)
+		memcpy(handled, _sysstatus, LEN_SYS_STATUS);
+		// double buffered, the receiver goes on with the other buffer
+		boolean handBack = isDoubleBuffered() && isReceiveDone();
+		if (isClockProblem() /* TODO and others */ && _handleError != 0)
 		{
-			newReceive();
-			startReceive();
+			(*_handleError)();
 		}
-	}
-	else if (isReceiveTimeout() && _handleReceiveTimeout != 0)
-	{
-		(*_handleReceiveTimeout)();
-		clearReceiveStatus();
-		if (_permanentReceive)
+		if (isTransmitDone() && _handleSent != 0)
+		{
+			(*_handleSent)();
+		}
+		if (isReceiveTimestampAvailable() && _handleReceiveTimestampAvailable != 0)
+		{
+			(*_handleReceiveTimestampAvailable)();
+		}
+		if (isReceiveFailed() && _handleReceiveFailed != 0)
+		{
+			(*_handleReceiveFailed)();
+			// with auto re-enable the receiver is listening again already
+			if (_permanentReceive && !getBit(_syscfg, LEN_SYS_CFG, RXAUTR_BIT))
+			{
+				rearmReceiver();
+			}
+		}
+		else if (isReceiveTimeout() && _handleReceiveTimeout != 0)
+		{
+			(*_handleReceiveTimeout)();
+			if (_permanentReceive)
+			{
+				rearmReceiver();
+			}
+		}
+		else if (isReceiveDone() && _handleReceived != 0)
 		{
-			newReceive();
-			startReceive();
+			(*_handleReceived)();
+			if (_permanentReceive && !handBack)
+			{
+				rearmReceiver();
+			}
 		}
+		// clear what was handled (write 1 to clear) but not the events of a
+		// frame received since the receiver was re-enabled, these keep the IRQ
+		// line up and are handled in the next pass
+		writeBytes(SYS_STATUS, NO_SUB, handled, LEN_SYS_STATUS);
+		if (handBack)
+		{
+			// after clearing its events, the other buffer's events show up now
+			toggleHostBuffer();
+		}
+		_interruptMicros = micros();
+		readSystemEventStatusRegister();
+	} while (++passes < INTERRUPT_PASSES && isInterruptPending());
+	if (isInterruptPending())
+	{
+		// the IRQ line is still up and gives no edge, drop it for a moment
+		// so the rest is handled in the next interrupt
+		byte none[LEN_SYS_MASK] = {0};
+		writeBytes(SYS_MASK, NO_SUB, none, LEN_SYS_MASK);
+		writeSystemEventMaskRegister();
 	}
-	else if (isReceiveDone() && _handleReceived != 0)
+}
+
+/*
+ * Fast re-arm of the receiver in permanent receive mode: after a good frame
+ * (or a failure without auto re-enable) the receiver is off already, so a
+ * single RXENAB is enough, without the TRXOFF and status clearing of
+ * newReceive(). The receiver configuration stays as it is.
+ */
+void DW1000Class::rearmReceiver()
+{
+	memset(_sysctrl, 0, LEN_SYS_CTRL);
+	_deviceMode = RX_MODE;
+	startReceive();
+}
+
+/* Unmasked events in the status read last, the IRQ line is up. */
+boolean DW1000Class::isInterruptPending()
+{
+	for (uint8_t i = 0; i < LEN_SYS_MASK; i++)
 	{
-		(*_handleReceived)();
-		clearReceiveStatus();
-		if (_permanentReceive)
+		if (_sysstatus[i] & _sysmask[i])
 		{
-			newReceive();
-			startReceive();
+			return true;
 		}
 	}
-	// clear all status that is left unhandled
-	clearAllStatus();
+	return false;
 }
 
 /* ###########################################################################
@@ -1315,6 +1427,31 @@ void DW1000Class::setDoubleBuffering(boolean val)
 	setBit(_syscfg, LEN_SYS_CFG, DIS_DRXB_BIT, !val);
 }
 
+boolean DW1000Class::isDoubleBuffered()
+{
+	return !getBit(_syscfg, LEN_SYS_CFG, DIS_DRXB_BIT);
+}
+
+/* Host side buffer handled, the chip may receive into it again and the host
+ * sees the other buffer set (and its RX events) from now on. */
+void DW1000Class::toggleHostBuffer()
+{
+	byte toggle = (1 << (HRBPT_BIT - 24));
+	writeBytesAsync(SYS_CTRL, 3, &toggle, 1);
+}
+
+/* After TRXOFF the host and chip side buffer pointers may differ (a frame
+ * was not handed back yet), align them so both start on the same buffer. */
+void DW1000Class::syncReceiveBuffers()
+{
+	byte status;
+	readBytes(SYS_STATUS, 3, &status, 1);
+	if (((status >> (HSRBP_BIT - 24)) & 0x01) != ((status >> (ICRBP_BIT - 24)) & 0x01))
+	{
+		toggleHostBuffer();
+	}
+}
+
 void DW1000Class::setInterruptPolarity(boolean val)
 {
 	setBit(_syscfg, LEN_SYS_CFG, HIRQ_POL_BIT, val);
@@ -1386,6 +1523,10 @@ void DW1000Class::idle()
 void DW1000Class::newReceive()
 {
 	idle();
+	if (isDoubleBuffered())
+	{
+		syncReceiveBuffers();
+	}
 	memset(_sysctrl, 0, LEN_SYS_CTRL);
 	clearReceiveStatus();
 	_deviceMode = RX_MODE;
@@ -1395,7 +1536,7 @@ void DW1000Class::startReceive()
 {
 	setBit(_sysctrl, LEN_SYS_CTRL, SFCST_BIT, !_frameCheck);
 	setBit(_sysctrl, LEN_SYS_CTRL, RXENAB_BIT, true);
-	writeBytes(SYS_CTRL, NO_SUB, _sysctrl, LEN_SYS_CTRL);
+	writeBytesAsync(SYS_CTRL, NO_SUB, _sysctrl, LEN_SYS_CTRL);
 }
 
 void DW1000Class::newTransmit()
@@ -1408,10 +1549,11 @@ void DW1000Class::newTransmit()
 
 void DW1000Class::startTransmit()
 {
-	writeTransmitFrameControlRegister();
+	// queued behind the frame data of setData()
+	writeBytesAsync(TX_FCTRL, NO_SUB, _txfctrl, LEN_TX_FCTRL);
 	setBit(_sysctrl, LEN_SYS_CTRL, SFCST_BIT, !_frameCheck);
 	setBit(_sysctrl, LEN_SYS_CTRL, TXSTRT_BIT, true);
-	writeBytes(SYS_CTRL, NO_SUB, _sysctrl, LEN_SYS_CTRL);
+	writeBytesAsync(SYS_CTRL, NO_SUB, _sysctrl, LEN_SYS_CTRL);
 	if (_permanentReceive)
 	{
 		memset(_sysctrl, 0, LEN_SYS_CTRL);
@@ -1567,6 +1709,56 @@ byte DW1000Class::getPulseFrequency()
 	return _pulseFrequency;
 }
 
+uint32_t DW1000Class::getFrameAirtime(uint16_t n, uint32_t *shrMicroseconds)
+{
+	// DW1000 user manual 3.4: preamble and SFD symbols, then PHR and data
+	// bits, 48 Reed-Solomon parity bits per 330 data bits (times in ps)
+	uint64_t symbolPs = _pulseFrequency == TX_PULSE_FREQ_64MHZ ? 1017630 : 993590;
+	uint32_t preamble;
+	switch (_preambleLength)
+	{
+	case TX_PREAMBLE_LEN_64:
+		preamble = 64;
+		break;
+	case TX_PREAMBLE_LEN_128:
+		preamble = 128;
+		break;
+	case TX_PREAMBLE_LEN_256:
+		preamble = 256;
+		break;
+	case TX_PREAMBLE_LEN_512:
+		preamble = 512;
+		break;
+	case TX_PREAMBLE_LEN_1024:
+		preamble = 1024;
+		break;
+	case TX_PREAMBLE_LEN_1536:
+		preamble = 1536;
+		break;
+	case TX_PREAMBLE_LEN_2048:
+		preamble = 2048;
+		break;
+	default:
+		preamble = 4096;
+		break;
+	}
+	uint32_t sfd       = _dataRate == TRX_RATE_110KBPS ? 64 : (_dataRate == TRX_RATE_850KBPS ? 16 : 8);
+	uint64_t phrBitPs  = _dataRate == TRX_RATE_110KBPS ? 8205130 : 1025640;
+	uint64_t dataBitPs = _dataRate == TRX_RATE_110KBPS ? 8205130 : (_dataRate == TRX_RATE_850KBPS ? 1025640 : 128210);
+	if (_frameCheck)
+	{
+		n += 2; // two bytes CRC-16
+	}
+	uint32_t bits = (uint32_t)n * 8;
+	bits += (bits + 329) / 330 * 48;
+	uint64_t shrPs = (preamble + sfd) * symbolPs;
+	if (shrMicroseconds != nullptr)
+	{
+		*shrMicroseconds = (uint32_t)((shrPs + 999999) / 1000000);
+	}
+	return (uint32_t)((shrPs + 21 * phrBitPs + bits * dataBitPs + 999999) / 1000000);
+}
+
 void DW1000Class::setPreambleLength(byte prealen)
 {
 	prealen &= 0x0F;
@@ -1731,8 +1923,8 @@ void DW1000Class::setData(byte data[], uint16_t n)
 	{
 		return; // TODO proper error handling: frame/buffer size
 	}
-	// transmit data and length
-	writeBytes(TX_BUFFER, NO_SUB, data, n);
+	// transmit data and length, the CPU can go on while the frame is clocked out
+	writeBytesAsync(TX_BUFFER, NO_SUB, data, n);
 	_txfctrl[0] = (byte)(n & 0xFF); // 1 byte (regular length + 1 bit)
 	_txfctrl[1] &= 0xE0;
 	_txfctrl[1] |= (byte)((n >> 8) & 0x03); // 2 added bits if extended length
@@ -1816,13 +2008,22 @@ void DW1000Class::getReceiveTimestamp(DW1000Time &time)
 	correctTimestamp(time);
 }
 
-// TODO check function, different type violations between byte and int
 void DW1000Class::correctTimestamp(DW1000Time &timestamp)
 {
-	// base line dBm, which is -61, 2 dBm steps, total 18 data points (down to -95 dBm)
-	float rxPowerBase = -(getReceivePower() + 61.0f) * 0.5f;
-	int16_t rxPowerBaseLow = (int16_t)rxPowerBase; // TODO check type
-	int16_t rxPowerBaseHigh = rxPowerBaseLow + 1;  // TODO check type
+	DW1000RxDiagnostics diagnostics;
+	readBytes(RX_FQUAL, CIR_PWR_SUB, diagnostics.rxFrameQuality+CIR_PWR_SUB, LEN_CIR_PWR);
+	readBytes(RX_FINFO, NO_SUB, diagnostics.rxFrameInfo, LEN_RX_FINFO);
+	correctTimestamp(timestamp, getReceivePowerCentiDbm(diagnostics));
+}
+
+// TODO check function, different type violations between byte and int
+void DW1000Class::correctTimestamp(DW1000Time &timestamp, int16_t rxPowerCentiDbm)
+{
+	// base line dBm, which is -61, 2 dBm steps, total 18 data points (down to -95 dBm),
+	// in 1/200 of a step
+	int32_t rxPowerBase = -((int32_t)rxPowerCentiDbm + 6100);
+	int16_t rxPowerBaseLow = (int16_t)(rxPowerBase / 200);
+	int16_t rxPowerBaseHigh = rxPowerBaseLow + 1;
 	if (rxPowerBaseLow <= 0)
 	{
 		rxPowerBaseLow = 0;
@@ -1878,11 +2079,11 @@ void DW1000Class::correctTimestamp(DW1000Time &timestamp)
 			return;
 		}
 	}
-	// linear interpolation of bias values
-	float rangeBias = rangeBiasLow + (rxPowerBase - rxPowerBaseLow) * (rangeBiasHigh - rangeBiasLow);
-	// range bias [mm] to timestamp modification value conversion
+	// linear interpolation of bias values, in 1/200 mm
+	int32_t rangeBias = (int32_t)rangeBiasLow * 200 + (rxPowerBase - rxPowerBaseLow * 200) * (rangeBiasHigh - rangeBiasLow);
+	// range bias [mm] to timestamp modification value conversion, truncated
 	DW1000Time adjustmentTime;
-	adjustmentTime.setTimestamp((int16_t)(rangeBias * DW1000Time::DISTANCE_OF_RADIO_INV * 0.001f));
+	adjustmentTime.setTimestamp((int64_t)rangeBias * DW1000Time::MM_PER_TICK_DEN / (DW1000Time::MM_PER_TICK_NUM * 200));
 	// apply correction
 	timestamp -= adjustmentTime;
 }
@@ -1996,95 +2197,242 @@ void DW1000Class::clearTransmitStatus()
 	writeBytes(SYS_STATUS, NO_SUB, _sysstatus, LEN_SYS_STATUS);
 }
 
+// the getters below read only what they need, adjacent fields in one burst;
+// for more than one value of the same frame readRxDiagnostics() is cheaper
 float DW1000Class::getReceiveQuality()
 {
-	byte noiseBytes[LEN_STD_NOISE];
-	byte fpAmpl2Bytes[LEN_FP_AMPL2];
+	DW1000RxDiagnostics diagnostics;
+	// STD_NOISE and FP_AMPL2
+	readBytes(RX_FQUAL, NO_SUB, diagnostics.rxFrameQuality, LEN_STD_NOISE + LEN_FP_AMPL2);
+	return getReceiveQuality(diagnostics);
+}
+
+float DW1000Class::getFirstPathPower()
+{
+	DW1000RxDiagnostics diagnostics;
+	readBytes(RX_TIME, FP_AMPL1_SUB, diagnostics.rxTime+FP_AMPL1_SUB, LEN_FP_AMPL1);
+	// FP_AMPL2 and FP_AMPL3
+	readBytes(RX_FQUAL, FP_AMPL2_SUB, diagnostics.rxFrameQuality+FP_AMPL2_SUB, LEN_FP_AMPL2 + LEN_FP_AMPL3);
+	readBytes(RX_FINFO, NO_SUB, diagnostics.rxFrameInfo, LEN_RX_FINFO);
+	return getFirstPathPower(diagnostics);
+}
+
+float DW1000Class::getReceivePower()
+{
+	DW1000RxDiagnostics diagnostics;
+	readBytes(RX_FQUAL, CIR_PWR_SUB, diagnostics.rxFrameQuality+CIR_PWR_SUB, LEN_CIR_PWR);
+	readBytes(RX_FINFO, NO_SUB, diagnostics.rxFrameInfo, LEN_RX_FINFO);
+	return getReceivePower(diagnostics);
+}
+
+void DW1000Class::readRxDiagnostics(DW1000RxDiagnostics &diagnostics)
+{
+	// one read per register file (a transaction cannot span two of them),
+	// each from offset 0 with the short header
+	readBytes(RX_FINFO, NO_SUB, diagnostics.rxFrameInfo, LEN_RX_FINFO);
+	readBytes(RX_TIME, NO_SUB, diagnostics.rxTime, LEN_RX_TIME_DIAG);
+	readBytes(RX_FQUAL, NO_SUB, diagnostics.rxFrameQuality, LEN_RX_FQUAL);
+}
+
+uint16_t DW1000Class::getDataLength(const DW1000RxDiagnostics &diagnostics)
+{
+	uint16_t len = ((((uint16_t)diagnostics.rxFrameInfo[1] << 8) | (uint16_t)diagnostics.rxFrameInfo[0]) & 0x03FF);
+	if (_frameCheck && len > 2)
+	{
+		return len - 2;
+	}
+	return len;
+}
+
+void DW1000Class::getReceiveTimestamp(const DW1000RxDiagnostics &diagnostics, DW1000Time &time)
+{
+	time.setTimestamp(diagnostics.rxTime + RX_STAMP_SUB);
+	// correct timestamp (i.e. consider range bias)
+	correctTimestamp(time, getReceivePowerCentiDbm(diagnostics));
+}
+
+int32_t DW1000Class::readCarrierIntegrator()
+{
+	byte carrierInt[LEN_DRX_CAR_INT];
+	readBytes(DRX_TUNE, DRX_CAR_INT_SUB, carrierInt, LEN_DRX_CAR_INT);
+	uint32_t value = ((uint32_t)carrierInt[0] | ((uint32_t)carrierInt[1] << 8) | ((uint32_t)(carrierInt[2] & 0x1F) << 16));
+	// sign extend the 21 bit value
+	if (value & 0x100000)
+	{
+		value |= 0xFFE00000;
+	}
+	return (int32_t)value;
+}
+
+int64_t DW1000Class::toLocalClock(int64_t remoteDuration, int32_t carrierIntegrator)
+{
+	// user manual 7.2.40.11: offset [Hz] = carrierInt * 998.4MHz/2/1024/131072
+	// (/8192 instead of /1024 at 110 kb/s), relative to the carrier frequency,
+	// which is 499.2MHz * 7, 8, 9 or 13 for the channel. The remote clock runs
+	// slower by carrierInt/(k*2^27) (2^30 at 110 kb/s) of a tick per tick
+	int64_t k;
+	switch (_channel)
+	{
+	case CHANNEL_1:
+		k = 7;
+		break;
+	case CHANNEL_3:
+		k = 9;
+		break;
+	case CHANNEL_5:
+	case CHANNEL_7:
+		k = 13;
+		break;
+	default:
+		k = 8;
+		break;
+	}
+	uint8_t shift = (_dataRate == TRX_RATE_110KBPS ? 30 : 27);
+	int64_t product = remoteDuration * carrierIntegrator;
+	int64_t divisor = k << shift;
+	// rounded to the nearest tick
+	return remoteDuration + (product + (product < 0 ? -divisor / 2 : divisor / 2)) / divisor;
+}
+
+float DW1000Class::getReceiveQuality(const DW1000RxDiagnostics &diagnostics)
+{
+	const byte *noiseBytes = diagnostics.rxFrameQuality + STD_NOISE_SUB;
+	const byte *fpAmpl2Bytes = diagnostics.rxFrameQuality + FP_AMPL2_SUB;
 	uint16_t noise, f2;
-	readBytes(RX_FQUAL, STD_NOISE_SUB, noiseBytes, LEN_STD_NOISE);
-	readBytes(RX_FQUAL, FP_AMPL2_SUB, fpAmpl2Bytes, LEN_FP_AMPL2);
 	noise = (uint16_t)noiseBytes[0] | ((uint16_t)noiseBytes[1] << 8);
 	f2 = (uint16_t)fpAmpl2Bytes[0] | ((uint16_t)fpAmpl2Bytes[1] << 8);
 	return (float)f2 / noise;
 }
 
-float DW1000Class::getFirstPathPower()
+float DW1000Class::getFirstPathPower(const DW1000RxDiagnostics &diagnostics)
 {
-	byte fpAmpl1Bytes[LEN_FP_AMPL1];
-	byte fpAmpl2Bytes[LEN_FP_AMPL2];
-	byte fpAmpl3Bytes[LEN_FP_AMPL3];
-	byte rxFrameInfo[LEN_RX_FINFO];
+	return getFirstPathPowerCentiDbm(diagnostics) / 100.0f;
+}
+
+float DW1000Class::getReceivePower(const DW1000RxDiagnostics &diagnostics)
+{
+	return getReceivePowerCentiDbm(diagnostics) / 100.0f;
+}
+
+int16_t DW1000Class::getReceiveQualityPercent(const DW1000RxDiagnostics &diagnostics)
+{
+	const byte *noiseBytes = diagnostics.rxFrameQuality + STD_NOISE_SUB;
+	const byte *fpAmpl2Bytes = diagnostics.rxFrameQuality + FP_AMPL2_SUB;
+	uint16_t noise, f2;
+	noise = (uint16_t)noiseBytes[0] | ((uint16_t)noiseBytes[1] << 8);
+	f2 = (uint16_t)fpAmpl2Bytes[0] | ((uint16_t)fpAmpl2Bytes[1] << 8);
+	if (noise == 0)
+	{
+		return INT16_MAX;
+	}
+	// rounded
+	uint32_t quality = ((uint32_t)f2 * 100 + noise / 2) / noise;
+	return quality > INT16_MAX ? INT16_MAX : (int16_t)quality;
+}
+
+int16_t DW1000Class::getFirstPathPowerCentiDbm(const DW1000RxDiagnostics &diagnostics)
+{
+	const byte *fpAmpl1Bytes = diagnostics.rxTime + FP_AMPL1_SUB;
+	const byte *fpAmpl2Bytes = diagnostics.rxFrameQuality + FP_AMPL2_SUB;
+	const byte *fpAmpl3Bytes = diagnostics.rxFrameQuality + FP_AMPL3_SUB;
+	const byte *rxFrameInfo = diagnostics.rxFrameInfo;
 	uint16_t f1, f2, f3, N;
-	float A, corrFac;
-	readBytes(RX_TIME, FP_AMPL1_SUB, fpAmpl1Bytes, LEN_FP_AMPL1);
-	readBytes(RX_FQUAL, FP_AMPL2_SUB, fpAmpl2Bytes, LEN_FP_AMPL2);
-	readBytes(RX_FQUAL, FP_AMPL3_SUB, fpAmpl3Bytes, LEN_FP_AMPL3);
-	readBytes(RX_FINFO, NO_SUB, rxFrameInfo, LEN_RX_FINFO);
+	int32_t A, corrFac;
 	f1 = (uint16_t)fpAmpl1Bytes[0] | ((uint16_t)fpAmpl1Bytes[1] << 8);
 	f2 = (uint16_t)fpAmpl2Bytes[0] | ((uint16_t)fpAmpl2Bytes[1] << 8);
 	f3 = (uint16_t)fpAmpl3Bytes[0] | ((uint16_t)fpAmpl3Bytes[1] << 8);
 	N = (((uint16_t)rxFrameInfo[2] >> 4) & 0xFF) | ((uint16_t)rxFrameInfo[3] << 4);
+	// 1/100 dBm, corrFac in 1/10000
 	if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
 	{
-		A = 113.77;
-		corrFac = 2.3334;
+		A = 11377;
+		corrFac = 23334;
 	}
 	else
 	{
-		A = 121.74;
-		corrFac = 1.1667;
+		A = 12174;
+		corrFac = 11667;
 	}
-	float estFpPwr = 10.0 * log10(((float)f1 * (float)f1 + (float)f2 * (float)f2 + (float)f3 * (float)f3) / ((float)N * (float)N)) - A;
-	if (estFpPwr <= -88)
+	uint64_t amplitudes = (uint64_t)f1 * f1 + (uint64_t)f2 * f2 + (uint64_t)f3 * f3;
+	if (amplitudes == 0 || N == 0)
 	{
-		return estFpPwr;
+		return INT16_MIN;
 	}
-	else
+	int32_t estFpPwr = centiDecibels(amplitudes) - centiDecibels((uint64_t)N * N) - A;
+	if (estFpPwr > -8800)
 	{
 		// approximation of Fig. 22 in user manual for dbm correction
-		estFpPwr += (estFpPwr + 88) * corrFac;
+		estFpPwr += (estFpPwr + 8800) * corrFac / 10000;
 	}
-	return estFpPwr;
+	return estFpPwr < INT16_MIN ? INT16_MIN : (estFpPwr > INT16_MAX ? INT16_MAX : (int16_t)estFpPwr);
 }
 
-float DW1000Class::getReceivePower()
+int16_t DW1000Class::getReceivePowerCentiDbm(const DW1000RxDiagnostics &diagnostics)
 {
-	byte cirPwrBytes[LEN_CIR_PWR];
-	byte rxFrameInfo[LEN_RX_FINFO];
-	uint32_t twoPower17 = 131072;
+	const byte *cirPwrBytes = diagnostics.rxFrameQuality + CIR_PWR_SUB;
+	const byte *rxFrameInfo = diagnostics.rxFrameInfo;
 	uint16_t C, N;
-	float A, corrFac;
-	readBytes(RX_FQUAL, CIR_PWR_SUB, cirPwrBytes, LEN_CIR_PWR);
-	readBytes(RX_FINFO, NO_SUB, rxFrameInfo, LEN_RX_FINFO);
+	int32_t A, corrFac;
 	C = (uint16_t)cirPwrBytes[0] | ((uint16_t)cirPwrBytes[1] << 8);
 	N = (((uint16_t)rxFrameInfo[2] >> 4) & 0xFF) | ((uint16_t)rxFrameInfo[3] << 4);
+	// 1/100 dBm, corrFac in 1/10000
 	if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
 	{
-		A = 113.77;
-		corrFac = 2.3334;
+		A = 11377;
+		corrFac = 23334;
 	}
 	else
 	{
-		A = 121.74;
-		corrFac = 1.1667;
+		A = 12174;
+		corrFac = 11667;
 	}
-	float estRxPwr = 10.0 * log10(((float)C * (float)twoPower17) / ((float)N * (float)N)) - A;
-	if (estRxPwr <= -88)
+	if (C == 0 || N == 0)
 	{
-		return estRxPwr;
+		return INT16_MIN;
 	}
-	else
+	// C * 2^17 / N^2
+	int32_t estRxPwr = centiDecibels((uint64_t)C << 17) - centiDecibels((uint64_t)N * N) - A;
+	if (estRxPwr > -8800)
 	{
 		// approximation of Fig. 22 in user manual for dbm correction
-		estRxPwr += (estRxPwr + 88) * corrFac;
+		estRxPwr += (estRxPwr + 8800) * corrFac / 10000;
 	}
-	return estRxPwr;
+	return estRxPwr < INT16_MIN ? INT16_MIN : (estRxPwr > INT16_MAX ? INT16_MAX : (int16_t)estRxPwr);
 }
 
 /* ###########################################################################
  * #### Helper functions #####################################################
  * ######################################################################### */
 
+// log2(value) in 16 bit fixed point: the integer part is the highest set
+// bit, each fraction bit comes from squaring the mantissa (1 <= m < 2, Q30)
+// once. 10*log10(2) = 3.0103 dB per octave
+int32_t DW1000Class::centiDecibels(uint64_t value)
+{
+	if (value == 0)
+	{
+		return INT32_MIN;
+	}
+	uint8_t msb = 63;
+	while (!(value >> msb))
+	{
+		msb--;
+	}
+	uint64_t mantissa = msb >= 30 ? value >> (msb - 30) : value << (30 - msb);
+	int64_t log2 = (int64_t)msb << 16;
+	for (uint32_t bit = 1UL << 15; bit != 0; bit >>= 1)
+	{
+		mantissa = (mantissa * mantissa) >> 30;
+		if (mantissa >= (2ULL << 30))
+		{
+			mantissa >>= 1;
+			log2 |= bit;
+		}
+	}
+	// rounded
+	return (int32_t)((log2 * 30103 + (100LL << 16) / 2) / (100LL << 16));
+}
+
 /*
  * Set the value of a bit in an array of bytes that are considered
  * consecutive and stored from MSB to LSB.
@@ -2167,42 +2515,9 @@ void DW1000Class::writeValueToBytes(byte data[], int32_t val, uint16_t n)
 void DW1000Class::readBytes(byte cmd, uint16_t offset, byte data[], uint16_t n)
 {
 	byte header[3];
-	uint8_t headerLen = 1;
-	uint16_t i = 0;
-
-	// build SPI header
-	if (offset == NO_SUB)
-	{
-		header[0] = READ | cmd;
-	}
-	else
-	{
-		header[0] = READ_SUB | cmd;
-		if (offset < 128)
-		{
-			header[1] = (byte)offset;
-			headerLen++;
-		}
-		else
-		{
-			header[1] = RW_SUB_EXT | (byte)offset;
-			header[2] = (byte)(offset >> 7);
-			headerLen += 2;
-		}
-	}
-	SPI.beginTransaction(*_currentSPI);
-	digitalWrite(_ss, LOW);
-	for (i = 0; i < headerLen; i++)
-	{
-		SPI.transfer(header[i]); // send header
-	}
-	for (i = 0; i < n; i++)
-	{
-		data[i] = SPI.transfer(JUNK); // read values
-	}
-	delayMicroseconds(5);
-	digitalWrite(_ss, HIGH);
-	SPI.endTransaction();
+	uint8_t headerLen = buildHeader(header, cmd, offset, false);
+	_transport->transfer(*_currentSPI, _ss, header, headerLen, data, n, false);
+	refreshCache(cmd, offset, data, n);
 }
 
 // always 4 bytes
@@ -2249,18 +2564,46 @@ void DW1000Class::writeByte(byte cmd, uint16_t offset, byte data)
 void DW1000Class::writeBytes(byte cmd, uint16_t offset, byte data[], uint16_t data_size)
 {
 	byte header[3];
-	uint8_t headerLen = 1;
-	uint16_t i = 0;
-
+	const byte *bytes = data;
+	if (!filterCachedWrite(cmd, offset, bytes, data_size))
+	{
+		return;
+	}
 	// TODO proper error handling: address out of bounds
-	// build SPI header
+	uint8_t headerLen = buildHeader(header, cmd, offset, true);
+	_transport->transfer(*_currentSPI, _ss, header, headerLen, (byte *)bytes, data_size, true);
+}
+
+/*
+ * Same as writeBytes(), but the transport may still be clocking the data out
+ * on return (see DW1000Transport::queueWrite()). The data is copied, the next
+ * register access waits for the write.
+ */
+void DW1000Class::writeBytesAsync(byte cmd, uint16_t offset, const byte data[], uint16_t data_size)
+{
+	byte header[3];
+	if (!filterCachedWrite(cmd, offset, data, data_size))
+	{
+		return;
+	}
+	uint8_t headerLen = buildHeader(header, cmd, offset, true);
+	_transport->queueWrite(*_currentSPI, _ss, header, headerLen, data, data_size);
+}
+
+/*
+ * Build the SPI header of a register access.
+ * @return the header length (1-3 bytes)
+ */
+uint8_t DW1000Class::buildHeader(byte header[], byte cmd, uint16_t offset, boolean write)
+{
+	uint8_t headerLen = 1;
 	if (offset == NO_SUB)
 	{
-		header[0] = WRITE | cmd;
+		header[0] = (write ? WRITE : READ) | cmd;
 	}
 	else
 	{
-		header[0] = WRITE_SUB | cmd;
+		header[0] = (write ? WRITE_SUB : READ_SUB) | cmd;
 		if (offset < 128)
 		{
 			header[1] = (byte)offset;
@@ -2273,19 +2616,139 @@ void DW1000Class::writeBytes(byte cmd, uint16_t offset, byte data[], uint16_t da
 			headerLen += 2;
 		}
 	}
-	SPI.beginTransaction(*_currentSPI);
-	digitalWrite(_ss, LOW);
-	for (i = 0; i < headerLen; i++)
+	return headerLen;
+}
+
+/*
+ * Register cache: narrow a write to a cached register down to the bytes which
+ * differ from the shadow (the dirty bytes) and update the shadow.
+ * @return false if nothing is left to write
+ */
+boolean DW1000Class::filterCachedWrite(byte cmd, uint16_t &offset, const byte *&data, uint16_t &n)
+{
+	if (!_registerCache)
 	{
-		SPI.transfer(header[i]); // send header
+		return true;
+	}
+	uint16_t start = (offset == NO_SUB ? 0 : offset);
+	byte *shadow = _cache;
+	for (uint8_t i = 0; i < CACHED_REGISTER_COUNT; shadow += CACHED_REGISTERS[i].length, i++)
+	{
+		const CachedRegister &cached = CACHED_REGISTERS[i];
+		if (cached.reg != cmd || start >= cached.offset + cached.length || start + n <= cached.offset)
+		{
+			continue;
+		}
+		if (start < cached.offset || start + n > cached.offset + cached.length)
+		{
+			// spans more than this register, the shadow is stale from now on
+			_cacheValid &= ~(1UL << i);
+			continue;
+		}
+		byte *bytes = shadow + (start - cached.offset);
+		uint16_t first = 0;
+		uint16_t last = n;
+		if (_cacheValid & (1UL << i))
+		{
+			while (first < n && bytes[first] == data[first])
+			{
+				first++;
+			}
+			while (last > first && bytes[last - 1] == data[last - 1])
+			{
+				last--;
+			}
+		}
+		memcpy(bytes, data, n);
+		if (start == cached.offset && n == cached.length)
+		{
+			_cacheValid |= (1UL << i);
+		}
+		uint16_t bytesBefore = headerLength(offset) + n;
+		if (first == last)
+		{
+			_savedTransactions++;
+			_savedBytes += bytesBefore;
+			return false;
+		}
+		start += first;
+		offset = (start == 0 ? NO_SUB : start);
+		data += first;
+		n = last - first;
+		_savedBytes += bytesBefore - (headerLength(offset) + n);
+		return true;
 	}
-	for (i = 0; i < data_size; i++)
+	return true;
+}
+
+/* Register cache: bytes of the header buildHeader() makes for offset. */
+uint8_t DW1000Class::headerLength(uint16_t offset)
+{
+	if (offset == NO_SUB)
 	{
-		SPI.transfer(data[i]); // write values
+		return 1;
 	}
-	delayMicroseconds(5);
-	digitalWrite(_ss, HIGH);
-	SPI.endTransaction();
+	return (offset < 128 ? 2 : 3);
+}
+
+/* Register cache: a whole cached register read from the chip becomes its shadow. */
+void DW1000Class::refreshCache(byte cmd, uint16_t offset, const byte data[], uint16_t n)
+{
+	uint16_t start = (offset == NO_SUB ? 0 : offset);
+	byte *shadow = _cache;
+	for (uint8_t i = 0; i < CACHED_REGISTER_COUNT; shadow += CACHED_REGISTERS[i].length, i++)
+	{
+		const CachedRegister &cached = CACHED_REGISTERS[i];
+		if (cached.reg == cmd && start == cached.offset && n == cached.length)
+		{
+			memcpy(shadow, data, n);
+			_cacheValid |= (1UL << i);
+			return;
+		}
+	}
+}
+
+void DW1000Class::useRegisterCache(boolean val)
+{
+	_registerCache = val;
+	invalidateRegisterCache();
+}
+
+void DW1000Class::invalidateRegisterCache()
+{
+	_cacheValid = 0;
+}
+
+uint32_t DW1000Class::getSavedSpiTransactions()
+{
+	return _savedTransactions;
+}
+
+uint32_t DW1000Class::getSavedSpiBytes()
+{
+	return _savedBytes;
+}
+
+void DW1000Class::resetRegisterCacheStats()
+{
+	_savedTransactions = 0;
+	_savedBytes = 0;
+}
+
+void DW1000Class::setTransport(DW1000Transport *transport)
+{
+	_transport->flush();
+	_transport = transport != nullptr ? transport : &_spiTransport;
+}
+
+boolean DW1000Class::isTransportBusy()
+{
+	return _transport->busy();
+}
+
+void DW1000Class::flushTransport()
+{
+	_transport->flush();
 }
 
 void DW1000Class::getPrettyBytes(byte data[], char msgBuffer[], uint16_t n)
@@ -35,6 +35,14 @@
 #include <SPI.h>
 #include "DW1000Constants.h"
 #include "DW1000Time.h"
+#include "DW1000Transport.h"
+
+/* RX registers describing one received frame, see readRxDiagnostics(). */
+struct DW1000RxDiagnostics {
+	byte rxFrameInfo[LEN_RX_FINFO];     // RX_FINFO: length, preamble accumulation count
+	byte rxTime[LEN_RX_TIME_DIAG];      // RX_TIME: timestamp, first path index and amplitude 1
+	byte rxFrameQuality[LEN_RX_FQUAL];  // RX_FQUAL: noise, first path amplitude 2/3, CIR power
+};
 
 class DW1000Class {
 public:
@@ -235,6 +243,15 @@ public:
 	*/
 	static void setPulseFrequency(byte freq);
 	static byte getPulseFrequency();
+	/**
+	Time a frame of the current mode (data rate, PRF and preamble length) is on the air.
+
+	@param[in] n The number of bytes as handed to `setData()`, the CRC is added.
+	@param[out] shrMicroseconds If not `nullptr`, the preamble and SFD part of it, the time
+		a delayed transmission starts before its timestamp.
+	@return The airtime in microseconds, rounded up.
+	*/
+	static uint32_t getFrameAirtime(uint16_t n, uint32_t* shrMicroseconds = nullptr);
 	static void setPreambleLength(byte prealen);
 	static void setChannel(byte channel);
 	static void setPreambleCode(byte preacode);
@@ -260,6 +277,27 @@ public:
 	static float getFirstPathPower();
 	static float getReceiveQuality();
 	
+	/* the same for one frame from registers captured right after it was
+	received, valid however much later they are evaluated. */
+	static void     readRxDiagnostics(DW1000RxDiagnostics& diagnostics);
+	static uint16_t getDataLength(const DW1000RxDiagnostics& diagnostics);
+	static void     getReceiveTimestamp(const DW1000RxDiagnostics& diagnostics, DW1000Time& time);
+	static float    getReceivePower(const DW1000RxDiagnostics& diagnostics);
+	static float    getFirstPathPower(const DW1000RxDiagnostics& diagnostics);
+	static float    getReceiveQuality(const DW1000RxDiagnostics& diagnostics);
+	/* the same in 1/100 dBm (quality in 1/100), integer only. */
+	static int16_t  getReceivePowerCentiDbm(const DW1000RxDiagnostics& diagnostics);
+	static int16_t  getFirstPathPowerCentiDbm(const DW1000RxDiagnostics& diagnostics);
+	static int16_t  getReceiveQualityPercent(const DW1000RxDiagnostics& diagnostics);
+	
+	/* clock offset to the sender of the frame just received: the carrier
+	integrator (DRX_CAR_INT, 21 bit signed) is positive if the sender's clock runs
+	slower than ours. The chip does not double buffer it, read it in the received
+	handler. toLocalClock() converts a duration the sender counted with its clock
+	into ticks of ours (integer, no float). */
+	static int32_t readCarrierIntegrator();
+	static int64_t toLocalClock(int64_t remoteDuration, int32_t carrierIntegrator);
+	
 	/* interrupt management. */
 	static void interruptOnSent(boolean val);
 	static void interruptOnReceived(boolean val);
@@ -273,6 +311,10 @@ public:
 	static uint16_t getAntennaDelay();
 
 	/* callback handler management. */
+	// for the handlers: micros() when the interrupt handler started on the
+	// events they are called for, before any SPI transaction for them
+	static uint32_t getInterruptMicros() { return _interruptMicros; }
+	
 	static void attachErrorHandler(void (* handleError)(void)) {
 		_handleError = handleError;
 	}
@@ -297,6 +339,24 @@ public:
 		_handleReceiveTimestampAvailable = handleReceiveTimestampAvailable;
 	}
 	
+	/* SPI transport, see DW1000Transport.h. nullptr selects the default
+	transport on the Arduino SPI class. The transmit path (setData(),
+	startTransmit(), startReceive()) queues its writes, they may still be in
+	progress on return until the next register read. */
+	static void    setTransport(DW1000Transport* transport);
+	static boolean isTransportBusy();
+	static void    flushTransport();
+	
+	/* write-through shadow of the configuration registers (SYS_CFG, SYS_MASK,
+	CHAN_CTRL, TX_FCTRL, PANADR, antenna delays and the tuning registers): a
+	write only sends the bytes which differ from what the chip holds and is
+	skipped if none do. Invalidated by resets and sleep. On by default. */
+	static void     useRegisterCache(boolean val);
+	static void     invalidateRegisterCache();
+	static uint32_t getSavedSpiTransactions();
+	static uint32_t getSavedSpiBytes();
+	static void     resetRegisterCacheStats();
+	
 	/* device state management. */
 	// idle state
 	static void idle();
@@ -433,6 +493,7 @@ public:
 	static void (* _handleReceiveFailed)(void);
 	static void (* _handleReceiveTimeout)(void);
 	static void (* _handleReceiveTimestampAvailable)(void);
+	static uint32_t _interruptMicros;
 	
 	/* register caches. */
 	static byte _syscfg[LEN_SYS_CFG];
@@ -473,6 +534,8 @@ public:
 
 	/* Arduino interrupt handler */
 	static void handleInterrupt();
+	static void rearmReceiver();
+	static boolean isInterruptPending();
 	
 	/* Allow MAC frame filtering . */
 	// TODO auto-acknowledge
@@ -486,8 +549,14 @@ public:
 	//Reserved is used for the Blink message
 	static void setFrameFilterAllowReserved(boolean val);
 	
-	// note: not sure if going to be implemented for now
+	/* double buffered receive: the chip receives the next frame into the
+	second buffer set while the host reads the first one, handleInterrupt()
+	hands a buffer back (HRBPT) once its frame was handled. Takes effect with
+	the next writeSystemConfigurationRegister(). */
 	static void setDoubleBuffering(boolean val);
+	static boolean isDoubleBuffered();
+	static void toggleHostBuffer();
+	static void syncReceiveBuffers();
 	// TODO is implemented, but needs testing
 	static void useExtendedFrameLength(boolean val);
 	// TODO is implemented, but needs testing
@@ -532,16 +601,31 @@ public:
 	
 	/* timestamp correction. */
 	static void correctTimestamp(DW1000Time& timestamp);
+	static void correctTimestamp(DW1000Time& timestamp, int16_t rxPowerCentiDbm);
 	
 	/* reading and writing bytes from and to DW1000 module. */
 	static void readBytes(byte cmd, uint16_t offset, byte data[], uint16_t n);
 	static void readBytesOTP(uint16_t address, byte data[]);
 	static void writeByte(byte cmd, uint16_t offset, byte data);
 	static void writeBytes(byte cmd, uint16_t offset, byte data[], uint16_t n);
+	static void writeBytesAsync(byte cmd, uint16_t offset, const byte data[], uint16_t n);
+	static uint8_t buildHeader(byte header[], byte cmd, uint16_t offset, boolean write);
+	
+	/* register cache, see useRegisterCache(). */
+	static boolean  filterCachedWrite(byte cmd, uint16_t& offset, const byte*& data, uint16_t& n);
+	static uint8_t  headerLength(uint16_t offset);
+	static void     refreshCache(byte cmd, uint16_t offset, const byte data[], uint16_t n);
+	static boolean  _registerCache;
+	static uint32_t _cacheValid;
+	static uint32_t _savedTransactions;
+	static uint32_t _savedBytes;
 	
 	/* writing numeric values to bytes. */
 	static void writeValueToBytes(byte data[], int32_t val, uint16_t n);
 	
+	/* 10*log10(value) in 1/100 dB, integer only. */
+	static int32_t centiDecibels(uint64_t value);
+	
 	/* internal helper for bit operations on multi-bytes. */
 	static boolean getBit(byte data[], uint16_t n, uint16_t bit);
 	static void    setBit(byte data[], uint16_t n, uint16_t bit, boolean val);
@@ -563,6 +647,8 @@ public:
 	static const SPISettings _fastSPI;
 	static const SPISettings _slowSPI;
 	static const SPISettings* _currentSPI;
+	static DW1000SpiTransport _spiTransport;
+	static DW1000Transport*   _transport;
 	
 	/* range bias tables (500/900 MHz band, 16/64 MHz PRF), -61 to -95 dBm. */
 	static const byte BIAS_500_16_ZERO = 10;
@@ -75,6 +75,7 @@
 #define WAIT4RESP_BIT 7
 #define RXENAB_BIT 8
 #define RXDLYS_BIT 9
+#define HRBPT_BIT 24
 
 // system event status register
 #define SYS_STATUS 0x0F
@@ -97,6 +98,9 @@
 #define LDEERR_BIT 18
 #define RFPLL_LL_BIT 24
 #define CLKPLL_LL_BIT 25
+#define RXOVRR_BIT 20
+#define HSRBP_BIT 30
+#define ICRBP_BIT 31
 
 // system event mask register
 // NOTE: uses the bit definitions of SYS_STATUS (below 32)
@@ -114,6 +118,8 @@
 #define FP_AMPL1_SUB 0x07
 #define LEN_RX_STAMP LEN_STAMP
 #define LEN_FP_AMPL1 2
+// RX_STAMP, FP_INDEX and FP_AMPL1
+#define LEN_RX_TIME_DIAG (FP_AMPL1_SUB+LEN_FP_AMPL1)
 
 // RX frame quality
 #define RX_FQUAL 0x12
@@ -193,11 +199,13 @@
 #define DRX_TUNE1b_SUB 0x06
 #define DRX_TUNE2_SUB 0x08
 #define DRX_TUNE4H_SUB 0x26
+#define DRX_CAR_INT_SUB 0x28
 #define LEN_DRX_TUNE0b 2
 #define LEN_DRX_TUNE1a 2
 #define LEN_DRX_TUNE1b 2
 #define LEN_DRX_TUNE2 4
 #define LEN_DRX_TUNE4H 2
+#define LEN_DRX_CAR_INT 3
 
 // LDE_CFG1 (for re-tuning only)
 #define LDE_IF 0x2E
@@ -0,0 +1,151 @@
+/*
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000DeadlineHeap.h
+ * Min-heap of 32 bit deadlines per device slot used by DW1000Ranging to
+ * visit only the devices whose deadline expired: protocol and inactivity
+ * deadlines in millis(), queued replies in micros(). One heap holds one clock.
+ *
+ * Deadlines compare by their signed distance, so they may wrap around as
+ * long as all of them are within 2^31 ticks of each other: 24 days for
+ * millis(), 35 minutes for micros(). Every slot is in the heap at most once
+ * and can be moved or removed in O(log Capacity).
+ */
+
+#ifndef _DW1000DeadlineHeap_H_INCLUDED
+#define _DW1000DeadlineHeap_H_INCLUDED
+
+#include <Arduino.h>
+#include <stdint.h>
+#include "require_cpp11.h"
+
+template<uint8_t Capacity>
+class DW1000DeadlineHeap {
+public:
+	static constexpr uint8_t NONE = 0xFF;
+
+	DW1000DeadlineHeap() { clear(); }
+
+	void clear() {
+		_size = 0;
+		for(uint8_t i = 0; i < Capacity; i++) {
+			_positions[i] = NONE;
+		}
+	}
+
+	boolean empty() const { return _size == 0; }
+
+	// slot with the earliest deadline, only if not empty()
+	uint8_t top() const { return _slots[0]; }
+
+	uint32_t topDeadline() const { return _deadlines[0]; }
+
+	// true if the earliest deadline is before now
+	boolean expired(uint32_t now) const {
+		return _size > 0 && (int32_t)(now-_deadlines[0]) > 0;
+	}
+
+	boolean contains(uint8_t slot) const { return _positions[slot] != NONE; }
+
+	// insert the slot or move it to a new deadline
+	void set(uint8_t slot, uint32_t deadline) {
+		uint8_t i = _positions[slot];
+		if(i == NONE) {
+			i = _size++;
+			_slots[i]        = slot;
+			_positions[slot] = i;
+		}
+		else if(before(_deadlines[i], deadline)) {
+			_deadlines[i] = deadline;
+			siftDown(i);
+			return;
+		}
+		_deadlines[i] = deadline;
+		siftUp(i);
+	}
+
+	void erase(uint8_t slot) {
+		uint8_t i = _positions[slot];
+		if(i == NONE) {
+			return;
+		}
+		_positions[slot] = NONE;
+		_size--;
+		if(i == _size) {
+			return;
+		}
+		// the last entry fills the gap and goes up or down from there
+		uint8_t moved     = _slots[_size];
+		_slots[i]         = moved;
+		_deadlines[i]     = _deadlines[_size];
+		_positions[moved] = i;
+		siftUp(i);
+		siftDown(_positions[moved]);
+	}
+
+private:
+	static boolean before(uint32_t a, uint32_t b) {
+		return (int32_t)(a-b) < 0;
+	}
+
+	void swap(uint8_t i, uint8_t j) {
+		uint8_t  slot     = _slots[i];
+		uint32_t deadline = _deadlines[i];
+		_slots[i]     = _slots[j];
+		_deadlines[i] = _deadlines[j];
+		_slots[j]     = slot;
+		_deadlines[j] = deadline;
+		_positions[_slots[i]] = i;
+		_positions[_slots[j]] = j;
+	}
+
+	void siftUp(uint8_t i) {
+		while(i > 0) {
+			uint8_t parent = (i-1)/2;
+			if(!before(_deadlines[i], _deadlines[parent])) {
+				return;
+			}
+			swap(i, parent);
+			i = parent;
+		}
+	}
+
+	void siftDown(uint8_t i) {
+		for(;;) {
+			uint16_t left     = 2*(uint16_t)i+1;
+			uint16_t smallest = i;
+			if(left < _size && before(_deadlines[left], _deadlines[smallest])) {
+				smallest = left;
+			}
+			if(left+1 < _size && before(_deadlines[left+1], _deadlines[smallest])) {
+				smallest = left+1;
+			}
+			if(smallest == i) {
+				return;
+			}
+			swap(i, smallest);
+			i = smallest;
+		}
+	}
+
+	uint32_t _deadlines[Capacity];
+	uint8_t  _slots[Capacity];
+	uint8_t  _positions[Capacity]; // heap position of each slot or NONE
+	uint8_t  _size;
+};
+
+template<uint8_t Capacity> constexpr uint8_t DW1000DeadlineHeap<Capacity>::NONE;
+
+#endif
@@ -26,13 +26,14 @@
 
 
 //Constructor and destructor
-DW1000Device::DW1000Device() {
+DW1000DeviceBase::DW1000DeviceBase() : _hot(&_detachedHot) {
 	randomShortAddress();
+	noteActivity();
 	// Initialize per-device protocol state
 	resetProtocolState();
 }
 
-DW1000Device::DW1000Device(byte deviceAddress[], boolean shortOne) {
+DW1000DeviceBase::DW1000DeviceBase(byte deviceAddress[], boolean shortOne) : _hot(&_detachedHot) {
 	if(!shortOne) {
 		//we have a 8 bytes address
 		setAddress(deviceAddress);
@@ -42,63 +43,107 @@ DW1000Device::DW1000Device(byte deviceAddress[], boolean shortOne) {
 		//we have a short address (2 bytes)
 		setShortAddress(deviceAddress);
 	}
+	noteActivity();
 	// Initialize per-device protocol state
 	resetProtocolState();
 }
 
-DW1000Device::DW1000Device(byte deviceAddress[], byte shortAddress[]) {
+DW1000DeviceBase::DW1000DeviceBase(byte deviceAddress[], byte shortAddress[]) : _hot(&_detachedHot) {
 	//we have a 8 bytes address
 	setAddress(deviceAddress);
 	//we set the 2 bytes address
 	setShortAddress(shortAddress);
+	noteActivity();
 	// Initialize per-device protocol state
 	resetProtocolState();
 }
 
-DW1000Device::~DW1000Device() {
+// a copy owns its hot fields, it does not share the table entry of the original
+DW1000DeviceBase::DW1000DeviceBase(const DW1000DeviceBase& device) {
+	*this = device;
 }
 
+DW1000DeviceBase::~DW1000DeviceBase() {
+}
+
+DW1000DeviceBase& DW1000DeviceBase::operator=(const DW1000DeviceBase& device) {
+	if(this != &device) {
+		memcpy(_ownAddress, device._ownAddress, 8);
+		_replyDelayTimeUS = device._replyDelayTimeUS;
+		_pendingReply     = device._pendingReply;
+		_index            = device._index;
+		_range            = device._range;
+		_RXPower          = device._RXPower;
+		_FPPower          = device._FPPower;
+		_quality          = device._quality;
+		_detachedHot      = *device._hot;
+		_hot              = &_detachedHot;
+	}
+	return *this;
+}
+
+void DW1000DeviceBase::setHotState(DW1000DeviceHot* hot) {
+	if(hot == nullptr) {
+		_detachedHot = *_hot;
+		_hot         = &_detachedHot;
+	}
+	else {
+		if(hot != _hot) {
+			*hot = *_hot;
+		}
+		_hot = hot;
+	}
+}
+
+// timestamps the role specific states share between all devices
+DW1000Time DW1000AnchorDevice::timePollSent;
+DW1000Time DW1000AnchorDevice::timePollAckReceived;
+DW1000Time DW1000AnchorDevice::timeRangeSent;
+
+DW1000Time DW1000TagDevice::timePollSent;
+DW1000Time DW1000TagDevice::timeRangeSent;
+
 //setters:
-void DW1000Device::setReplyTime(uint16_t replyDelayTimeUs) { _replyDelayTimeUS = replyDelayTimeUs; }
+void DW1000DeviceBase::setReplyTime(uint16_t replyDelayTimeUs) { _replyDelayTimeUS = replyDelayTimeUs; }
 
-void DW1000Device::setAddress(char deviceAddress[]) { DW1000.convertToByte(deviceAddress, _ownAddress); }
+void DW1000DeviceBase::setAddress(char deviceAddress[]) { DW1000.convertToByte(deviceAddress, _ownAddress); }
 
-void DW1000Device::setAddress(byte* deviceAddress) {
+void DW1000DeviceBase::setAddress(byte* deviceAddress) {
 	memcpy(_ownAddress, deviceAddress, 8);
 }
 
-void DW1000Device::setShortAddress(byte deviceAddress[]) {
-	memcpy(_shortAddress, deviceAddress, 2);
+void DW1000DeviceBase::setShortAddress(byte deviceAddress[]) {
+	memcpy(_hot->shortAddress, deviceAddress, 2);
 }
 
 
-void DW1000Device::setRange(float range) { _range = round(range*100); }
+void DW1000DeviceBase::setRange(float range) { _range = round(range*1000); }
 
-void DW1000Device::setRXPower(float RXPower) { _RXPower = round(RXPower*100); }
+void DW1000DeviceBase::setRXPower(float RXPower) { _RXPower = round(RXPower*100); }
 
-void DW1000Device::setFPPower(float FPPower) { _FPPower = round(FPPower*100); }
+void DW1000DeviceBase::setFPPower(float FPPower) { _FPPower = round(FPPower*100); }
 
-void DW1000Device::setQuality(float quality) { _quality = round(quality*100); }
+void DW1000DeviceBase::setQuality(float quality) { _quality = round(quality*100); }
 
 
-byte* DW1000Device::getByteAddress() {
+byte* DW1000DeviceBase::getByteAddress() {
 	return _ownAddress;
 }
 
 /*
-String DW1000Device::getAddress(){
+String DW1000DeviceBase::getAddress(){
     char string[25];
     sprintf(string, "%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X",
             _ownAddress[0], _ownAddress[1], _ownAddress[2], _ownAddress[3], _ownAddress[4], _ownAddress[5], _ownAddress[6], _ownAddress[7]);
     return String(string);
 }*/
 
-byte* DW1000Device::getByteShortAddress() {
-	return _shortAddress;
+byte* DW1000DeviceBase::getByteShortAddress() {
+	return _hot->shortAddress;
 }
 
 /*
-String DW1000Device::getShortAddress(){
+String DW1000DeviceBase::getShortAddress(){
     char string[6];
     sprintf(string, "%02X:%02X",
             _shortAddress[0], _shortAddress[1]);
@@ -106,78 +151,69 @@ String DW1000Device::getShortAddress(){
 }
 */
 
-uint16_t DW1000Device::getShortAddress() {
-	return _shortAddress[1]*256+_shortAddress[0];
+uint16_t DW1000DeviceBase::getShortAddress() {
+	return _hot->shortAddress[1]*256+_hot->shortAddress[0];
 }
 
 
-boolean DW1000Device::isAddressEqual(DW1000Device* device) {
+boolean DW1000DeviceBase::isAddressEqual(DW1000DeviceBase* device) {
 	return memcmp(this->getByteAddress(), device->getByteAddress(), 8) == 0;
 }
 
-boolean DW1000Device::isShortAddressEqual(DW1000Device* device) {
+boolean DW1000DeviceBase::isShortAddressEqual(DW1000DeviceBase* device) {
 	return memcmp(this->getByteShortAddress(), device->getByteShortAddress(), 2) == 0;
 }
 
 
-float DW1000Device::getRange() { return float(_range)/100.0f; }
+float DW1000DeviceBase::getRange() { return float(_range)/1000.0f; }
 
-float DW1000Device::getRXPower() { return float(_RXPower)/100.0f; }
+float DW1000DeviceBase::getRXPower() { return float(_RXPower)/100.0f; }
 
-float DW1000Device::getFPPower() { return float(_FPPower)/100.0f; }
+float DW1000DeviceBase::getFPPower() { return float(_FPPower)/100.0f; }
 
-float DW1000Device::getQuality() { return float(_quality)/100.0f; }
+float DW1000DeviceBase::getQuality() { return float(_quality)/100.0f; }
 
 
-void DW1000Device::randomShortAddress() {
-	_shortAddress[0] = random(0, 256);
-	_shortAddress[1] = random(0, 256);
+void DW1000DeviceBase::randomShortAddress() {
+	_hot->shortAddress[0] = random(0, 256);
+	_hot->shortAddress[1] = random(0, 256);
 }
 
-void DW1000Device::noteActivity() {
-	_activity = millis();
+void DW1000DeviceBase::noteActivity() {
+	_hot->activity = millis();
 }
 
 
-boolean DW1000Device::isInactive() {
+boolean DW1000DeviceBase::isInactive() {
 	//One second of inactivity
-	if(millis()-_activity > INACTIVITY_TIME) {
-		_activity = millis();
+	if(millis()-_hot->activity > INACTIVITY_TIME) {
+		_hot->activity = millis();
 		return true;
 	}
 	return false;
 }
 
-// NEW: Per-device protocol state management methods
-void DW1000Device::resetProtocolState() {
-	_protocolState = PROTOCOL_IDLE;
-	_expectedMsgId = MSG_POLL;
-	_sentAck = false;
-	_receivedAck = false;
-	_protocolFailed = false;
-	_lastProtocolActivity = millis();
+void DW1000DeviceBase::resetProtocolState() {
+	_hot->protocolState = PROTOCOL_IDLE;
+	_hot->expectedMessage = MSG_POLL;
+	_hot->sentAck = false;
+	_hot->receivedAck = false;
+	_hot->protocolFailed = false;
+	_hot->rangeReportPending = false;
+	_hot->protocolActivity = millis();
 }
 
-boolean DW1000Device::isProtocolActive() {
-	return (_protocolState != PROTOCOL_IDLE && _protocolState != PROTOCOL_FAILED);
+boolean DW1000DeviceBase::isProtocolActive() {
+	return _hot->isProtocolActive();
 }
 
-void DW1000Device::handleProtocolTimeout() {
-	_protocolState = PROTOCOL_FAILED;
-	_protocolFailed = true;
-	_sentAck = false;
-	_receivedAck = false;
+void DW1000DeviceBase::handleProtocolTimeout() {
+	_hot->protocolState = PROTOCOL_FAILED;
+	_hot->protocolFailed = true;
+	_hot->sentAck = false;
+	_hot->receivedAck = false;
 }
 
-boolean DW1000Device::isProtocolTimedOut(uint32_t timeoutMs) {
-	if (!isProtocolActive()) {
-		return false;
-	}
-	
-	uint32_t currentTime = millis();
-	if (currentTime - _lastProtocolActivity > timeoutMs) {
-		return true;
-	}
-	
-	return false;
+boolean DW1000DeviceBase::isProtocolTimedOut(uint32_t timeoutMs) {
+	return _hot->isProtocolTimedOut(millis(), timeoutMs);
 }
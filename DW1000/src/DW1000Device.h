@@ -32,6 +32,7 @@
 
 class DW1000Mac;
 
+class DW1000DeviceBase;
 class DW1000Device;
 
 // Protocol state enumeration for per-device state management
@@ -41,7 +42,8 @@ enum ProtocolState {
 	PROTOCOL_POLL_ACK_SENT,
 	PROTOCOL_RANGE_SENT,
 	PROTOCOL_RANGE_REPORT_SENT,
-	PROTOCOL_FAILED
+	PROTOCOL_FAILED,
+	PROTOCOL_RANGE_TIMES_RECEIVED // tag, range computed with the other anchors
 };
 
 // Message types for protocol state machine
@@ -52,16 +54,51 @@ enum MessageType {
 	MSG_RANGE_REPORT = 3,
 	MSG_RANGE_FAILED = 255,
 	MSG_BLINK = 4,
-	MSG_RANGING_INIT = 5
+	MSG_RANGING_INIT = 5,
+	MSG_RESPONSE = 6,
+	MSG_RANGE_TIMES = 7,
+	MSG_BEACON = 8
 };
 
-class DW1000Device {
+// Per-device fields the periodic sweeps of DW1000RangingT read (short
+// address, protocol state, activity). The device table keeps them packed in
+// their own array in network order, apart from addresses and timestamps.
+struct DW1000DeviceHot {
+	uint32_t         activity;
+	uint32_t         protocolActivity;
+	byte             shortAddress[2];
+	uint8_t          protocolState;   // ProtocolState
+	uint8_t          expectedMessage; // MessageType
+	volatile boolean sentAck;
+	volatile boolean receivedAck;
+	boolean          protocolFailed;
+	boolean          rangeReportPending; // anchor: range goes out with the next POLL_ACK
+	
+	boolean isProtocolActive() const {
+		return (protocolState != PROTOCOL_IDLE && protocolState != PROTOCOL_FAILED);
+	}
+	
+	boolean isProtocolTimedOut(uint32_t now, uint32_t timeoutMs) const {
+		return isProtocolActive() && now-protocolActivity > timeoutMs;
+	}
+};
+
+// Address, range and protocol state of a distant device. The timestamps of
+// the ranging exchange are added by the device state classes below, which are
+// the DeviceState parameter of DW1000RangingT.
+//
+// The hot fields live in the device itself until it is added to a device
+// table, from then on in the table's hot array (see setHotState()).
+class DW1000DeviceBase {
 public:
 	//Constructor and destructor
-	DW1000Device();
-	DW1000Device(byte address[], byte shortAddress[]);
-	DW1000Device(byte address[], boolean shortOne = false);
-	~DW1000Device();
+	DW1000DeviceBase();
+	DW1000DeviceBase(byte address[], byte shortAddress[]);
+	DW1000DeviceBase(byte address[], boolean shortOne = false);
+	DW1000DeviceBase(const DW1000DeviceBase& device);
+	~DW1000DeviceBase();
+	
+	DW1000DeviceBase& operator=(const DW1000DeviceBase& device);
 	
 	//setters:
 	void setReplyTime(uint16_t replyDelayTimeUs);
@@ -73,11 +110,24 @@ public:
 	void setRXPower(float power);
 	void setFPPower(float power);
 	void setQuality(float quality);
+	// the same in mm, 1/100 dBm and 1/100, as stored
+	void setRangeMillimeters(int32_t range) { _range = range; }
+	void setRXPowerCentiDbm(int16_t power) { _RXPower = power; }
+	void setFPPowerCentiDbm(int16_t power) { _FPPower = power; }
+	void setQualityPercent(int16_t quality) { _quality = quality; }
 	
 	void setReplyDelayTime(uint16_t time) { _replyDelayTimeUS = time; }
 	
+	// anchor: the reply (MessageType) waiting in the reply queue for this tag
+	void setPendingReply(uint8_t messageType) { _pendingReply = messageType; }
+	uint8_t getPendingReply() { return _pendingReply; }
+	
 	void setIndex(int8_t index) { _index = index; }
 	
+	// moves the hot fields to table storage (nullptr: back into the device)
+	void setHotState(DW1000DeviceHot* hot);
+	DW1000DeviceHot* getHotState() { return _hot; }
+	
 	//getters
 	uint16_t getReplyTime() { return _replyDelayTimeUS; }
 	
@@ -91,40 +141,37 @@ public:
 	//String getShortAddress();
 	
 	float getRange();
+	int32_t getRangeMillimeters() { return _range; }
 	float getRXPower();
 	float getFPPower();
 	float getQuality();
+	int16_t getRXPowerCentiDbm() { return _RXPower; }
+	int16_t getFPPowerCentiDbm() { return _FPPower; }
+	int16_t getQualityPercent() { return _quality; }
 	
-	boolean isAddressEqual(DW1000Device* device);
-	boolean isShortAddressEqual(DW1000Device* device);
-	
-	//functions which contains the date: (easier to put as public)
-	// timestamps to remember
-	DW1000Time timePollSent;
-	DW1000Time timePollReceived;
-	DW1000Time timePollAckSent;
-	DW1000Time timePollAckReceived;
-	DW1000Time timeRangeSent;
-	DW1000Time timeRangeReceived;
+	boolean isAddressEqual(DW1000DeviceBase* device);
+	boolean isShortAddressEqual(DW1000DeviceBase* device);
 	
 	void    noteActivity();
 	boolean isInactive();
 
-	// NEW: Per-device protocol state management
-	void setProtocolState(ProtocolState state) { _protocolState = state; }
-	ProtocolState getProtocolState() { return _protocolState; }
+	void setProtocolState(ProtocolState state) { _hot->protocolState = state; }
+	ProtocolState getProtocolState() { return (ProtocolState)_hot->protocolState; }
+	
+	void setExpectedMessage(MessageType msgType) { _hot->expectedMessage = msgType; }
+	MessageType getExpectedMessage() { return (MessageType)_hot->expectedMessage; }
 	
-	void setExpectedMessage(MessageType msgType) { _expectedMsgId = msgType; }
-	MessageType getExpectedMessage() { return _expectedMsgId; }
+	void setSentAck(boolean sent) { _hot->sentAck = sent; }
+	boolean getSentAck() { return _hot->sentAck; }
 	
-	void setSentAck(boolean sent) { _sentAck = sent; }
-	boolean getSentAck() { return _sentAck; }
+	void setReceivedAck(boolean received) { _hot->receivedAck = received; }
+	boolean getReceivedAck() { return _hot->receivedAck; }
 	
-	void setReceivedAck(boolean received) { _receivedAck = received; }
-	boolean getReceivedAck() { return _receivedAck; }
+	void setProtocolFailed(boolean failed) { _hot->protocolFailed = failed; }
+	boolean getProtocolFailed() { return _hot->protocolFailed; }
 	
-	void setProtocolFailed(boolean failed) { _protocolFailed = failed; }
-	boolean getProtocolFailed() { return _protocolFailed; }
+	void setRangeReportPending(boolean pending) { _hot->rangeReportPending = pending; }
+	boolean getRangeReportPending() { return _hot->rangeReportPending; }
 	
 	// Protocol state machine methods
 	void resetProtocolState();
@@ -132,33 +179,81 @@ public:
 	void handleProtocolTimeout();
 	
 	// Last activity timestamp for this specific device protocol
-	void noteProtocolActivity() { _lastProtocolActivity = millis(); }
+	void noteProtocolActivity() { _hot->protocolActivity = millis(); }
 	boolean isProtocolTimedOut(uint32_t timeoutMs = 1000);
 
 private:
 	//device ID
 	byte         _ownAddress[8];
-	byte         _shortAddress[2];
-	int32_t      _activity;
+	// tag: the one we give the anchor, anchor: the one the tag gave us
 	uint16_t     _replyDelayTimeUS;
-	int8_t       _index; // not used
+	uint8_t      _pendingReply;
+	int8_t       _index; // slot in the device table
 	
-	int16_t _range;
+	int32_t _range; // mm
 	int16_t _RXPower;
 	int16_t _FPPower;
 	int16_t _quality;
 	
-	// NEW: Per-device protocol state variables
-	ProtocolState _protocolState;
-	MessageType _expectedMsgId;
-	volatile boolean _sentAck;
-	volatile boolean _receivedAck;
-	boolean _protocolFailed;
-	uint32_t _lastProtocolActivity;
+	// short address, activity and protocol state: _detachedHot or a table entry
+	DW1000DeviceHot* _hot;
+	DW1000DeviceHot  _detachedHot;
 	
 	void randomShortAddress();
 	
 };
 
+// Full state, usable as tag and as anchor. Default DeviceState of DW1000RangingClass.
+class DW1000Device : public DW1000DeviceBase {
+public:
+	using DW1000DeviceBase::DW1000DeviceBase;
+	
+	//functions which contains the date: (easier to put as public)
+	// timestamps to remember
+	DW1000Time timePollSent;
+	DW1000Time timePollReceived;
+	DW1000Time timePollAckSent;
+	DW1000Time timePollAckReceived;
+	DW1000Time timeRangeSent;
+	DW1000Time timeRangeReceived;
+};
+
+// State an anchor keeps per tag. The timestamps of its own POLL reception and
+// POLL_ACK transmission have to survive until the tag's RANGE arrives, and the
+// RANGE reception until the RANGE_TIMES reply went out (ranging on the tag),
+// which may wait while other tags are served. The tag's times are filled from
+// the RANGE frame and used right away, so they are shared by all devices
+// (static). Never use it on a tag.
+class DW1000AnchorDevice : public DW1000DeviceBase {
+public:
+	using DW1000DeviceBase::DW1000DeviceBase;
+	
+	DW1000Time timePollReceived;
+	DW1000Time timePollAckSent;
+	DW1000Time timeRangeReceived;
+	
+	static DW1000Time timePollSent;
+	static DW1000Time timePollAckReceived;
+	static DW1000Time timeRangeSent;
+};
+
+// State a tag keeps per anchor. POLL and RANGE are broadcast to all anchors,
+// so their transmit timestamps are the same for every device (static); the
+// POLL_ACK (single-sided: RESPONSE) reception is per anchor, and so are the
+// anchor's times of a RANGE_TIMES, kept until the ranges of all anchors are
+// computed. Never use it on an anchor.
+class DW1000TagDevice : public DW1000DeviceBase {
+public:
+	using DW1000DeviceBase::DW1000DeviceBase;
+	
+	DW1000Time timePollAckReceived;
+	DW1000Time timePollReceived;
+	DW1000Time timePollAckSent;
+	DW1000Time timeRangeReceived;
+	
+	static DW1000Time timePollSent;
+	static DW1000Time timeRangeSent;
+};
+
 
 #endif
@@ -0,0 +1,122 @@
+/*
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000DeviceIndex.h
+ * Short address -> device slot index used by DW1000Ranging to find the
+ * sender of a frame in constant time.
+ *
+ * Open addressing with linear probing in a table of at least twice the
+ * capacity (load factor <= 0.5). Removal shifts the following entries back
+ * instead of leaving tombstones, so lookups never degrade over time.
+ */
+
+#ifndef _DW1000DeviceIndex_H_INCLUDED
+#define _DW1000DeviceIndex_H_INCLUDED
+
+#include <Arduino.h>
+#include <stdint.h>
+#include "require_cpp11.h"
+
+template<uint8_t Capacity>
+class DW1000DeviceIndex {
+public:
+	static constexpr uint8_t NONE = 0xFF;
+
+	DW1000DeviceIndex() { clear(); }
+
+	void clear() {
+		for(uint16_t i = 0; i < BUCKETS; i++) {
+			_slots[i] = NONE;
+		}
+	}
+
+	// slot of the device with this short address or NONE
+	uint8_t find(const byte shortAddress[]) const {
+		uint16_t key = toKey(shortAddress);
+		for(uint16_t i = hash(key);; i = (i+1) & MASK) {
+			if(_slots[i] == NONE) {
+				return NONE;
+			}
+			if(_keys[i] == key) {
+				return _slots[i];
+			}
+		}
+	}
+
+	// false if the short address is already present
+	boolean insert(const byte shortAddress[], uint8_t slot) {
+		uint16_t key = toKey(shortAddress);
+		uint16_t i   = hash(key);
+		for(; _slots[i] != NONE; i = (i+1) & MASK) {
+			if(_keys[i] == key) {
+				return false;
+			}
+		}
+		_keys[i]  = key;
+		_slots[i] = slot;
+		return true;
+	}
+
+	void erase(const byte shortAddress[]) {
+		uint16_t key = toKey(shortAddress);
+		uint16_t i   = hash(key);
+		for(; _slots[i] != NONE; i = (i+1) & MASK) {
+			if(_keys[i] == key) {
+				break;
+			}
+		}
+		if(_slots[i] == NONE) {
+			return;
+		}
+		// pull back entries of the same probe run which would become unreachable
+		for(uint16_t j = (i+1) & MASK; _slots[j] != NONE; j = (j+1) & MASK) {
+			uint16_t home = hash(_keys[j]);
+			if(((j-home) & MASK) >= ((j-i) & MASK)) {
+				_keys[i]  = _keys[j];
+				_slots[i] = _slots[j];
+				i         = j;
+			}
+		}
+		_slots[i] = NONE;
+	}
+
+private:
+	static constexpr uint8_t bitsFor(uint16_t n, uint8_t bits = 0) {
+		return (1U << bits) >= n ? bits : bitsFor(n, bits+1);
+	}
+
+	static constexpr uint8_t  BITS    = bitsFor(2*(uint16_t)Capacity);
+	static constexpr uint16_t BUCKETS = 1U << BITS;
+	static constexpr uint16_t MASK    = BUCKETS-1;
+
+	static uint16_t toKey(const byte shortAddress[]) {
+		return (uint16_t)shortAddress[0] << 8 | shortAddress[1];
+	}
+
+	// Fibonacci hashing, short addresses are often sequential
+	static uint16_t hash(uint16_t key) {
+		return (uint16_t)(((uint32_t)key*2654435769UL) >> (32-BITS)) & MASK;
+	}
+
+	uint16_t _keys[BUCKETS];
+	uint8_t  _slots[BUCKETS];
+};
+
+template<uint8_t Capacity> constexpr uint8_t  DW1000DeviceIndex<Capacity>::NONE;
+template<uint8_t Capacity> constexpr uint8_t  DW1000DeviceIndex<Capacity>::BITS;
+template<uint8_t Capacity> constexpr uint16_t DW1000DeviceIndex<Capacity>::BUCKETS;
+template<uint8_t Capacity> constexpr uint16_t DW1000DeviceIndex<Capacity>::MASK;
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000MessageQueue.h
+ * Lock-free single producer / single consumer ring used by DW1000Ranging to
+ * hand received frames from the interrupt handler to loop().
+ *
+ * The producer fills the slot returned by reserve() and publishes it with
+ * push(), the consumer works on front() in place and releases it with pop().
+ * Head and tail run freely (Size is a power of two); the producer alone
+ * writes the tail and the consumer alone the head, with release stores
+ * matched by acquire loads on the other side, so a slot is never seen before
+ * its contents and never reused before it was released. This holds for an
+ * ISR and loop() on one core as well as on two cores (ESP32) or threads.
+ */
+
+#ifndef _DW1000MessageQueue_H_INCLUDED
+#define _DW1000MessageQueue_H_INCLUDED
+
+#include <Arduino.h>
+#include <stdint.h>
+#include "require_cpp11.h"
+
+template<class Item, uint8_t Size>
+class DW1000MessageQueue {
+public:
+	static_assert(Size > 0 && Size <= 128 && (Size & (Size-1)) == 0, "Size must be a power of two up to 128");
+
+	DW1000MessageQueue() : _head(0), _tail(0), _maxDepth(0), _resetMaxDepth(0), _dropped(0), _droppedBase(0) {}
+
+	// only while the producer is stopped
+	void clear() {
+		__atomic_store_n(&_head, 0, __ATOMIC_RELEASE);
+		__atomic_store_n(&_tail, 0, __ATOMIC_RELEASE);
+	}
+
+	/* producer */
+
+	// free slot to fill, nullptr (and counted as dropped) if full
+	Item* reserve() {
+		uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+		if((uint8_t)(tail-__atomic_load_n(&_head, __ATOMIC_ACQUIRE)) >= Size) {
+			__atomic_store_n(&_dropped, __atomic_load_n(&_dropped, __ATOMIC_RELAXED)+1, __ATOMIC_RELAXED);
+			return nullptr;
+		}
+		return &_items[tail % Size];
+	}
+
+	// publish the slot returned by reserve()
+	void push() {
+		uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED)+1;
+		__atomic_store_n(&_tail, tail, __ATOMIC_RELEASE);
+		uint8_t depth = tail-__atomic_load_n(&_head, __ATOMIC_RELAXED);
+		if(__atomic_exchange_n(&_resetMaxDepth, 0, __ATOMIC_RELAXED) || depth > _maxDepth) {
+			__atomic_store_n(&_maxDepth, depth, __ATOMIC_RELAXED);
+		}
+	}
+
+	/* consumer */
+
+	// oldest published slot, nullptr if empty
+	Item* front() {
+		uint8_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+		if(head == __atomic_load_n(&_tail, __ATOMIC_ACQUIRE)) {
+			return nullptr;
+		}
+		return &_items[head % Size];
+	}
+
+	// release the slot returned by front()
+	void pop() {
+		__atomic_store_n(&_head, (uint8_t)(__atomic_load_n(&_head, __ATOMIC_RELAXED)+1), __ATOMIC_RELEASE);
+	}
+
+	uint8_t size() const {
+		return (uint8_t)(__atomic_load_n(&_tail, __ATOMIC_ACQUIRE)-__atomic_load_n(&_head, __ATOMIC_ACQUIRE));
+	}
+
+	// deepest level since resetStats() and slots the producer found full,
+	// the producer owns both counters, the consumer only moves the baseline
+	uint8_t maxDepth() const {
+		return __atomic_load_n(&_resetMaxDepth, __ATOMIC_RELAXED) ? size() : __atomic_load_n(&_maxDepth, __ATOMIC_RELAXED);
+	}
+
+	uint32_t dropped() const {
+		return __atomic_load_n(&_dropped, __ATOMIC_RELAXED)-_droppedBase;
+	}
+
+	void resetStats() {
+		_droppedBase = __atomic_load_n(&_dropped, __ATOMIC_RELAXED);
+		__atomic_store_n(&_resetMaxDepth, 1, __ATOMIC_RELAXED);
+	}
+
+private:
+	Item     _items[Size];
+	uint8_t  _head;          // written by the consumer
+	uint8_t  _tail;          // written by the producer
+	uint8_t  _maxDepth;      // written by the producer
+	uint8_t  _resetMaxDepth; // set by the consumer, cleared by the producer
+	uint32_t _dropped;       // written by the producer
+	uint32_t _droppedBase;   // written by the consumer
+};
+
+#endif
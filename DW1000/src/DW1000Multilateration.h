@@ -0,0 +1,289 @@
+/*
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000Multilateration.h
+ * Position of a tag from its ranges to anchors at known positions, in 2D or
+ * 3D, for up to MaxAnchors anchors.
+ *
+ * The linearized least squares solution (each range equation minus their
+ * mean, around the centroid of the anchors) is the start for Gauss-Newton
+ * iterations on the range residuals |x-anchor|-range. Both solve the
+ * Dimensions x Dimensions normal equations by Cholesky decomposition, all in
+ * float (the ESP32 has no double precision FPU) on fixed-size arrays: no
+ * allocation, the object takes about 4*(Dimensions+1)*MaxAnchors bytes.
+ * refine() alone starts from a given position instead, as the last one of a
+ * tag that moved since.
+ *
+ * At least Dimensions+1 anchors are needed, not all on one line (2D) or in
+ * one plane (3D). In 2D the ranges have to be horizontal ones, anchors at
+ * another height than the tag would otherwise appear farther away.
+ */
+
+#ifndef _DW1000Multilateration_H_INCLUDED
+#define _DW1000Multilateration_H_INCLUDED
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdint.h>
+#include "require_cpp11.h"
+
+template<uint8_t MaxAnchors, uint8_t Dimensions = 2>
+class DW1000Multilateration {
+public:
+	static_assert(Dimensions == 2 || Dimensions == 3, "Dimensions must be 2 or 3");
+	static_assert(MaxAnchors > Dimensions, "MaxAnchors must be at least Dimensions+1");
+
+	// Gauss-Newton iterations, they stop once a step is below 0.1 mm (after 2-5
+	// with 10 cm range noise, more where the anchors hardly fix the height)
+	static constexpr uint8_t MAX_ITERATIONS = 30;
+	static constexpr uint8_t MAX_HALVINGS   = 4;
+
+	DW1000Multilateration() { clear(); }
+
+	// forget the ranges, for the next position
+	void clear() {
+		_count      = 0;
+		_iterations = 0;
+		_residual   = 0;
+	}
+
+	// range in m to the anchor at position (m, Dimensions coordinates), false
+	// if MaxAnchors were added already or the range is negative
+	boolean add(const float position[], float range) {
+		if(_count >= MaxAnchors || !(range >= 0)) {
+			return false;
+		}
+		for(uint8_t k = 0; k < Dimensions; k++) {
+			_anchors[_count][k] = position[k];
+		}
+		_ranges[_count++] = range;
+		return true;
+	}
+
+	uint8_t count() const { return _count; }
+
+	// position of the tag from the added ranges, false if there are too few or
+	// the anchors do not span the space
+	boolean solve(float position[]) {
+		return solveLinear(position) && refine(position);
+	}
+
+	// only the linearized least squares position, the start for refine()
+	boolean solveLinear(float position[]) {
+		_iterations = 0;
+		_residual   = 0;
+		if(_count <= Dimensions) {
+			return false;
+		}
+		// with p the anchor and y the tag position relative to the centroid,
+		// |y-p|^2 = r^2 minus its mean over the anchors (sum of p is 0) is
+		// 2p.y = |p|^2-r^2-mean(|p|^2-r^2)
+		float centroid[Dimensions] = { 0 };
+		for(uint8_t i = 0; i < _count; i++) {
+			for(uint8_t k = 0; k < Dimensions; k++) {
+				centroid[k] += _anchors[i][k];
+			}
+		}
+		float mean = 0;
+		for(uint8_t k = 0; k < Dimensions; k++) {
+			centroid[k] /= _count;
+		}
+		for(uint8_t i = 0; i < _count; i++) {
+			mean += squaredDistance(_anchors[i], centroid)-_ranges[i]*_ranges[i];
+		}
+		mean /= _count;
+		float normal[Dimensions][Dimensions] = { { 0 } };
+		float y[Dimensions] = { 0 };
+		for(uint8_t i = 0; i < _count; i++) {
+			float p[Dimensions];
+			for(uint8_t k = 0; k < Dimensions; k++) {
+				p[k] = 2*(_anchors[i][k]-centroid[k]);
+			}
+			float b = squaredDistance(_anchors[i], centroid)-_ranges[i]*_ranges[i]-mean;
+			accumulate(normal, y, p, b);
+		}
+		if(!solveNormal(normal, y)) {
+			return false;
+		}
+		for(uint8_t k = 0; k < Dimensions; k++) {
+			position[k] = centroid[k]+y[k];
+		}
+		_residual = sqrtf(squaredResiduals(position)/_count);
+		return true;
+	}
+
+	// Gauss-Newton from position, e.g. the last one of a moving tag; false as
+	// solve()
+	boolean refine(float position[]) {
+		_iterations = 0;
+		if(_count <= Dimensions) {
+			return false;
+		}
+		// the residual of an anchor changes by u.dx, u the unit vector from the
+		// anchor to the tag
+		float normal[Dimensions][Dimensions];
+		float cost = squaredResiduals(position);
+		while(_iterations < MAX_ITERATIONS) {
+			float step[Dimensions] = { 0 };
+			for(uint8_t j = 0; j < Dimensions; j++) {
+				for(uint8_t k = 0; k < Dimensions; k++) {
+					normal[j][k] = 0;
+				}
+			}
+			for(uint8_t i = 0; i < _count; i++) {
+				float u[Dimensions];
+				float distance = unitVector(_anchors[i], position, u);
+				if(distance == 0) {
+					// no direction on top of an anchor
+					continue;
+				}
+				accumulate(normal, step, u, _ranges[i]-distance);
+			}
+			if(!solveNormal(normal, step)) {
+				if(_iterations == 0) {
+					return false;
+				}
+				break;
+			}
+			_iterations++;
+			// the full step overshoots along a direction the anchors hardly
+			// constrain (the height, with all anchors near one plane): halve it
+			// until the squared residuals go down
+			float next[Dimensions];
+			float nextCost;
+			for(uint8_t halvings = 0;; halvings++) {
+				for(uint8_t k = 0; k < Dimensions; k++) {
+					next[k] = position[k]+step[k];
+				}
+				nextCost = squaredResiduals(next);
+				if(nextCost < cost || halvings == MAX_HALVINGS) {
+					break;
+				}
+				for(uint8_t k = 0; k < Dimensions; k++) {
+					step[k] /= 2;
+				}
+			}
+			if(!(nextCost < cost)) {
+				// at the minimum within float resolution
+				break;
+			}
+			float length = 0;
+			for(uint8_t k = 0; k < Dimensions; k++) {
+				position[k] = next[k];
+				length     += step[k]*step[k];
+			}
+			cost = nextCost;
+			if(length < 1e-8f) {
+				break;
+			}
+		}
+		_residual = sqrtf(cost/_count);
+		return true;
+	}
+
+	// Gauss-Newton iterations the last solve() took
+	uint8_t iterations() const { return _iterations; }
+
+	// root mean square of the range residuals after the last solve(), m
+	float residual() const { return _residual; }
+
+private:
+	static float squaredDistance(const float a[], const float b[]) {
+		float sum = 0;
+		for(uint8_t k = 0; k < Dimensions; k++) {
+			sum += (a[k]-b[k])*(a[k]-b[k]);
+		}
+		return sum;
+	}
+
+	float squaredResiduals(const float position[]) const {
+		float sum = 0;
+		for(uint8_t i = 0; i < _count; i++) {
+			float error = sqrtf(squaredDistance(_anchors[i], position))-_ranges[i];
+			sum        += error*error;
+		}
+		return sum;
+	}
+
+	// u = (to-from)/|to-from|, returns |to-from|
+	static float unitVector(const float from[], const float to[], float u[]) {
+		float distance = sqrtf(squaredDistance(from, to));
+		for(uint8_t k = 0; k < Dimensions; k++) {
+			u[k] = distance > 0 ? (to[k]-from[k])/distance : 0;
+		}
+		return distance;
+	}
+
+	// normal += a a^T (lower triangle), v += a b
+	static void accumulate(float normal[][Dimensions], float v[], const float a[], float b) {
+		for(uint8_t j = 0; j < Dimensions; j++) {
+			for(uint8_t k = 0; k <= j; k++) {
+				normal[j][k] += a[j]*a[k];
+			}
+			v[j] += a[j]*b;
+		}
+	}
+
+	// normal x = v by Cholesky (lower triangle of normal, overwritten), x in
+	// v. False if a pivot vanishes against the trace: the rows do not span
+	// the space
+	static boolean solveNormal(float normal[][Dimensions], float v[]) {
+		float trace = 0;
+		for(uint8_t j = 0; j < Dimensions; j++) {
+			trace += normal[j][j];
+		}
+		for(uint8_t j = 0; j < Dimensions; j++) {
+			float pivot = normal[j][j];
+			for(uint8_t k = 0; k < j; k++) {
+				pivot -= normal[j][k]*normal[j][k];
+			}
+			if(!(pivot > 1e-5f*trace)) {
+				return false;
+			}
+			normal[j][j] = sqrtf(pivot);
+			for(uint8_t i = j+1; i < Dimensions; i++) {
+				float sum = normal[i][j];
+				for(uint8_t k = 0; k < j; k++) {
+					sum -= normal[i][k]*normal[j][k];
+				}
+				normal[i][j] = sum/normal[j][j];
+			}
+		}
+		for(uint8_t i = 0; i < Dimensions; i++) {
+			for(uint8_t k = 0; k < i; k++) {
+				v[i] -= normal[i][k]*v[k];
+			}
+			v[i] /= normal[i][i];
+		}
+		for(int8_t i = Dimensions-1; i >= 0; i--) {
+			for(uint8_t k = i+1; k < Dimensions; k++) {
+				v[i] -= normal[k][i]*v[k];
+			}
+			v[i] /= normal[i][i];
+		}
+		return true;
+	}
+
+	float   _anchors[MaxAnchors][Dimensions];
+	float   _ranges[MaxAnchors];
+	uint8_t _count;
+	uint8_t _iterations;
+	float   _residual;
+};
+
+template<uint8_t MaxAnchors, uint8_t Dimensions> constexpr uint8_t DW1000Multilateration<MaxAnchors, Dimensions>::MAX_ITERATIONS;
+template<uint8_t MaxAnchors, uint8_t Dimensions> constexpr uint8_t DW1000Multilateration<MaxAnchors, Dimensions>::MAX_HALVINGS;
+
+#endif
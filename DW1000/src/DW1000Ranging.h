@@ -26,10 +26,16 @@
  * - use enums instead of preprocessor constants
  */
 
+#ifndef _DW1000Ranging_H_INCLUDED
+#define _DW1000Ranging_H_INCLUDED
+
 #include "DW1000.h"
 #include "DW1000Time.h"
 #include "DW1000Device.h" 
 #include "DW1000Mac.h"
+#include "DW1000DeviceIndex.h"
+#include "DW1000DeadlineHeap.h"
+#include "DW1000MessageQueue.h"
 
 // messages used in the ranging protocol
 #define POLL 0
@@ -39,11 +45,48 @@
 #define RANGE_FAILED 255
 #define BLINK 4
 #define RANGING_INIT 5
+#define RESPONSE 6
+#define RANGE_TIMES 7
+#define BEACON 8
 
 #define LEN_DATA 90
+// RANGE_TIMES: header, message type and 3 timestamps, not padded to LEN_DATA
+#define LEN_RANGE_TIMES (SHORT_MAC_LEN+16)
+// broadcast RANGE, not padded either: header, message type, number of
+// anchors, timePollSent and timeRangeSent once, then per anchor its short
+// address and the low 32 bits of its timePollAckReceived-timePollSent (the
+// anchor knows the rest from its own reply time)
+#define RANGE_HEADER_LEN (SHORT_MAC_LEN+12)
+#define RANGE_ANCHOR_LEN 6
+// largest frame sent or received, the broadcast RANGE grows with the
+// anchors: 125 bytes (127 with the CRC) carry 17. More need a larger
+// LEN_FRAME_MAX and useExtendedFrameLength() on all devices
+#ifndef LEN_FRAME_MAX
+#define LEN_FRAME_MAX 125
+#endif
 
-//Max devices we put in the networkDevices array ! Each DW1000Device is now larger due to per-device state
+// ranging exchange, tag and anchors have to use the same (setRangingMode())
+enum RangingMode {
+	// POLL, POLL_ACK, RANGE, RANGE_REPORT: asymmetric double-sided two-way
+	// ranging, the anchor computes the range and reports it to the tag
+	RANGING_ASYMMETRIC = 0,
+	// POLL, RESPONSE: single-sided two-way ranging, half the frames. The tag
+	// computes the range, the anchor's reply time corrected by the clock
+	// offset the tag measured on the RESPONSE (carrier integrator). The
+	// anchors do not learn the range
+	RANGING_SINGLE_SIDED = 1,
+	// POLL, POLL_ACK, RANGE, RANGE_TIMES: asymmetric double-sided two-way
+	// ranging computed by the tag. Each anchor answers the RANGE with its POLL
+	// reception, POLL_ACK transmission and RANGE reception times, the tag
+	// computes the ranges of all anchors together after the last one. The
+	// anchors do not learn the range
+	RANGING_ASYMMETRIC_ON_TAG = 2
+};
+
+//Max devices we put in the networkDevices array of DW1000RangingClass
+#ifndef MAX_DEVICES
 #define MAX_DEVICES 4
+#endif
 
 //Default Pin for module:
 #define DEFAULT_RST_PIN 9
@@ -52,8 +95,15 @@
 //Default value
 //in ms
 #define DEFAULT_RESET_PERIOD 200
+//in ms, a device in the middle of an exchange for longer has failed
+#define PROTOCOL_TIMEOUT 2000
 //in us
 #define DEFAULT_REPLY_DELAY_TIME 7000
+//in us, added to the measured turnaround and between reply slots (SPI write of
+//the frame, interrupt latency of the receiver)
+#define REPLY_DELAY_MARGIN 300
+//in us after its delay, longest a reply can take to go out (a whole frame at 110 kb/s)
+#define REPLY_TRANSMIT_TIMEOUT 10000
 
 //sketch type (anchor or tag)
 #define TAG 0
@@ -62,27 +112,53 @@
 //default timer delay
 #define DEFAULT_TIMER_DELAY 80
 
+//in superframes, how often a tag with a slot BLINKs for anchors it does not know yet
+#define SUPERFRAME_BLINK_PERIOD 8
+
 //debug mode
 #ifndef DEBUG
 #define DEBUG false
 #endif
 
-// NEW: Message queue structure for concurrent processing
+// Message queue structure for concurrent processing
 struct MessageQueueItem {
-	byte data[LEN_DATA];
+	byte data[LEN_FRAME_MAX];
+	uint16_t length; // bytes of data received, at most LEN_FRAME_MAX
+	DW1000RxDiagnostics rx; // timestamp and quality registers of this frame
 	byte sourceAddress[2];
-	uint32_t timestamp;
+	uint32_t timestamp; // micros() when the interrupt handler started on it
 	int messageType;
+	int32_t carrierIntegrator; // clock offset to the sender, RESPONSE only
 	boolean processed;
 };
 
+//power of two up to 128
+#ifndef MESSAGE_QUEUE_SIZE
 #define MESSAGE_QUEUE_SIZE 8
+#endif
+//messages handled per loop(), by default a full queue
+#define DEFAULT_MESSAGE_BUDGET MESSAGE_QUEUE_SIZE
 
-class DW1000RangingClass {
+/*
+ * Ranging protocol with a device table of Capacity entries of DeviceState.
+ *
+ * DeviceState is DW1000Device (tag or anchor), DW1000AnchorDevice or
+ * DW1000TagDevice (see DW1000Device.h). A node which is always an anchor can
+ * e.g. serve 64 tags with
+ *     DW1000RangingT<64, DW1000AnchorDevice> ranging;
+ * and keeps 3 instead of 6 timestamps per tag. All members are static, use
+ * only one instantiation per sketch. DW1000Ranging is the default one.
+ */
+template<uint8_t Capacity, class DeviceState>
+class DW1000RangingT {
 public:
+	static_assert(Capacity > 0 && Capacity <= 128, "Capacity must fit the int8_t device index");
+	
+	typedef DeviceState Device;
+	
 	//variables
 	// data buffer
-	static byte data[LEN_DATA];
+	static byte data[LEN_FRAME_MAX];
 	
 	//initialisation
 	static void    initCommunication(uint8_t myRST = DEFAULT_RST_PIN, uint8_t mySS = DEFAULT_SPI_SS_PIN, uint8_t myIRQ = 2);
@@ -90,13 +166,53 @@ public:
 	static void    generalStart();
 	static void    startAsAnchor(char address[], const byte mode[], const bool randomShortAddress = true);
 	static void    startAsTag(char address[], const byte mode[], const bool randomShortAddress = true);
-	static boolean addNetworkDevices(DW1000Device* device, boolean shortAddress);
-	static boolean addNetworkDevices(DW1000Device* device);
+	static boolean addNetworkDevices(DeviceState* device, boolean shortAddress);
+	static boolean addNetworkDevices(DeviceState* device);
 	static void    removeNetworkDevices(int16_t index);
 	
 	//setters
 	static void setReplyTime(uint16_t replyDelayTimeUs);
 	static void setResetPeriod(uint32_t resetPeriod);
+	// at most budget queued messages are handled per loop() (>= 1), the rest
+	// waits for the next one. 1 is one message per loop()
+	static void setMessageBudget(uint8_t budget);
+	// receive into two buffers (DW1000Class::setDoubleBuffering()): the chip
+	// keeps receiving while the interrupt handler reads the previous frame, so
+	// replies closer together than that read are not lost. Off by default, call
+	// before startAsAnchor()/startAsTag(). Refused (false) with
+	// RANGING_SINGLE_SIDED: the carrier integrator is not double buffered, the
+	// one read for a frame may be the next frame's already
+	static boolean useDoubleBuffering(boolean enabled);
+	// frames of up to 1023 bytes (DW1000Class::useExtendedFrameLength()),
+	// what the buffers take is LEN_FRAME_MAX. Tag and anchors have to agree,
+	// off by default, call before startAsAnchor()/startAsTag()
+	static void useExtendedFrameLength(boolean enabled);
+	// exchange used from the next POLL on, RANGING_ASYMMETRIC by default.
+	// RANGING_SINGLE_SIDED is refused (false) while useDoubleBuffering() is on
+	static boolean setRangingMode(RangingMode mode);
+	static RangingMode getRangingMode() { return _rangingMode; };
+	// RANGING_ASYMMETRIC: the anchors send no RANGE_REPORT, they append the
+	// range to their POLL_ACK of the next exchange instead. One frame less per
+	// anchor and exchange, the tag gets each range one exchange later. Tag and
+	// anchors have to agree, off by default
+	static void useRangeReportInPollAck(boolean enabled);
+	// TDMA superframe. This anchor (the coordinator) broadcasts a BEACON every
+	// superframe: slot 0 is for BLINKs, then comes one slot of slotMs per tag
+	// it knows, in which only that tag POLLs. slotMs has to fit a whole
+	// exchange with all anchors (4 reply delays per anchor and a frame). 0
+	// stops the BEACONs
+	static void setCoordinator(uint16_t slotMs);
+	// TAG: POLL only in the slot the coordinator's BEACON assigns and BLINK in
+	// slot 0, instead of every timer period. Off by default
+	static void useSuperframe(boolean enabled);
+	// TAG: the first reply delay is the measured turnaround plus the preamble
+	// of the mode, the next anchor's comes one frame later, instead of
+	// (2*i+1)*DEFAULT_REPLY_DELAY_TIME. The timer period is the exchange, at
+	// least DEFAULT_TIMER_DELAY. The fixed delays fit 5 anchors in the POLL,
+	// the adaptive ones as many as their slots fit 65 ms (all 17 of a RANGE
+	// at 6.8 Mb/s); until a turnaround was measured the fixed ones apply.
+	// Off by default
+	static void useAdaptiveReplyDelay(boolean enabled);
 	
 	//getters
 	static byte* getCurrentAddress() { return _currentAddress; };
@@ -105,9 +221,20 @@ public:
 	
 	static uint8_t getNetworkDevicesNumber() { return _networkDevicesNumber; };
 	
+	// us from the interrupt of a received frame until our answer to it was
+	// written (TAG: or an anchor took to answer our POLL), peak value decaying
+	// by 1/32 per measurement
+	static uint32_t getTurnaroundTime() { return _turnaroundUs; };
+	// TAG: us from the last complete POLL until the last reply of its exchange
+	static uint32_t getCycleTime() { return _cycleTimeUs; };
+	
 	//ranging functions
 	static int16_t detectMessageType(byte datas[]); // TODO check return type
 	static void loop();
+	// millis() at which loop() has timed work again (timer tick, protocol
+	// deadline, reset, queued reply), the MCU may sleep until then unless a
+	// frame arrives
+	static uint32_t getNextWakeup();
 	static void useRangeFilter(boolean enabled);
 	// Used for the smoothing algorithm (Exponential Moving Average). newValue must be >= 2. Default 15.
 	static void setRangeFilterValue(uint16_t newValue);
@@ -115,31 +242,40 @@ public:
 	//Handlers:
 	static void attachNewRange(void (* handleNewRange)(void)) { _handleNewRange = handleNewRange; };
 	
-	static void attachBlinkDevice(void (* handleBlinkDevice)(DW1000Device*)) { _handleBlinkDevice = handleBlinkDevice; };
+	static void attachBlinkDevice(void (* handleBlinkDevice)(DeviceState*)) { _handleBlinkDevice = handleBlinkDevice; };
 	
-	static void attachNewDevice(void (* handleNewDevice)(DW1000Device*)) { _handleNewDevice = handleNewDevice; };
+	static void attachNewDevice(void (* handleNewDevice)(DeviceState*)) { _handleNewDevice = handleNewDevice; };
 	
-	static void attachInactiveDevice(void (* handleInactiveDevice)(DW1000Device*)) { _handleInactiveDevice = handleInactiveDevice; };
+	static void attachInactiveDevice(void (* handleInactiveDevice)(DeviceState*)) { _handleInactiveDevice = handleInactiveDevice; };
 	
-	// NEW: Multi-anchor specific handlers
-	static void attachRangeComplete(void (* handleRangeComplete)(DW1000Device*)) { _handleRangeComplete = handleRangeComplete; };
+	// Multi-anchor specific handlers
+	static void attachRangeComplete(void (* handleRangeComplete)(DeviceState*)) { _handleRangeComplete = handleRangeComplete; };
 	
-	static void attachProtocolError(void (* handleProtocolError)(DW1000Device*, int)) { _handleProtocolError = handleProtocolError; };
+	static void attachProtocolError(void (* handleProtocolError)(DeviceState*, int)) { _handleProtocolError = handleProtocolError; };
 	
-	static DW1000Device* getDistantDevice();
-	static DW1000Device* searchDistantDevice(byte shortAddress[]);
+	static DeviceState* getNetworkDevice(uint8_t index);
+	static DeviceState* getDistantDevice();
+	static DeviceState* searchDistantDevice(byte shortAddress[]);
 	
-	// NEW: Multi-anchor support methods
+	// Multi-anchor support methods
 	static void processDeviceMessages();
 	static void handleDeviceTimeout();
 	static boolean isAnyDeviceActive();
 	static void resetAllDeviceStates();
 	static int getActiveDeviceCount();
 	
-	// NEW: Message queue methods
+	// Message queue methods
 	static boolean enqueueMessage(byte data[], byte sourceAddress[], int messageType);
 	static boolean dequeueMessage(MessageQueueItem* item);
 	static void clearMessageQueue();
+	// messages waiting now / at most since the last reset, and received
+	// messages lost because the queue was full
+	static uint8_t getMessageQueueDepth() { return _messageQueue.size(); };
+	static uint8_t getMessageQueueMaxDepth() { return _messageQueue.maxDepth(); };
+	static uint32_t getDroppedMessages() { return _messageQueue.dropped(); };
+	static void resetMessageQueueStats() { _messageQueue.resetStats(); };
+	// called with the time in us each handled message waited in the queue
+	static void attachQueueLatency(void (* handleQueueLatency)(uint32_t)) { _handleQueueLatency = handleQueueLatency; };
 	
 	//FOR DEBUGGING
 	static void visualizeDatas(byte datas[]);
@@ -147,8 +283,37 @@ public:
 
 private:
 	//other devices in the network
-	static DW1000Device _networkDevices[MAX_DEVICES];
+	static DeviceState _networkDevices[Capacity];
 	static volatile uint8_t _networkDevicesNumber;
+	// devices keep their slot in _networkDevices while they are known.
+	// _deviceSlots[0.._networkDevicesNumber-1] are the used slots in network order,
+	// the rest is the free list
+	static uint8_t      _deviceSlots[Capacity];
+	static DW1000DeviceIndex<Capacity> _deviceIndex;
+	// hot fields of the devices in network order (same index as _deviceSlots),
+	// what the periodic sweeps read; the devices point into it
+	static DW1000DeviceHot _deviceHot[Capacity];
+	// per slot: when the device times out in the protocol / becomes inactive.
+	// Deadlines are only ever early, they move on when found not expired
+	static DW1000DeadlineHeap<Capacity> _protocolDeadlines;
+	static DW1000DeadlineHeap<Capacity> _inactivityDeadlines;
+	// ANCHOR, per slot: when our reply to the tag (or RANGING_INIT to a new
+	// one) is due (micros()). Replies wait in it while the transmitter still
+	// has another one
+	static DW1000DeadlineHeap<Capacity> _replyQueue;
+	static volatile boolean _transmittingReply;
+	static uint32_t         _replyTransmitEnd;
+	// micros() of the interrupt of the frame being handled
+	static uint32_t         _rxMicros;
+	static boolean          _adaptiveReplyDelay;
+	static uint32_t         _turnaroundUs;
+	// TAG: the anchors' answer latency, spread peak value and this exchange's
+	static uint32_t         _latencySpreadUs;
+	static uint32_t         _cycleLatencyMin;
+	static uint32_t         _cycleLatencyMax;
+	static uint32_t         _pollMicros;
+	static uint32_t         _lastReplyMicros;
+	static uint32_t         _cycleTimeUs;
 	static int16_t      _lastDistantDevice;
 	static byte         _currentAddress[8];
 	static byte         _currentShortAddress[2];
@@ -159,30 +324,46 @@ private:
 	
 	//Handlers:
 	static void (* _handleNewRange)(void);
-	static void (* _handleBlinkDevice)(DW1000Device*);
-	static void (* _handleNewDevice)(DW1000Device*);
-	static void (* _handleInactiveDevice)(DW1000Device*);
+	static void (* _handleBlinkDevice)(DeviceState*);
+	static void (* _handleNewDevice)(DeviceState*);
+	static void (* _handleInactiveDevice)(DeviceState*);
 	
-	// NEW: Multi-anchor specific handlers
-	static void (* _handleRangeComplete)(DW1000Device*);
-	static void (* _handleProtocolError)(DW1000Device*, int);
+	// Multi-anchor specific handlers
+	static void (* _handleRangeComplete)(DeviceState*);
+	static void (* _handleProtocolError)(DeviceState*, int);
 	
 	//sketch type (tag or anchor)
 	static int16_t          _type; //0 for tag and 1 for anchor
 	
-	// REMOVED: Global protocol state variables (now per-device)
-	// static volatile byte    _expectedMsgId;
-	// static volatile boolean _sentAck;
-	// static volatile boolean _receivedAck;
-	// static boolean          _protocolFailed;
-	
-	// NEW: Message queue for concurrent processing
-	static MessageQueueItem _messageQueue[MESSAGE_QUEUE_SIZE];
-	static volatile uint8_t _queueHead;
-	static volatile uint8_t _queueTail;
-	static volatile uint8_t _queueCount;
-	
-	// NEW: Current processing device index for round-robin
+	// Message queue for concurrent processing
+	// handleReceived() (ISR) reads the frame into its slot, loop() handles
+	// it in place
+	static DW1000MessageQueue<MessageQueueItem, MESSAGE_QUEUE_SIZE> _messageQueue;
+	static uint8_t _messageBudget;
+	static boolean _doubleBuffering;
+	static boolean _extendedFrameLength;
+	static RangingMode _rangingMode;
+	static boolean _rangeReportInPollAck;
+	// superframe: slot length of the BEACONs we send (0: not the coordinator)
+	// and of the last one sent or heard, when our next POLL/BLINK is due
+	static uint16_t _coordinatorSlotMs;
+	static boolean  _superframe;
+	static uint16_t _slotMs;
+	static uint32_t _superframeLength;
+	static uint32_t _beaconTime;
+	static boolean  _pollPending;
+	static uint32_t _pollTime;
+	static boolean  _blinkPending;
+	static uint32_t _blinkTime;
+	static uint8_t  _superframesSinceBlink;
+	// superframes to wait before the next BLINK without a slot, drawn from _blinkWindow
+	static uint8_t  _blinkBackoff;
+	static uint8_t  _blinkWindow;
+	// ms without a frame after which a device is removed, longer than a superframe
+	static uint32_t _inactivityTime;
+	static void (* _handleQueueLatency)(uint32_t);
+	
+	// Current processing device index for round-robin
 	static uint8_t _currentProcessingDevice;
 	
 	// reset line to the chip
@@ -191,7 +372,9 @@ private:
 	// watchdog and reset period
 	static uint32_t    _lastActivity;
 	static uint32_t    _resetPeriod;
-	// reply times (same on both sides for symm. ranging)
+	// setReplyTime(), the exchange does not use it: the tag gives every
+	// anchor its reply time in the POLL (replyDelay()), the anchor keeps it
+	// per tag (DW1000DeviceBase::getReplyTime())
 	static uint16_t     _replyDelayTimeUS;
 	//timer Tick delay
 	static uint16_t     _timerDelay;
@@ -219,33 +402,95 @@ private:
 	static void checkForReset();
 	static void checkForInactiveDevices();
 	static void copyShortAddress(byte address1[], byte address2[]);
+	// deadline, or one period from now if it already passed
+	static uint32_t nextDeadline(uint32_t deadline, uint32_t now, uint32_t period) {
+		return (int32_t)(deadline-now) >= 0 ? deadline : now+period;
+	}
+	static DeviceState* insertNetworkDevice(DeviceState* device);
+	static void clearNetworkDevices();
 	
-	// NEW: Per-device message processing
-	static void processDeviceMessage(DW1000Device* device, byte data[], int messageType);
-	static void handleDeviceProtocolState(DW1000Device* device, int messageType);
+	// Per-device message processing
+	static void processDeviceMessage(DeviceState* device, MessageQueueItem* item);
+	static void handleDeviceProtocolState(DeviceState* device, MessageQueueItem* item);
 	
 	//for ranging protocole (ANCHOR)
 	static void transmitInit();
 	static void transmit(byte datas[]);
 	static void transmit(byte datas[], DW1000Time time);
 	static void transmitBlink();
-	static void transmitRangingInit(DW1000Device* myDistantDevice);
-	static void transmitPollAck(DW1000Device* myDistantDevice);
-	static void transmitRangeReport(DW1000Device* myDistantDevice);
-	static void transmitRangeFailed(DW1000Device* myDistantDevice);
+	static void transmitRangingInit(DeviceState* myDistantDevice);
+	static void scheduleReply(DeviceState* myDistantDevice, uint8_t messageType, uint32_t replyDelayTimeUs);
+	static void transmitPendingReply();
+	// a frame of ours is programmed and not sent yet, starting another
+	// transmission would drop it
+	static boolean transmitterBusy() {
+		return _transmittingReply && (int32_t)(micros()-_replyTransmitEnd) < 0;
+	};
+	static void holdTransmitter(uint32_t delayUs) {
+		_transmittingReply = true;
+		_replyTransmitEnd  = micros()+delayUs+REPLY_TRANSMIT_TIMEOUT;
+	};
+	static void transmitPollAck(DeviceState* myDistantDevice, uint16_t replyDelayTimeUs);
+	static void transmitResponse(DeviceState* myDistantDevice, uint16_t replyDelayTimeUs);
+	static void transmitRangeReport(DeviceState* myDistantDevice, uint16_t replyDelayTimeUs);
+	static void transmitRangeTimes(DeviceState* myDistantDevice, uint16_t replyDelayTimeUs);
+	static void transmitRangeFailed(DeviceState* myDistantDevice);
+	static void transmitBeacon();
+	static void handleBeacon(MessageQueueItem* item);
 	static void receiver();
 	
 	//for ranging protocole (TAG)
-	static void transmitPoll(DW1000Device* myDistantDevice);
-	static void transmitRange(DW1000Device* myDistantDevice);
+	// broadcast to all known devices
+	static void transmitPoll();
+	static void pollNetworkDevices();
+	static void transmitRange();
 	
 	//methods for range computation
-	static void computeRangeAsymmetric(DW1000Device* myDistantDevice, DW1000Time* myTOF);
+	static void computeRangeAsymmetric(DeviceState* myDistantDevice, DW1000Time* myTOF);
+	static void computeRangeSingleSided(DeviceState* myDistantDevice, const byte anchorTimes[], int32_t carrierIntegrator, DW1000Time* myTOF);
+	static void computeRangesOnTag();
+	// what the tag waits for after its POLL
+	static MessageType replyMessage() { return _rangingMode == RANGING_SINGLE_SIDED ? MSG_RESPONSE : MSG_POLL_ACK; };
+	// the anchors report ranges with the next POLL_ACK
+	static boolean reportInPollAck() { return _rangingMode == RANGING_ASYMMETRIC && _rangeReportInPollAck; };
+	// reply slots an exchange takes per anchor: 3 with a RANGE_REPORT/RANGE_TIMES
+	static uint8_t slotsPerDevice() { return (_rangingMode == RANGING_SINGLE_SIDED || reportInPollAck()) ? 2 : 3; };
+	// TAG: anchors one broadcast RANGE carries and we can give a reply slot,
+	// at least one (its reply time is then cut to the 16 bits)
+	static uint8_t maxRangeDevices() {
+		uint16_t frame = _extendedFrameLength || LEN_FRAME_MAX < LEN_UWB_FRAMES-2 ? LEN_FRAME_MAX : LEN_UWB_FRAMES-2;
+		uint8_t  range = (frame-RANGE_HEADER_LEN)/RANGE_ANCHOR_LEN;
+		uint8_t  slots = replySlots();
+		if(slots == 0) {
+			slots = 1;
+		}
+		return slots < range ? slots : range;
+	};
+	// RANGE_REPORT, or the one in a POLL_ACK: range in mm (int32) and RX
+	// power in 1/100 dBm (int16)
+	static void handleRangeReport(DeviceState* device, const byte report[]);
+	// reply timing
+	static void noteTurnaround(uint32_t turnaroundUs);
+	static void noteReplyLatency(DeviceState* device);
+	// TAG: the reply time of the anchor in slot i, and the timer period
+	static uint32_t replyDelay(uint8_t slot);
+	// TAG: slots whose reply time fits the 16 bits of the POLL
+	static uint8_t replySlots();
+	static uint16_t cycleTimerDelay();
+	// the shortest delay a reply can still go out with in this mode
+	static uint32_t minReplyDelay();
 	
 	static void timerTick();
 	
 	//Utils
 	static float filterValue(float value, float previousValue, uint16_t numberOfElements);
+	static int32_t filterValue(int32_t value, int32_t previousValue, uint16_t numberOfElements);
 };
 
+typedef DW1000RangingT<MAX_DEVICES, DW1000Device> DW1000RangingClass;
+
 extern DW1000RangingClass DW1000Ranging;
+
+#include "DW1000RangingImpl.h"
+
+#endif
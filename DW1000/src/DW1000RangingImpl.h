@@ -0,0 +1,1911 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net> and Leopold Sayous <leosayous@gmail.com>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000RangingImpl.h
+ * Arduino global library (template definitions) working with the DW1000 library
+ * for the Decawave DW1000 UWB transceiver IC. Included by DW1000Ranging.h,
+ * every DW1000RangingT<Capacity, DeviceState> is instantiated where it is used.
+ *
+ * @TODO
+ * - remove or debugmode for Serial.print
+ * - move strings to flash to reduce ram usage
+ * - do not safe duplicate of pin settings
+ * - maybe other object structure
+ * - use enums instead of preprocessor constants
+ */
+
+
+#ifndef _DW1000RangingImpl_H_INCLUDED
+#define _DW1000RangingImpl_H_INCLUDED
+
+
+//other devices we are going to communicate with which are on our network:
+template<uint8_t Capacity, class DeviceState>
+DeviceState DW1000RangingT<Capacity, DeviceState>::_networkDevices[Capacity];
+template<uint8_t Capacity, class DeviceState>
+byte         DW1000RangingT<Capacity, DeviceState>::_currentAddress[8];
+template<uint8_t Capacity, class DeviceState>
+byte         DW1000RangingT<Capacity, DeviceState>::_currentShortAddress[2];
+template<uint8_t Capacity, class DeviceState>
+byte         DW1000RangingT<Capacity, DeviceState>::_lastSentToShortAddress[2];
+template<uint8_t Capacity, class DeviceState>
+volatile uint8_t DW1000RangingT<Capacity, DeviceState>::_networkDevicesNumber = 0; // TODO short, 8bit?
+template<uint8_t Capacity, class DeviceState>
+uint8_t      DW1000RangingT<Capacity, DeviceState>::_deviceSlots[Capacity];
+template<uint8_t Capacity, class DeviceState>
+DW1000DeviceIndex<Capacity> DW1000RangingT<Capacity, DeviceState>::_deviceIndex;
+template<uint8_t Capacity, class DeviceState>
+DW1000DeviceHot DW1000RangingT<Capacity, DeviceState>::_deviceHot[Capacity];
+template<uint8_t Capacity, class DeviceState>
+DW1000DeadlineHeap<Capacity> DW1000RangingT<Capacity, DeviceState>::_protocolDeadlines;
+template<uint8_t Capacity, class DeviceState>
+DW1000DeadlineHeap<Capacity> DW1000RangingT<Capacity, DeviceState>::_inactivityDeadlines;
+template<uint8_t Capacity, class DeviceState>
+DW1000DeadlineHeap<Capacity> DW1000RangingT<Capacity, DeviceState>::_replyQueue;
+template<uint8_t Capacity, class DeviceState>
+volatile boolean DW1000RangingT<Capacity, DeviceState>::_transmittingReply = false;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_replyTransmitEnd = 0;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_rxMicros = 0;
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::_adaptiveReplyDelay = false;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_turnaroundUs = 0;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_latencySpreadUs = 0;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_cycleLatencyMin = UINT32_MAX;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_cycleLatencyMax = 0;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_pollMicros = 0;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_lastReplyMicros = 0;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_cycleTimeUs = 0;
+template<uint8_t Capacity, class DeviceState>
+int16_t      DW1000RangingT<Capacity, DeviceState>::_lastDistantDevice    = 0; // TODO short, 8bit?
+template<uint8_t Capacity, class DeviceState>
+DW1000Mac    DW1000RangingT<Capacity, DeviceState>::_globalMac;
+
+//module type (anchor or tag)
+template<uint8_t Capacity, class DeviceState>
+int16_t      DW1000RangingT<Capacity, DeviceState>::_type; // TODO enum??
+
+// range filter
+template<uint8_t Capacity, class DeviceState>
+volatile boolean DW1000RangingT<Capacity, DeviceState>::_useRangeFilter = false;
+template<uint8_t Capacity, class DeviceState>
+uint16_t DW1000RangingT<Capacity, DeviceState>::_rangeFilterValue = 15;
+
+// Message queue for concurrent processing
+template<uint8_t Capacity, class DeviceState>
+DW1000MessageQueue<MessageQueueItem, MESSAGE_QUEUE_SIZE> DW1000RangingT<Capacity, DeviceState>::_messageQueue;
+template<uint8_t Capacity, class DeviceState>
+uint8_t DW1000RangingT<Capacity, DeviceState>::_messageBudget = DEFAULT_MESSAGE_BUDGET;
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::_doubleBuffering = false;
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::_extendedFrameLength = false;
+template<uint8_t Capacity, class DeviceState>
+RangingMode DW1000RangingT<Capacity, DeviceState>::_rangingMode = RANGING_ASYMMETRIC;
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::_rangeReportInPollAck = false;
+template<uint8_t Capacity, class DeviceState>
+uint16_t DW1000RangingT<Capacity, DeviceState>::_coordinatorSlotMs = 0;
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::_superframe = false;
+template<uint8_t Capacity, class DeviceState>
+uint16_t DW1000RangingT<Capacity, DeviceState>::_slotMs = 0;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_superframeLength = 0;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_beaconTime = 0;
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::_pollPending = false;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_pollTime = 0;
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::_blinkPending = false;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_blinkTime = 0;
+template<uint8_t Capacity, class DeviceState>
+uint8_t DW1000RangingT<Capacity, DeviceState>::_superframesSinceBlink = 0;
+template<uint8_t Capacity, class DeviceState>
+uint8_t DW1000RangingT<Capacity, DeviceState>::_blinkBackoff = 0;
+template<uint8_t Capacity, class DeviceState>
+uint8_t DW1000RangingT<Capacity, DeviceState>::_blinkWindow = 1;
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::_inactivityTime = INACTIVITY_TIME;
+template<uint8_t Capacity, class DeviceState>
+void (* DW1000RangingT<Capacity, DeviceState>::_handleQueueLatency)(uint32_t) = 0;
+
+// Current processing device index for round-robin
+template<uint8_t Capacity, class DeviceState>
+uint8_t DW1000RangingT<Capacity, DeviceState>::_currentProcessingDevice = 0;
+
+// timestamps to remember
+template<uint8_t Capacity, class DeviceState>
+int32_t            DW1000RangingT<Capacity, DeviceState>::timer           = 0;
+template<uint8_t Capacity, class DeviceState>
+int16_t            DW1000RangingT<Capacity, DeviceState>::counterForBlink = 0; // TODO 8 bit?
+
+
+// data buffer
+template<uint8_t Capacity, class DeviceState>
+byte          DW1000RangingT<Capacity, DeviceState>::data[LEN_FRAME_MAX];
+// reset line to the chip
+template<uint8_t Capacity, class DeviceState>
+uint8_t   DW1000RangingT<Capacity, DeviceState>::_RST;
+template<uint8_t Capacity, class DeviceState>
+uint8_t   DW1000RangingT<Capacity, DeviceState>::_SS;
+// watchdog and reset period
+template<uint8_t Capacity, class DeviceState>
+uint32_t  DW1000RangingT<Capacity, DeviceState>::_lastActivity;
+template<uint8_t Capacity, class DeviceState>
+uint32_t  DW1000RangingT<Capacity, DeviceState>::_resetPeriod;
+// reply time of setReplyTime()
+template<uint8_t Capacity, class DeviceState>
+uint16_t  DW1000RangingT<Capacity, DeviceState>::_replyDelayTimeUS;
+//timer delay
+template<uint8_t Capacity, class DeviceState>
+uint16_t  DW1000RangingT<Capacity, DeviceState>::_timerDelay;
+// ranging counter (per second)
+template<uint8_t Capacity, class DeviceState>
+uint16_t  DW1000RangingT<Capacity, DeviceState>::_successRangingCount = 0;
+template<uint8_t Capacity, class DeviceState>
+uint32_t  DW1000RangingT<Capacity, DeviceState>::_rangingCountPeriod  = 0;
+//Here our handlers
+template<uint8_t Capacity, class DeviceState>
+void (* DW1000RangingT<Capacity, DeviceState>::_handleNewRange)(void) = 0;
+template<uint8_t Capacity, class DeviceState>
+void (* DW1000RangingT<Capacity, DeviceState>::_handleBlinkDevice)(DeviceState*) = 0;
+template<uint8_t Capacity, class DeviceState>
+void (* DW1000RangingT<Capacity, DeviceState>::_handleNewDevice)(DeviceState*) = 0;
+template<uint8_t Capacity, class DeviceState>
+void (* DW1000RangingT<Capacity, DeviceState>::_handleInactiveDevice)(DeviceState*) = 0;
+
+// Multi-anchor specific handlers
+template<uint8_t Capacity, class DeviceState>
+void (* DW1000RangingT<Capacity, DeviceState>::_handleRangeComplete)(DeviceState*) = 0;
+template<uint8_t Capacity, class DeviceState>
+void (* DW1000RangingT<Capacity, DeviceState>::_handleProtocolError)(DeviceState*, int) = 0;
+
+/* ###########################################################################
+ * #### Init and end #######################################################
+ * ######################################################################### */
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::initCommunication(uint8_t myRST, uint8_t mySS, uint8_t myIRQ) {
+	// reset line to the chip
+	_RST              = myRST;
+	_SS               = mySS;
+	_resetPeriod      = DEFAULT_RESET_PERIOD;
+	// the tag gives every anchor its own in the POLL
+	_replyDelayTimeUS = DEFAULT_REPLY_DELAY_TIME;
+	//we set our timer delay
+	_timerDelay       = DEFAULT_TIMER_DELAY;
+	
+	// Initialize message queue and device table
+	clearMessageQueue();
+	clearNetworkDevices();
+	
+	DW1000.begin(myIRQ, myRST);
+	DW1000.select(mySS);
+}
+
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::configureNetwork(uint16_t deviceAddress, uint16_t networkId, const byte mode[]) {
+	// general configuration
+	DW1000.newConfiguration();
+	DW1000.setDefaults();
+	DW1000.setDeviceAddress(deviceAddress);
+	DW1000.setNetworkId(networkId);
+	DW1000.enableMode(mode);
+	DW1000.useExtendedFrameLength(_extendedFrameLength);
+	DW1000.commitConfiguration();
+	
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::generalStart() {
+	// attach callback for (successfully) sent and received messages
+	DW1000.attachSentHandler(handleSent);
+	DW1000.attachReceivedHandler(handleReceived);
+	// anchor starts in receiving mode, awaiting a ranging poll message
+	
+	
+	if(DEBUG) {
+		// DEBUG monitoring
+		Serial.println("DW1000-arduino");
+		// initialize the driver
+		
+		
+		Serial.println("configuration..");
+		// DEBUG chip info and registers pretty printed
+		char msg[90];
+		DW1000.getPrintableDeviceIdentifier(msg);
+		Serial.print("Device ID: ");
+		Serial.println(msg);
+		DW1000.getPrintableExtendedUniqueIdentifier(msg);
+		Serial.print("Unique ID: ");
+		Serial.print(msg);
+		char string[6];
+		sprintf(string, "%02X:%02X", _currentShortAddress[0], _currentShortAddress[1]);
+		Serial.print(" short: ");
+		Serial.println(string);
+		
+		DW1000.getPrintableNetworkIdAndShortAddress(msg);
+		Serial.print("Network ID & Device Address: ");
+		Serial.println(msg);
+		DW1000.getPrintableDeviceMode(msg);
+		Serial.print("Device mode: ");
+		Serial.println(msg);
+	}
+	
+	// Vincent changes
+	DW1000.large_power_init();
+	
+	// anchor starts in receiving mode, awaiting a ranging poll message
+	receiver();
+	// for first time ranging frequency computation
+	_rangingCountPeriod = millis();
+}
+
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::startAsAnchor(char address[], const byte mode[], const bool randomShortAddress) {
+	//save the address
+	DW1000.convertToByte(address, _currentAddress);
+	//write the address on the DW1000 chip
+	DW1000.setEUI(address);
+	Serial.print("device address: ");
+	Serial.println(address);
+	if (randomShortAddress) {
+		//we need to define a random short address:
+		randomSeed(analogRead(0));
+		_currentShortAddress[0] = random(0, 256);
+		_currentShortAddress[1] = random(0, 256);
+	}
+	else {
+		// we use first two bytes in addess for short address
+		_currentShortAddress[0] = _currentAddress[0];
+		_currentShortAddress[1] = _currentAddress[1];
+	}
+	
+	//we configur the network for mac filtering
+	//(device Address, network ID, frequency)
+	configureNetwork(_currentShortAddress[0]*256+_currentShortAddress[1], 0xDECA, mode);
+	
+	//general start:
+	generalStart();
+	
+	//defined type as anchor
+	_type = ANCHOR;
+	
+	Serial.println("### ANCHOR ###");
+	
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::startAsTag(char address[], const byte mode[], const bool randomShortAddress) {
+	//save the address
+	DW1000.convertToByte(address, _currentAddress);
+	//write the address on the DW1000 chip
+	DW1000.setEUI(address);
+	Serial.print("device address: ");
+	Serial.println(address);
+	if (randomShortAddress) {
+		//we need to define a random short address:
+		randomSeed(analogRead(0));
+		_currentShortAddress[0] = random(0, 256);
+		_currentShortAddress[1] = random(0, 256);
+	}
+	else {
+		// we use first two bytes in addess for short address
+		_currentShortAddress[0] = _currentAddress[0];
+		_currentShortAddress[1] = _currentAddress[1];
+	}
+	
+	//we configur the network for mac filtering
+	//(device Address, network ID, frequency)
+	configureNetwork(_currentShortAddress[0]*256+_currentShortAddress[1], 0xDECA, mode);
+	
+	generalStart();
+	//defined type as tag
+	_type = TAG;
+	
+	Serial.println("### TAG ###");
+}
+
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::addNetworkDevices(DeviceState* device, boolean shortAddress) {
+	//we test our network devices array to check
+	//we don't already have it
+	if(shortAddress) {
+		if(searchDistantDevice(device->getByteShortAddress()) != nullptr) {
+			//the device already exists
+			return false;
+		}
+	}
+	else {
+		for(uint8_t i = 0; i < _networkDevicesNumber; i++) {
+			if(getNetworkDevice(i)->isAddressEqual(device)) {
+				//the device already exists
+				return false;
+			}
+		}
+	}
+	
+	device->setRange(0);
+	return insertNetworkDevice(device) != nullptr;
+}
+
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::addNetworkDevices(DeviceState* device) {
+	//we test our network devices array to check
+	//we don't already have it
+	DeviceState* known = searchDistantDevice(device->getByteShortAddress());
+	if(known != nullptr && known->isAddressEqual(device)) {
+		//the device already exists
+		return false;
+	}
+	
+	if(known != nullptr) {
+		//short address taken by another device
+		return false;
+	}
+	return insertNetworkDevice(device) != nullptr;
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::removeNetworkDevices(int16_t index) {
+	if(index < 0 || index >= _networkDevicesNumber) {
+		return;
+	}
+	uint8_t slot = _deviceSlots[index];
+	_deviceIndex.erase(_deviceHot[index].shortAddress);
+	_protocolDeadlines.erase(slot);
+	_inactivityDeadlines.erase(slot);
+	_replyQueue.erase(slot);
+	_networkDevices[slot].setHotState(nullptr);
+	//the last device takes the place of the deleted one, the slot goes to the free list
+	uint8_t last = _networkDevicesNumber-1;
+	if(index != last) {
+		_networkDevices[_deviceSlots[last]].setHotState(&_deviceHot[index]);
+	}
+	_deviceSlots[index] = _deviceSlots[last];
+	_deviceSlots[last]  = slot;
+	_networkDevicesNumber--;
+}
+
+template<uint8_t Capacity, class DeviceState>
+DeviceState* DW1000RangingT<Capacity, DeviceState>::insertNetworkDevice(DeviceState* device) {
+	if(_networkDevicesNumber >= Capacity) {
+		return nullptr;
+	}
+	if(_type == TAG && _networkDevicesNumber >= maxRangeDevices()) {
+		// no room in our RANGE
+		return nullptr;
+	}
+	//take the first free slot, the hot fields go to the end of the hot array
+	uint8_t position = _networkDevicesNumber;
+	uint8_t slot     = _deviceSlots[position];
+	if(!_deviceIndex.insert(device->getByteShortAddress(), slot)) {
+		return nullptr;
+	}
+	_networkDevices[slot] = *device;
+	_networkDevices[slot].setHotState(&_deviceHot[position]);
+	_networkDevices[slot].setIndex(slot);
+	// Initialize per-device protocol state
+	_networkDevices[slot].resetProtocolState();
+	_protocolDeadlines.set(slot, _deviceHot[position].protocolActivity+PROTOCOL_TIMEOUT);
+	_inactivityDeadlines.set(slot, _deviceHot[position].activity+_inactivityTime);
+	_networkDevicesNumber++;
+	return &_networkDevices[slot];
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::clearNetworkDevices() {
+	for(uint8_t i = 0; i < Capacity; i++) {
+		_deviceSlots[i] = i;
+	}
+	_deviceIndex.clear();
+	_protocolDeadlines.clear();
+	_inactivityDeadlines.clear();
+	_replyQueue.clear();
+	_networkDevicesNumber = 0;
+}
+
+/* ###########################################################################
+ * #### Setters and Getters ##################################################
+ * ######################################################################### */
+
+//setters
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::setReplyTime(uint16_t replyDelayTimeUs) { _replyDelayTimeUS = replyDelayTimeUs; }
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::setResetPeriod(uint32_t resetPeriod) { _resetPeriod = resetPeriod; }
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::setMessageBudget(uint8_t budget) {
+	_messageBudget = budget < 1 ? 1 : budget;
+}
+
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::useDoubleBuffering(boolean enabled) {
+	if(enabled && _rangingMode == RANGING_SINGLE_SIDED) {
+		return false;
+	}
+	_doubleBuffering = enabled;
+	return true;
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::useExtendedFrameLength(boolean enabled) {
+	_extendedFrameLength = enabled;
+}
+
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::setRangingMode(RangingMode mode) {
+	if(mode == RANGING_SINGLE_SIDED && _doubleBuffering) {
+		// no clock offset we could trust for the RESPONSE
+		return false;
+	}
+	_rangingMode = mode;
+	return true;
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::useRangeReportInPollAck(boolean enabled) {
+	_rangeReportInPollAck = enabled;
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::setCoordinator(uint16_t slotMs) {
+	_coordinatorSlotMs = slotMs;
+	// the first BEACON goes out right away
+	_superframeLength  = 0;
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::useSuperframe(boolean enabled) {
+	_superframe   = enabled;
+	_pollPending  = false;
+	_blinkPending = false;
+	_blinkBackoff = 0;
+	_blinkWindow  = 1;
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::useAdaptiveReplyDelay(boolean enabled) {
+	_adaptiveReplyDelay = enabled;
+}
+
+
+template<uint8_t Capacity, class DeviceState>
+DeviceState* DW1000RangingT<Capacity, DeviceState>::searchDistantDevice(byte shortAddress[]) {
+	uint8_t slot = _deviceIndex.find(shortAddress);
+	if(slot == _deviceIndex.NONE) {
+		return nullptr;
+	}
+	return &_networkDevices[slot];
+}
+
+// index is the position in the network order (0.._networkDevicesNumber-1), not the slot
+template<uint8_t Capacity, class DeviceState>
+DeviceState* DW1000RangingT<Capacity, DeviceState>::getNetworkDevice(uint8_t index) {
+	return &_networkDevices[_deviceSlots[index]];
+}
+
+template<uint8_t Capacity, class DeviceState>
+DeviceState* DW1000RangingT<Capacity, DeviceState>::getDistantDevice() {
+	//we get the device which correspond to the message which was sent (need to be filtered by MAC address)
+	
+	return &_networkDevices[_lastDistantDevice];
+	
+}
+
+/* ###########################################################################
+ * #### Multi-anchor support methods #########################################
+ * ######################################################################### */
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::processDeviceMessages() {
+	// Process up to _messageBudget messages from the queue in arrival order,
+	// frames received meanwhile count against the budget too
+	MessageQueueItem* item;
+	
+	for (uint8_t handled = 0; handled < _messageBudget && (item = _messageQueue.front()) != nullptr; handled++) {
+		if (_handleQueueLatency != 0) {
+			(*_handleQueueLatency)(micros()-item->timestamp);
+		}
+		// BLINK and RANGING_INIT come from devices we do not know yet,
+		// processDeviceMessage() handles a missing device itself
+		DeviceState* device = searchDistantDevice(item->sourceAddress);
+		processDeviceMessage(device, item);
+		_messageQueue.pop();
+	}
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::handleDeviceTimeout() {
+	// Check the devices whose protocol deadline passed for timeouts. A deadline
+	// may be early (the device was active since), then it is moved on
+	uint32_t now = millis();
+	while (_protocolDeadlines.expired(now)) {
+		uint8_t      slot   = _protocolDeadlines.top();
+		DeviceState* device = &_networkDevices[slot];
+		if (device->getHotState()->isProtocolTimedOut(now, PROTOCOL_TIMEOUT)) {
+			device->handleProtocolTimeout();
+			if (_handleProtocolError != 0) {
+				(*_handleProtocolError)(device, -1); // -1 = timeout error
+			}
+			if (!_protocolDeadlines.contains(slot)) {
+				// removed by the handler
+				continue;
+			}
+		}
+		_protocolDeadlines.set(slot, nextDeadline(device->getHotState()->protocolActivity+PROTOCOL_TIMEOUT, now, PROTOCOL_TIMEOUT));
+	}
+}
+
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::isAnyDeviceActive() {
+	uint8_t number = _networkDevicesNumber;
+	for (uint8_t i = 0; i < number; i++) {
+		if (_deviceHot[i].isProtocolActive()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::resetAllDeviceStates() {
+	for (uint8_t i = 0; i < _networkDevicesNumber; i++) {
+		getNetworkDevice(i)->resetProtocolState();
+	}
+}
+
+template<uint8_t Capacity, class DeviceState>
+int DW1000RangingT<Capacity, DeviceState>::getActiveDeviceCount() {
+	int count = 0;
+	uint8_t number = _networkDevicesNumber;
+	for (uint8_t i = 0; i < number; i++) {
+		if (_deviceHot[i].isProtocolActive()) {
+			count++;
+		}
+	}
+	return count;
+}
+
+/* ###########################################################################
+ * #### Message queue methods ################################################
+ * ######################################################################### */
+
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::enqueueMessage(byte data[], byte sourceAddress[], int messageType) {
+	MessageQueueItem* item = _messageQueue.reserve();
+	if (item == nullptr) {
+		return false; // Queue full
+	}
+	
+	// Copy message data
+	memcpy(item->data, data, LEN_DATA);
+	item->length = LEN_DATA;
+	memset(&item->rx, 0, sizeof(item->rx));
+	memcpy(item->sourceAddress, sourceAddress, 2);
+	item->messageType = messageType;
+	item->carrierIntegrator = 0;
+	item->timestamp = micros();
+	item->processed = false;
+	_messageQueue.push();
+	
+	return true;
+}
+
+template<uint8_t Capacity, class DeviceState>
+boolean DW1000RangingT<Capacity, DeviceState>::dequeueMessage(MessageQueueItem* item) {
+	MessageQueueItem* front = _messageQueue.front();
+	if (front == nullptr) {
+		return false; // Queue empty
+	}
+	
+	// Copy message data
+	memcpy(item, front, sizeof(MessageQueueItem));
+	_messageQueue.pop();
+	
+	return true;
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::clearMessageQueue() {
+	_messageQueue.clear();
+}
+
+/* ###########################################################################
+ * #### Public methods #######################################################
+ * ######################################################################### */
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::checkForReset() {
+	uint32_t curMillis = millis();
+	// check if inactive, then if any device has active protocol state
+	// (only scans the devices once the reset period is over)
+	if(curMillis-_lastActivity > _resetPeriod && !isAnyDeviceActive()) {
+		resetInactive();
+	}
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::checkForInactiveDevices() {
+	//One second of inactivity, only the devices whose deadline passed
+	uint32_t now = millis();
+	while(_inactivityDeadlines.expired(now)) {
+		uint8_t      slot   = _inactivityDeadlines.top();
+		DeviceState* device = &_networkDevices[slot];
+		if(now-device->getHotState()->activity > _inactivityTime) {
+			if(_handleInactiveDevice != 0) {
+				(*_handleInactiveDevice)(device);
+			}
+			//we need to delete the device from the array
+			//(unless the handler did), its hot entry tells the position
+			if(_inactivityDeadlines.contains(slot)) {
+				removeNetworkDevices(device->getHotState()-_deviceHot);
+			}
+		}
+		else {
+			_inactivityDeadlines.set(slot, device->getHotState()->activity+_inactivityTime);
+		}
+	}
+}
+
+// TODO check return type
+template<uint8_t Capacity, class DeviceState>
+int16_t DW1000RangingT<Capacity, DeviceState>::detectMessageType(byte datas[]) {
+	if(datas[0] == FC_1_BLINK) {
+		return BLINK;
+	}
+	else if(datas[0] == FC_1 && datas[1] == FC_2) {
+		//we have a long MAC frame message (ranging init)
+		return datas[LONG_MAC_LEN];
+	}
+	else if(datas[0] == FC_1 && datas[1] == FC_2_SHORT) {
+		//we have a short mac frame message (poll, range, range report, etc..)
+		return datas[SHORT_MAC_LEN];
+	}
+	return -1;
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::loop() {
+	//we check if needed to reset !
+	checkForReset();
+	uint32_t time = millis(); // TODO other name - too close to "timer"
+	if(_type == TAG && _superframe) {
+		// only in our slot (BLINK: slot 0) of the last BEACON
+		if(_pollPending && (int32_t)(time-_pollTime) >= 0 && !transmitterBusy()) {
+			_pollPending = false;
+			pollNetworkDevices();
+		}
+		if(_blinkPending && (int32_t)(time-_blinkTime) >= 0 && !transmitterBusy()) {
+			_blinkPending = false;
+			transmitBlink();
+		}
+	}
+	else if(time-timer > _timerDelay) {
+		timer = time;
+		timerTick();
+	}
+	// after a delayed reply still waiting to go out, not instead of it
+	if(_type == ANCHOR && _coordinatorSlotMs != 0 && time-_beaconTime >= _superframeLength && !transmitterBusy()) {
+		_beaconTime = time;
+		transmitBeacon();
+	}
+	
+	// Process device messages and handle timeouts
+	processDeviceMessages();
+	handleDeviceTimeout();
+	transmitPendingReply();
+}
+
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::getNextWakeup() {
+	uint32_t now    = millis();
+	uint32_t wakeup = timer+_timerDelay+1;
+	if(_type == TAG && _superframe) {
+		// else the next BEACON wakes us
+		wakeup = now+_inactivityTime;
+		if(_pollPending && (int32_t)(_pollTime-wakeup) < 0) {
+			wakeup = _pollTime;
+		}
+		if(_blinkPending && (int32_t)(_blinkTime-wakeup) < 0) {
+			wakeup = _blinkTime;
+		}
+	}
+	if(_type == ANCHOR && _coordinatorSlotMs != 0 && (int32_t)(_beaconTime+_superframeLength-wakeup) < 0) {
+		wakeup = _beaconTime+_superframeLength;
+	}
+	if(!_replyQueue.empty()) {
+		// as soon as the transmitter is free
+		wakeup = now;
+	}
+	if(!_protocolDeadlines.empty() && (int32_t)(_protocolDeadlines.topDeadline()+1-wakeup) < 0) {
+		wakeup = _protocolDeadlines.topDeadline()+1;
+	}
+	uint32_t reset = _lastActivity+_resetPeriod+1;
+	if((int32_t)(reset-now) > 0 && (int32_t)(reset-wakeup) < 0) {
+		wakeup = reset;
+	}
+	return wakeup;
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::useRangeFilter(boolean enabled) {
+	_useRangeFilter = enabled;
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::setRangeFilterValue(uint16_t newValue) {
+	if (newValue < 2) {
+		_rangeFilterValue = 2;
+	}else{
+		_rangeFilterValue = newValue;
+	}
+}
+
+
+/* ###########################################################################
+ * #### Private methods and Handlers for transmit & Receive reply ############
+ * ######################################################################### */
+
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::handleSent() {
+	// Handle sent messages for per-device protocol state
+	// We need to identify which device this transmission relates to and update timestamps
+	
+	int messageType = detectMessageType(data);
+	// a queued reply may go out now
+	_transmittingReply = false;
+	
+	if(messageType != POLL_ACK && messageType != POLL && messageType != RANGE)
+		return;
+	
+	// A message was sent. We launch the ranging protocol when a message was sent
+	if(_type == ANCHOR) {
+		if(messageType == POLL_ACK) {
+			DeviceState* myDistantDevice = searchDistantDevice(_lastSentToShortAddress);
+			
+			if (myDistantDevice) {
+				DW1000.getTransmitTimestamp(myDistantDevice->timePollAckSent);
+				myDistantDevice->setSentAck(true);
+			}
+		}
+	}
+	else if(_type == TAG) {
+		if(messageType == POLL) {
+			DW1000Time timePollSent;
+			DW1000.getTransmitTimestamp(timePollSent);
+			// If the last device we sent the POLL to is broadcast:
+			if(_lastSentToShortAddress[0] == 0xFF && _lastSentToShortAddress[1] == 0xFF) {
+				// We save the value for all the devices!
+				for(uint16_t i = 0; i < _networkDevicesNumber; i++) {
+					getNetworkDevice(i)->timePollSent = timePollSent;
+					getNetworkDevice(i)->setSentAck(true);
+				}
+			}
+			else {
+				// We search the device associated with the last sent address
+				DeviceState* myDistantDevice = searchDistantDevice(_lastSentToShortAddress);
+				// We save the value just for one device
+				if (myDistantDevice) {
+					myDistantDevice->timePollSent = timePollSent;
+					myDistantDevice->setSentAck(true);
+				}
+			}
+		}
+		else if(messageType == RANGE) {
+			DW1000Time timeRangeSent;
+			DW1000.getTransmitTimestamp(timeRangeSent);
+			// If the last device we sent the RANGE to is broadcast:
+			if(_lastSentToShortAddress[0] == 0xFF && _lastSentToShortAddress[1] == 0xFF) {
+				// We save the value for all the devices!
+				for(uint16_t i = 0; i < _networkDevicesNumber; i++) {
+					getNetworkDevice(i)->timeRangeSent = timeRangeSent;
+					getNetworkDevice(i)->setSentAck(true);
+				}
+			}
+			else {
+				// We search the device associated with the last sent address
+				DeviceState* myDistantDevice = searchDistantDevice(_lastSentToShortAddress);
+				// We save the value just for one device
+				if (myDistantDevice) {
+					myDistantDevice->timeRangeSent = timeRangeSent;
+					myDistantDevice->setSentAck(true);
+				}
+			}
+		}
+	}
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::handleReceived() {
+	// enqueue the message for processing
+	MessageQueueItem* item = _messageQueue.reserve();
+	if(item == nullptr) {
+		// queue full, the frame is dropped without reading it
+		return;
+	}
+	// timestamp and quality of this frame, before the next one overwrites
+	// them (double buffered: from the host side buffer, the chip receives
+	// into the other one meanwhile and gets this one back when the interrupt
+	// handler returns), then only the received bytes straight into the queue slot
+	DW1000.readRxDiagnostics(item->rx);
+	uint16_t length = DW1000.getDataLength(item->rx);
+	if(length > LEN_FRAME_MAX) {
+		length = LEN_FRAME_MAX;
+	}
+	DW1000.getData(item->data, length);
+	item->length = length;
+	
+	item->messageType = detectMessageType(item->data);
+	if(item->messageType == RESPONSE) {
+		// before the next frame changes it
+		item->carrierIntegrator = DW1000.readCarrierIntegrator();
+	}
+	
+	// Extract source address based on message type
+	if(item->messageType == BLINK) {
+		byte address[8];
+		_globalMac.decodeBlinkFrame(item->data, address, item->sourceAddress);
+	} else if(item->messageType == RANGING_INIT) {
+		_globalMac.decodeLongMACFrame(item->data, item->sourceAddress);
+	} else {
+		_globalMac.decodeShortMACFrame(item->data, item->sourceAddress);
+	}
+	
+	// Publish the message for processing, the turnaround counts from the
+	// interrupt (before the reads above)
+	item->timestamp = DW1000.getInterruptMicros();
+	item->processed = false;
+	_messageQueue.push();
+}
+
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::noteActivity() {
+	// update activity timestamp, so that we do not reach "resetPeriod"
+	_lastActivity = millis();
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::resetInactive() {
+	//if inactive
+	if(_type == ANCHOR) {
+		// reset the expected message of all devices
+		for (uint8_t i = 0; i < _networkDevicesNumber; i++) {
+			_deviceHot[i].expectedMessage = MSG_POLL;
+		}
+		receiver();
+	}
+	noteActivity();
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::timerTick() {
+	if(_networkDevicesNumber > 0 && counterForBlink != 0) {
+		if(_type == TAG) {
+			if(transmitterBusy()) {
+				// our RANGE is still to go out, POLL on the next tick
+				return;
+			}
+			pollNetworkDevices();
+		}
+	}
+	else if(counterForBlink == 0) {
+		if(_type == TAG) {
+			if(transmitterBusy()) {
+				// our RANGE is still to go out, BLINK on the next tick
+				return;
+			}
+			transmitBlink();
+		}
+		//check for inactive devices if we are a TAG or ANCHOR
+		checkForInactiveDevices();
+	}
+	counterForBlink++;
+	if(counterForBlink > 20) {
+		counterForBlink = 0;
+	}
+}
+
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::copyShortAddress(byte address1[], byte address2[]) {
+	*address1     = *address2;
+	*(address1+1) = *(address2+1);
+}
+
+/* ###########################################################################
+ * #### Per-device message processing ########################################
+ * ######################################################################### */
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::processDeviceMessage(DeviceState* device, MessageQueueItem* item) {
+	// This method processes messages for a specific device
+	// Implementation varies based on device type (anchor/tag) and message type
+	byte* data        = item->data;
+	int   messageType = item->messageType;
+	_rxMicros         = item->timestamp;
+	
+	// Handle special message types that don't require an existing device
+	if (messageType == BLINK && _type == ANCHOR) {
+		byte address[8];
+		byte shortAddress[2];
+		_globalMac.decodeBlinkFrame(data, address, shortAddress);
+		// We create a new device with the tag
+		DeviceState myTag(address, shortAddress);
+		
+		if(addNetworkDevices(&myTag)) {
+			// the handler gets the device in the table, not our copy
+			if(_handleBlinkDevice != 0) {
+				(*_handleBlinkDevice)(searchDistantDevice(shortAddress));
+			}
+			// We reply by transmitting ranging init message, once a delayed
+			// reply to another tag went out. In a superframe all anchors which
+			// do not know the tag answer, spread over the first quarter of
+			// slot 0 so the tag hears more than one
+			DeviceState* stored = searchDistantDevice(shortAddress);
+			if(stored != nullptr) {
+				scheduleReply(stored, RANGING_INIT, _slotMs != 0 ? random(_slotMs/4)*1000 : 0);
+			}
+			noteActivity();
+		}
+		return;
+	}
+	else if (messageType == RANGING_INIT && _type == TAG) {
+		byte address[2];
+		_globalMac.decodeLongMACFrame(data, address);
+		// We create a new device with the anchor
+		DeviceState myAnchor(address, true);
+		
+		if(addNetworkDevices(&myAnchor, true)) {
+			if(_handleNewDevice != 0) {
+				(*_handleNewDevice)(searchDistantDevice(address));
+			}
+		}
+		noteActivity();
+		return;
+	}
+	
+	else if (messageType == BEACON) {
+		// from the coordinator, which need not be one of our devices
+		handleBeacon(item);
+		return;
+	}
+	
+	// in a superframe we hear the anchors answer the other tags in their
+	// slots, so we know them without a RANGING_INIT of our own
+	if (device == nullptr && _type == TAG && _superframe &&
+	    (messageType == POLL_ACK || messageType == RANGE_REPORT || messageType == RANGE_TIMES || messageType == RESPONSE)) {
+		DeviceState myAnchor(item->sourceAddress, true);
+		if(addNetworkDevices(&myAnchor, true) && _handleNewDevice != 0) {
+			(*_handleNewDevice)(searchDistantDevice(item->sourceAddress));
+		}
+		return;
+	}
+	
+	// short MAC frames to another device (the POLL_ACK of an anchor we know
+	// to another tag) are not ours, the destination is stored reversed
+	if (!(data[5] == 0xFF && data[6] == 0xFF) &&
+	    !(data[5] == _currentShortAddress[1] && data[6] == _currentShortAddress[0])) {
+		return;
+	}
+	
+	// in a superframe a tag POLLs every anchor it knows in its slot, one which
+	// dropped the tag (missed POLLs) takes it back by its short address
+	// instead of leaving the exchange without its POLL_ACK
+	if (device == nullptr && messageType == POLL && _type == ANCHOR && _slotMs != 0) {
+		uint8_t numberDevices = data[SHORT_MAC_LEN+1];
+		for(uint8_t i = 0; i < numberDevices && SHORT_MAC_LEN+2+4*(i+1) <= item->length; i++) {
+			if(data[SHORT_MAC_LEN+2+i*4] == _currentShortAddress[0] && data[SHORT_MAC_LEN+3+i*4] == _currentShortAddress[1]) {
+				DeviceState myTag(item->sourceAddress, true);
+				if(addNetworkDevices(&myTag, true)) {
+					device = searchDistantDevice(item->sourceAddress);
+				}
+				break;
+			}
+		}
+	}
+	
+	// For other message types, we need an existing device
+	if (device == nullptr) {
+		// We don't have the short address of the device in memory
+		if (DEBUG) {
+			Serial.println("Device not found for message processing");
+		}
+		return;
+	}
+	
+	if (_type == ANCHOR) {
+		// Handle anchor-specific message processing
+		handleDeviceProtocolState(device, item);
+	} else if (_type == TAG) {
+		// Handle tag-specific message processing  
+		handleDeviceProtocolState(device, item);
+	}
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::handleDeviceProtocolState(DeviceState* device, MessageQueueItem* item) {
+	// Handle protocol state transitions for a specific device
+	// This replaces the global protocol state machine with per-device state machines
+	// Timestamps and powers come from the registers captured with the frame
+	byte* data        = item->data;
+	int   messageType = item->messageType;
+	
+	if (_type == ANCHOR) {
+		// ANCHOR protocol state machine
+		if (messageType != device->getExpectedMessage()) {
+			// Unexpected message, start over again (except if already POLL)
+			device->setProtocolFailed(true);
+			if (_handleProtocolError != 0) {
+				(*_handleProtocolError)(device, messageType);
+			}
+		}
+		
+		if (messageType == POLL) {
+			// We receive a POLL which is a broadcast message
+			// We need to grab info about it
+			int16_t numberDevices = 0;
+			memcpy(&numberDevices, data+SHORT_MAC_LEN+1, 1);
+			
+			for(uint16_t i = 0; i < numberDevices && SHORT_MAC_LEN+2+4*(i+1) <= item->length; i++) {
+				// We need to test if this value is for us:
+				// We grab the mac address of each device:
+				byte shortAddress[2];
+				memcpy(shortAddress, data+SHORT_MAC_LEN+2+i*4, 2);
+				
+				// We test if the short address is our address
+				if(shortAddress[0] == _currentShortAddress[0] && shortAddress[1] == _currentShortAddress[1]) {
+					// We grab the reply time which is for us
+					uint16_t replyTime;
+					memcpy(&replyTime, data+SHORT_MAC_LEN+2+i*4+2, 2);
+					// We configure our reply time, for this tag only
+					device->setReplyTime(replyTime);
+					
+					// On POLL we (re-)start, so no protocol failure
+					device->setProtocolFailed(false);
+					device->setProtocolState(PROTOCOL_POLL_SENT);
+					
+					DW1000.getReceiveTimestamp(item->rx, device->timePollReceived);
+					// We note activity for our device
+					device->noteActivity();
+					device->noteProtocolActivity();
+					if (_rangingMode == RANGING_SINGLE_SIDED) {
+						// the tag computes the range, nothing follows
+						device->setExpectedMessage(MSG_POLL);
+						scheduleReply(device, RESPONSE, replyTime);
+						device->setProtocolState(PROTOCOL_IDLE);
+					}
+					else {
+						// We indicate our next receive message for our ranging protocol
+						device->setExpectedMessage(MSG_RANGE);
+						scheduleReply(device, POLL_ACK, replyTime);
+					}
+					noteActivity();
+					
+					return;
+				}
+			}
+		}
+		else if (messageType == RANGE) {
+			// We receive a RANGE which is a broadcast message
+			// We need to grab info about it
+			uint8_t numberDevices = 0;
+			memcpy(&numberDevices, data+SHORT_MAC_LEN+1, 1);
+			
+			for(uint8_t i = 0; i < numberDevices && RANGE_HEADER_LEN+RANGE_ANCHOR_LEN*(i+1) <= item->length; i++) {
+				// We need to test if this value is for us:
+				// We grab the mac address of each device:
+				byte* entry = data+RANGE_HEADER_LEN+RANGE_ANCHOR_LEN*i;
+				byte  shortAddress[2];
+				memcpy(shortAddress, entry, 2);
+				
+				// We test if the short address is our address
+				if(shortAddress[0] == _currentShortAddress[0] && shortAddress[1] == _currentShortAddress[1]) {
+					// We grab the range data which is for us
+					DW1000.getReceiveTimestamp(item->rx, device->timeRangeReceived);
+					noteActivity();
+					device->noteActivity();
+					device->noteProtocolActivity();
+					device->setExpectedMessage(MSG_POLL);
+					device->setProtocolState(PROTOCOL_RANGE_SENT);
+					
+					if(!device->getProtocolFailed() && _rangingMode == RANGING_ASYMMETRIC_ON_TAG) {
+						// the TAG computes the range from our times, nothing follows
+						scheduleReply(device, RANGE_TIMES, device->getReplyTime());
+						device->setProtocolState(PROTOCOL_IDLE);
+					}
+					else if(!device->getProtocolFailed()) {
+						device->timePollSent.setTimestamp(data+SHORT_MAC_LEN+2);
+						device->timeRangeSent.setTimestamp(data+SHORT_MAC_LEN+7);
+						// the tag's round trip differs from our reply by twice the
+						// flight and the clock offset, far less than 2^31 ticks
+						uint32_t roundLow;
+						memcpy(&roundLow, entry+2, 4);
+						int64_t reply1 = (device->timePollAckSent-device->timePollReceived).wrap().getTimestamp();
+						int64_t round1 = reply1+(int32_t)(roundLow-(uint32_t)reply1);
+						device->timePollAckReceived.setTimestamp((device->timePollSent.getTimestamp()+round1) & DW1000Time::TIME_MAX);
+						
+						// (re-)compute range as two-way ranging is done
+						DW1000Time myTOF;
+						computeRangeAsymmetric(device, &myTOF); // CHOSEN RANGING ALGORITHM
+						
+						int32_t distance = (int32_t)myTOF.getAsMillimeters();
+						
+						if (_useRangeFilter) {
+							// Skip first range
+							if (device->getRangeMillimeters() != 0) {
+								distance = filterValue(distance, device->getRangeMillimeters(), _rangeFilterValue);
+							}
+						}
+						
+						device->setRXPowerCentiDbm(DW1000.getReceivePowerCentiDbm(item->rx));
+						device->setRangeMillimeters(distance);
+						device->setFPPowerCentiDbm(DW1000.getFirstPathPowerCentiDbm(item->rx));
+						device->setQualityPercent(DW1000.getReceiveQualityPercent(item->rx));
+						
+						if (reportInPollAck()) {
+							// the range goes to the TAG with our next POLL_ACK
+							device->setRangeReportPending(true);
+							device->setProtocolState(PROTOCOL_IDLE);
+						}
+						else {
+							// We send the range to TAG
+							scheduleReply(device, RANGE_REPORT, device->getReplyTime());
+							device->setProtocolState(PROTOCOL_RANGE_REPORT_SENT);
+						}
+						
+						// We have finished our range computation. We send the corresponding handler
+						_lastDistantDevice = device->getIndex();
+						if(_handleNewRange != 0) {
+							(*_handleNewRange)();
+						}
+						
+						// Call range complete handler for multi-anchor support
+						if(_handleRangeComplete != 0) {
+							(*_handleRangeComplete)(device);
+						}
+					}
+					else {
+						device->setRangeReportPending(false);
+						scheduleReply(device, RANGE_FAILED, 0);
+						device->setProtocolState(PROTOCOL_FAILED);
+					}
+					
+					return;
+				}
+			}
+		}
+	}
+	else if (_type == TAG) {
+		// TAG protocol state machine
+		if (messageType != device->getExpectedMessage()) {
+			// Unexpected message, start over again
+			device->setProtocolFailed(true);
+			device->setExpectedMessage(replyMessage());
+			if (_handleProtocolError != 0) {
+				(*_handleProtocolError)(device, messageType);
+			}
+			return;
+		}
+		_lastReplyMicros = item->timestamp;
+		
+		if (messageType == POLL_ACK) {
+			DW1000.getReceiveTimestamp(item->rx, device->timePollAckReceived);
+			noteReplyLatency(device);
+			// We note activity for our device
+			device->noteActivity();
+			device->noteProtocolActivity();
+			if (reportInPollAck()) {
+				// nothing follows the broadcast RANGE, the range of this exchange
+				// comes with the next POLL_ACK
+				device->setProtocolState(PROTOCOL_IDLE);
+				device->setExpectedMessage(MSG_POLL_ACK);
+			}
+			else {
+				device->setProtocolState(PROTOCOL_POLL_ACK_SENT);
+				// every anchor which answered gets its report (or its times) after the broadcast RANGE
+				device->setExpectedMessage(_rangingMode == RANGING_ASYMMETRIC_ON_TAG ? MSG_RANGE_TIMES : MSG_RANGE_REPORT);
+			}
+			
+			// In the case the message comes from our last device:
+			if(device == getNetworkDevice(_networkDevicesNumber-1)) {
+				// And transmit the next message (range) of the ranging protocol (in broadcast)
+				transmitRange();
+				noteTurnaround(micros()-item->timestamp);
+			}
+			
+			// the range of the previous exchange, after the RANGE went out
+			if (reportInPollAck() && data[SHORT_MAC_LEN+1] != 0) {
+				handleRangeReport(device, data+2+SHORT_MAC_LEN);
+			}
+		}
+		else if (messageType == RESPONSE) {
+			// single-sided: the anchor's POLL reception and RESPONSE transmission
+			// timestamps are in the frame, our POLL/RESPONSE ones we have
+			DW1000.getReceiveTimestamp(item->rx, device->timePollAckReceived);
+			noteReplyLatency(device);
+			
+			DW1000Time myTOF;
+			computeRangeSingleSided(device, data+1+SHORT_MAC_LEN, item->carrierIntegrator, &myTOF);
+			
+			int32_t distance = (int32_t)myTOF.getAsMillimeters();
+			
+			if (_useRangeFilter) {
+				// Skip first range
+				if (device->getRangeMillimeters() != 0) {
+					distance = filterValue(distance, device->getRangeMillimeters(), _rangeFilterValue);
+				}
+			}
+			
+			device->setRXPowerCentiDbm(DW1000.getReceivePowerCentiDbm(item->rx));
+			device->setRangeMillimeters(distance);
+			device->setFPPowerCentiDbm(DW1000.getFirstPathPowerCentiDbm(item->rx));
+			device->setQualityPercent(DW1000.getReceiveQualityPercent(item->rx));
+			device->noteActivity();
+			device->noteProtocolActivity();
+			device->setProtocolState(PROTOCOL_IDLE);
+			device->setExpectedMessage(MSG_RESPONSE);
+			
+			_lastDistantDevice = device->getIndex();
+			if(_handleNewRange != 0) {
+				(*_handleNewRange)();
+			}
+			
+			if(_handleRangeComplete != 0) {
+				(*_handleRangeComplete)(device);
+			}
+		}
+		else if (messageType == RANGE_TIMES) {
+			// the anchor's side of the exchange, kept until the last anchor's
+			// times are in (or the next POLL goes out)
+			device->timePollReceived.setTimestamp(data+1+SHORT_MAC_LEN);
+			device->timePollAckSent.setTimestamp(data+6+SHORT_MAC_LEN);
+			device->timeRangeReceived.setTimestamp(data+11+SHORT_MAC_LEN);
+			device->setRXPowerCentiDbm(DW1000.getReceivePowerCentiDbm(item->rx));
+			device->setFPPowerCentiDbm(DW1000.getFirstPathPowerCentiDbm(item->rx));
+			device->setQualityPercent(DW1000.getReceiveQualityPercent(item->rx));
+			device->noteActivity();
+			device->noteProtocolActivity();
+			device->setProtocolState(PROTOCOL_RANGE_TIMES_RECEIVED);
+			device->setExpectedMessage(MSG_POLL_ACK);
+			
+			if(device == getNetworkDevice(_networkDevicesNumber-1)) {
+				computeRangesOnTag();
+			}
+		}
+		else if (messageType == RANGE_REPORT) {
+			device->noteActivity();
+			device->noteProtocolActivity();
+			device->setProtocolState(PROTOCOL_IDLE);
+			handleRangeReport(device, data+1+SHORT_MAC_LEN);
+		}
+		else if (messageType == RANGE_FAILED) {
+			// Protocol failed for this device
+			device->setProtocolFailed(true);
+			device->setProtocolState(PROTOCOL_FAILED);
+			device->setExpectedMessage(replyMessage());
+			if (_handleProtocolError != 0) {
+				(*_handleProtocolError)(device, messageType);
+			}
+		}
+	}
+}
+
+/* ###########################################################################
+ * #### Methods for ranging protocole   ######################################
+ * ######################################################################### */
+
+// TAG: range and RX power an anchor reports (RANGE_REPORT or appended to a
+// POLL_ACK)
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::handleRangeReport(DeviceState* device, const byte report[]) {
+	int32_t curRange;
+	memcpy(&curRange, report, 4);
+	int16_t curRXPower;
+	memcpy(&curRXPower, report+4, 2);
+	
+	if (_useRangeFilter) {
+		// Skip first range
+		if (device->getRangeMillimeters() != 0) {
+			curRange = filterValue(curRange, device->getRangeMillimeters(), _rangeFilterValue);
+		}
+	}
+	
+	// We have a new range to save!
+	device->setRangeMillimeters(curRange);
+	device->setRXPowerCentiDbm(curRXPower);
+	
+	// We can call our handler!
+	// We have finished our range computation. We send the corresponding handler
+	_lastDistantDevice = device->getIndex();
+	if(_handleNewRange != 0) {
+		(*_handleNewRange)();
+	}
+	
+	// Call range complete handler for multi-anchor support
+	if(_handleRangeComplete != 0) {
+		(*_handleRangeComplete)(device);
+	}
+}
+
+// peak value, a single slow answer is forgotten after some hundred
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::noteTurnaround(uint32_t turnaroundUs) {
+	uint32_t decayed = _turnaroundUs-_turnaroundUs/32;
+	_turnaroundUs = turnaroundUs > decayed ? turnaroundUs : decayed;
+}
+
+// TAG: the anchor's reply left the reply time we gave it after it handled our
+// POLL, the rest of its round trip is the end of the POLL frame and how long
+// the anchor took to get to it
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::noteReplyLatency(DeviceState* device) {
+	int64_t  roundTicks = (device->timePollAckReceived-device->timePollSent).wrap().getTimestamp();
+	int64_t  roundUs    = roundTicks*1000/(DW1000Time::TICKS_PER_SECOND/1000);
+	uint32_t shr;
+	uint32_t air        = DW1000.getFrameAirtime(LEN_DATA, &shr);
+	int64_t  latency    = roundUs-device->getReplyTime()-(air-shr);
+	if(latency < 0 || latency > PROTOCOL_TIMEOUT*1000L) {
+		// not an answer to our last POLL
+		return;
+	}
+	_cycleLatencyMin = (uint32_t)latency < _cycleLatencyMin ? (uint32_t)latency : _cycleLatencyMin;
+	_cycleLatencyMax = (uint32_t)latency > _cycleLatencyMax ? (uint32_t)latency : _cycleLatencyMax;
+}
+
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::replyDelay(uint8_t slot) {
+	if(!_adaptiveReplyDelay || _turnaroundUs == 0) {
+		// nothing measured yet
+		return (2*slot+1)*(uint32_t)DEFAULT_REPLY_DELAY_TIME;
+	}
+	uint32_t shr;
+	uint32_t air = DW1000.getFrameAirtime(LEN_DATA, &shr);
+	// the delayed preamble starts before the timestamp, the next anchor's
+	// reply one frame and the spread of the anchors' latencies later
+	return _turnaroundUs+shr+REPLY_DELAY_MARGIN+slot*(air+_latencySpreadUs+REPLY_DELAY_MARGIN);
+}
+
+// the POLL has 16 bits per reply time, a later slot would collide with the
+// last one that fits
+template<uint8_t Capacity, class DeviceState>
+uint8_t DW1000RangingT<Capacity, DeviceState>::replySlots() {
+	uint32_t first = replyDelay(0);
+	if(first > UINT16_MAX) {
+		return 0;
+	}
+	uint32_t slots = (UINT16_MAX-first)/(replyDelay(1)-first)+1;
+	return slots > UINT8_MAX ? UINT8_MAX : (uint8_t)slots;
+}
+
+template<uint8_t Capacity, class DeviceState>
+uint16_t DW1000RangingT<Capacity, DeviceState>::cycleTimerDelay() {
+	if(!_adaptiveReplyDelay || _turnaroundUs == 0) {
+		return DEFAULT_TIMER_DELAY+(uint16_t)(_networkDevicesNumber*slotsPerDevice()*DEFAULT_REPLY_DELAY_TIME/1000);
+	}
+	// every frame is answered after it ended and was handled: the anchors
+	// answer the POLL and (3 slots) our RANGE, which follows the last
+	// POLL_ACK unless single-sided. The RANGE grows with the anchors, the
+	// RANGE_TIMES are shorter than the other frames
+	uint32_t air      = DW1000.getFrameAirtime(LEN_DATA);
+	uint32_t round    = _turnaroundUs+(_networkDevicesNumber > 0 ? replyDelay(_networkDevicesNumber-1) : 0);
+	uint32_t exchange = air+round+air;
+	if(slotsPerDevice() == 3) {
+		exchange += round+(_rangingMode == RANGING_ASYMMETRIC_ON_TAG ? DW1000.getFrameAirtime(LEN_RANGE_TIMES) : air);
+	}
+	if(_rangingMode != RANGING_SINGLE_SIDED) {
+		exchange += _turnaroundUs+replyDelay(0)+DW1000.getFrameAirtime(RANGE_HEADER_LEN+RANGE_ANCHOR_LEN*_networkDevicesNumber);
+	}
+	uint32_t delay = exchange/1000+1;
+	return delay > DEFAULT_TIMER_DELAY ? (uint16_t)delay : DEFAULT_TIMER_DELAY;
+}
+
+template<uint8_t Capacity, class DeviceState>
+uint32_t DW1000RangingT<Capacity, DeviceState>::minReplyDelay() {
+	uint32_t shr;
+	DW1000.getFrameAirtime(LEN_DATA, &shr);
+	return shr+REPLY_DELAY_MARGIN;
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmitInit() {
+	DW1000.newTransmit();
+	DW1000.setDefaults();
+}
+
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmit(byte datas[]) {
+	DW1000.setData(datas, LEN_DATA);
+	DW1000.startTransmit();
+}
+
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmit(byte datas[], DW1000Time time) {
+	DW1000.setDelay(time);
+	DW1000.setData(datas, LEN_DATA);
+	DW1000.startTransmit();
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmitBlink() {
+	transmitInit();
+	_globalMac.generateBlinkFrame(data, _currentAddress, _currentShortAddress);
+	transmit(data);
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmitRangingInit(DeviceState* myDistantDevice) {
+	transmitInit();
+	//we generate the mac frame for a ranging init message
+	_globalMac.generateLongMACFrame(data, _currentShortAddress, myDistantDevice->getByteAddress());
+	//we define the function code
+	data[LONG_MAC_LEN] = RANGING_INIT;
+	
+	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
+	transmit(data);
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::pollNetworkDevices() {
+	// the last anchor's RANGE_TIMES did not come, the others' did
+	if(_rangingMode == RANGING_ASYMMETRIC_ON_TAG) {
+		computeRangesOnTag();
+	}
+	// the last exchange is over
+	if(_pollMicros != 0 && (int32_t)(_lastReplyMicros-_pollMicros) > 0) {
+		_cycleTimeUs = _lastReplyMicros-_pollMicros;
+	}
+	if(_cycleLatencyMax >= _cycleLatencyMin) {
+		noteTurnaround(_cycleLatencyMax);
+		uint32_t spread  = _cycleLatencyMax-_cycleLatencyMin;
+		uint32_t decayed = _latencySpreadUs-_latencySpreadUs/32;
+		_latencySpreadUs = spread > decayed ? spread : decayed;
+	}
+	_cycleLatencyMin = UINT32_MAX;
+	_cycleLatencyMax = 0;
+	// the reply times grew, the last anchors have no reply slot left: they
+	// are still active, drop them without the inactive callback, and
+	// insertNetworkDevice() refuses them when they answer a BLINK again
+	while(_networkDevicesNumber > maxRangeDevices()) {
+		removeNetworkDevices(_networkDevicesNumber-1);
+	}
+	_pollMicros      = micros();
+	// Set expected message for all devices
+	for (uint8_t i = 0; i < _networkDevicesNumber; i++) {
+		_deviceHot[i].expectedMessage = replyMessage();
+	}
+	//send a prodcast poll
+	transmitPoll();
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmitPoll() {
+	
+	transmitInit();
+	
+	//we need to set our timerDelay:
+	_timerDelay = cycleTimerDelay();
+	
+	byte shortBroadcast[2] = {0xFF, 0xFF};
+	_globalMac.generateShortMACFrame(data, _currentShortAddress, shortBroadcast);
+	data[SHORT_MAC_LEN]   = POLL;
+	//we enter the number of devices
+	data[SHORT_MAC_LEN+1] = _networkDevicesNumber;
+	
+	for(uint8_t i = 0; i < _networkDevicesNumber; i++) {
+		//each devices have a different reply delay time.
+		// i < replySlots(), it fits, unless there is no slot and we kept one anchor
+		uint32_t delay = replyDelay(i);
+		getNetworkDevice(i)->setReplyTime(delay > UINT16_MAX ? UINT16_MAX : (uint16_t)delay);
+		//we write the short address of our device:
+		memcpy(data+SHORT_MAC_LEN+2+4*i, _deviceHot[i].shortAddress, 2);
+		
+		//we add the replyTime
+		uint16_t replyTime = getNetworkDevice(i)->getReplyTime();
+		memcpy(data+SHORT_MAC_LEN+2+2+4*i, &replyTime, 2);
+		
+	}
+	
+	copyShortAddress(_lastSentToShortAddress, shortBroadcast);
+	transmit(data);
+}
+
+
+// ANCHOR: a reply goes out the reply time the tag gave us after the frame
+// it answers. Another tag's delayed reply may still hold the transmitter
+// (starting a transmission would drop it), then it waits in _replyQueue and
+// loop() sends it once the transmitter is free, with what is left of its delay
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::scheduleReply(DeviceState* myDistantDevice, uint8_t messageType, uint32_t replyDelayTimeUs) {
+	myDistantDevice->setPendingReply(messageType);
+	_replyQueue.set(myDistantDevice->getIndex(), micros()+replyDelayTimeUs);
+	transmitPendingReply();
+	if(messageType != RANGING_INIT && !_replyQueue.contains(myDistantDevice->getIndex())) {
+		noteTurnaround(micros()-_rxMicros);
+	}
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmitPendingReply() {
+	if(_replyQueue.empty()) {
+		return;
+	}
+	if(transmitterBusy()) {
+		return;
+	}
+	uint8_t      slot   = _replyQueue.top();
+	int32_t      left   = (int32_t)(_replyQueue.topDeadline()-micros());
+	DeviceState* device = &_networkDevices[slot];
+	if(device->getPendingReply() == RANGING_INIT && left > 0) {
+		// sent when due, a delayed frame would hold the transmitter until then
+		return;
+	}
+	_replyQueue.erase(slot);
+	
+	uint16_t replyDelayTimeUs = 0;
+	if(device->getPendingReply() != RANGE_FAILED && device->getPendingReply() != RANGING_INIT) {
+		int32_t minimum  = (int32_t)minReplyDelay();
+		replyDelayTimeUs = (uint16_t)(left > minimum ? left : minimum);
+	}
+	switch(device->getPendingReply()) {
+		case POLL_ACK:
+			transmitPollAck(device, replyDelayTimeUs);
+			break;
+		case RESPONSE:
+			transmitResponse(device, replyDelayTimeUs);
+			break;
+		case RANGE_REPORT:
+			transmitRangeReport(device, replyDelayTimeUs);
+			break;
+		case RANGE_TIMES:
+			transmitRangeTimes(device, replyDelayTimeUs);
+			break;
+		case RANGING_INIT:
+			transmitRangingInit(device);
+			break;
+		default:
+			transmitRangeFailed(device);
+			break;
+	}
+	// handleSent() ends it, the timeout only if the frame never went out
+	holdTransmitter(replyDelayTimeUs);
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmitPollAck(DeviceState* myDistantDevice, uint16_t replyDelayTimeUs) {
+	transmitInit();
+	_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress());
+	data[SHORT_MAC_LEN] = POLL_ACK;
+	// the range of the previous exchange, as a RANGE_REPORT would carry it
+	data[SHORT_MAC_LEN+1] = 0;
+	if(reportInPollAck() && myDistantDevice->getRangeReportPending()) {
+		int32_t curRange   = myDistantDevice->getRangeMillimeters();
+		int16_t curRXPower = myDistantDevice->getRXPowerCentiDbm();
+		data[SHORT_MAC_LEN+1] = 1;
+		memcpy(data+2+SHORT_MAC_LEN, &curRange, 4);
+		memcpy(data+6+SHORT_MAC_LEN, &curRXPower, 2);
+		myDistantDevice->setRangeReportPending(false);
+	}
+	// delay the same amount as ranging tag
+	DW1000Time deltaTime = DW1000Time(replyDelayTimeUs, DW1000Time::TimeUnit::MICROSECONDS);
+	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
+	transmit(data, deltaTime);
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmitResponse(DeviceState* myDistantDevice, uint16_t replyDelayTimeUs) {
+	transmitInit();
+	_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress());
+	data[SHORT_MAC_LEN] = RESPONSE;
+	// delayed, so the expected sent timestamp goes into the frame itself
+	DW1000Time timeResponseSent = DW1000.setDelay(DW1000Time(replyDelayTimeUs, DW1000Time::TimeUnit::MICROSECONDS));
+	myDistantDevice->timePollReceived.getTimestamp(data+1+SHORT_MAC_LEN);
+	timeResponseSent.getTimestamp(data+6+SHORT_MAC_LEN);
+	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
+	transmit(data);
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmitRange() {
+	//transmit range need to accept broadcast for multiple anchor
+	transmitInit();
+	
+	//we need to set our timerDelay:
+	_timerDelay = cycleTimerDelay();
+	
+	byte shortBroadcast[2] = {0xFF, 0xFF};
+	_globalMac.generateShortMACFrame(data, _currentShortAddress, shortBroadcast);
+	data[SHORT_MAC_LEN]   = RANGE;
+	//we enter the number of devices
+	data[SHORT_MAC_LEN+1] = _networkDevicesNumber;
+	
+	// delay sending the message and remember expected future sent timestamp
+	DW1000Time deltaTime     = DW1000Time(replyDelay(0), DW1000Time::TimeUnit::MICROSECONDS);
+	DW1000Time timeRangeSent = DW1000.setDelay(deltaTime);
+	// one POLL for all
+	DW1000Time timePollSent  = _networkDevicesNumber > 0 ? getNetworkDevice(0)->timePollSent : DW1000Time();
+	timePollSent.getTimestamp(data+SHORT_MAC_LEN+2);
+	timeRangeSent.getTimestamp(data+SHORT_MAC_LEN+7);
+	
+	for(uint8_t i = 0; i < _networkDevicesNumber; i++) {
+		//we write the short address of our device:
+		memcpy(data+RANGE_HEADER_LEN+RANGE_ANCHOR_LEN*i, getNetworkDevice(i)->getByteShortAddress(), 2);
+		
+		//we get the device which correspond to the message which was sent (need to be filtered by MAC address)
+		getNetworkDevice(i)->timeRangeSent = timeRangeSent;
+		uint32_t round = (uint32_t)(getNetworkDevice(i)->timePollAckReceived-timePollSent).wrap().getTimestamp();
+		memcpy(data+RANGE_HEADER_LEN+RANGE_ANCHOR_LEN*i+2, &round, 4);
+	}
+	
+	copyShortAddress(_lastSentToShortAddress, shortBroadcast);
+	// no BLINK until it went out
+	holdTransmitter(replyDelay(0));
+	
+	// compact, no padding to LEN_DATA
+	DW1000.setData(data, RANGE_HEADER_LEN+RANGE_ANCHOR_LEN*_networkDevicesNumber);
+	DW1000.startTransmit();
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmitRangeReport(DeviceState* myDistantDevice, uint16_t replyDelayTimeUs) {
+	transmitInit();
+	_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress());
+	data[SHORT_MAC_LEN] = RANGE_REPORT;
+	// write final ranging result
+	int32_t curRange   = myDistantDevice->getRangeMillimeters();
+	int16_t curRXPower = myDistantDevice->getRXPowerCentiDbm();
+	//We add the Range (mm) and then the RXPower (1/100 dBm)
+	memcpy(data+1+SHORT_MAC_LEN, &curRange, 4);
+	memcpy(data+5+SHORT_MAC_LEN, &curRXPower, 2);
+	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
+	transmit(data, DW1000Time(replyDelayTimeUs, DW1000Time::TimeUnit::MICROSECONDS));
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmitRangeTimes(DeviceState* myDistantDevice, uint16_t replyDelayTimeUs) {
+	transmitInit();
+	_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress());
+	data[SHORT_MAC_LEN] = RANGE_TIMES;
+	myDistantDevice->timePollReceived.getTimestamp(data+1+SHORT_MAC_LEN);
+	myDistantDevice->timePollAckSent.getTimestamp(data+6+SHORT_MAC_LEN);
+	myDistantDevice->timeRangeReceived.getTimestamp(data+11+SHORT_MAC_LEN);
+	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
+	DW1000.setDelay(DW1000Time(replyDelayTimeUs, DW1000Time::TimeUnit::MICROSECONDS));
+	// only what the frame carries, the shorter airtime is the point of it
+	DW1000.setData(data, LEN_RANGE_TIMES);
+	DW1000.startTransmit();
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmitRangeFailed(DeviceState* myDistantDevice) {
+	transmitInit();
+	_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress());
+	data[SHORT_MAC_LEN] = RANGE_FAILED;
+	
+	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
+	transmit(data);
+}
+
+// BEACON: slot length in ms (2 bytes), number of slots n and the short
+// addresses of the tags the slots 1..n belong to
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::transmitBeacon() {
+	transmitInit();
+	byte shortBroadcast[2] = {0xFF, 0xFF};
+	_globalMac.generateShortMACFrame(data, _currentShortAddress, shortBroadcast);
+	data[SHORT_MAC_LEN] = BEACON;
+	memcpy(data+SHORT_MAC_LEN+1, &_coordinatorSlotMs, 2);
+	uint8_t tags = _networkDevicesNumber;
+	if(tags > (LEN_DATA-SHORT_MAC_LEN-4)/2) {
+		tags = (LEN_DATA-SHORT_MAC_LEN-4)/2;
+	}
+	data[SHORT_MAC_LEN+3] = tags;
+	for(uint8_t i = 0; i < tags; i++) {
+		memcpy(data+SHORT_MAC_LEN+4+2*i, _deviceHot[i].shortAddress, 2);
+	}
+	_slotMs           = _coordinatorSlotMs;
+	_superframeLength = (uint32_t)(tags+1)*_coordinatorSlotMs;
+	_inactivityTime   = (2*_superframeLength > INACTIVITY_TIME ? 2*_superframeLength : INACTIVITY_TIME);
+	copyShortAddress(_lastSentToShortAddress, shortBroadcast);
+	transmit(data);
+	holdTransmitter(0);
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::handleBeacon(MessageQueueItem* item) {
+	byte*    data = item->data;
+	// slot length and tag count, the rest of the slot holds the last frame
+	if(item->length < SHORT_MAC_LEN+4) {
+		return;
+	}
+	uint16_t slotMs;
+	memcpy(&slotMs, data+SHORT_MAC_LEN+1, 2);
+	uint8_t  tags = data[SHORT_MAC_LEN+3];
+	// a coordinator sends no BEACON with 0 ms slots
+	if(slotMs == 0) {
+		return;
+	}
+	// slots count from the BEACON's reception, not from now
+	uint32_t received = millis()-(micros()-item->timestamp)/1000;
+	
+	// every device of the cell is heard once per superframe
+	_slotMs           = slotMs;
+	_superframeLength = (uint32_t)(tags+1)*slotMs;
+	_inactivityTime   = (2*_superframeLength > INACTIVITY_TIME ? 2*_superframeLength : INACTIVITY_TIME);
+	noteActivity();
+	if(_type != TAG || !_superframe) {
+		return;
+	}
+	
+	uint8_t slot = 0;
+	for(uint8_t i = 0; i < tags && slot == 0 && SHORT_MAC_LEN+4+2*(i+1) <= item->length; i++) {
+		if(data[SHORT_MAC_LEN+4+2*i] == _currentShortAddress[0] && data[SHORT_MAC_LEN+5+2*i] == _currentShortAddress[1]) {
+			slot = i+1;
+		}
+	}
+	if(slot != 0 && _networkDevicesNumber > 0) {
+		_pollTime    = received+slot*slotMs;
+		_pollPending = true;
+	}
+	// with a slot now and then for new anchors, without one (or an anchor)
+	// after a random backoff: the tags switched on together all wait for slot 0,
+	// the window doubles with every BLINK until we got a slot
+	_superframesSinceBlink++;
+	boolean blink;
+	if(slot == 0 || _networkDevicesNumber == 0) {
+		blink = _superframesSinceBlink > _blinkBackoff;
+		if(blink) {
+			_blinkBackoff = random(_blinkWindow);
+			_blinkWindow  = (_blinkWindow < SUPERFRAME_BLINK_PERIOD ? 2*_blinkWindow : _blinkWindow);
+		}
+	}
+	else {
+		blink         = _superframesSinceBlink >= SUPERFRAME_BLINK_PERIOD;
+		_blinkBackoff = 0;
+		_blinkWindow  = 1;
+	}
+	if(blink) {
+		_superframesSinceBlink = 0;
+		// the middle half of slot 0, spread as more tags may BLINK in it
+		_blinkTime    = received+slotMs/4+random(slotMs/2);
+		_blinkPending = true;
+	}
+	checkForInactiveDevices();
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::receiver() {
+	DW1000.newReceive();
+	DW1000.setDefaults();
+	DW1000.setDoubleBuffering(_doubleBuffering);
+	// so we don't need to restart the receiver manually
+	DW1000.receivePermanently(true);
+	DW1000.startReceive();
+}
+
+/* ###########################################################################
+ * #### Methods for range computation and corrections  #######################
+ * ######################################################################### */
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::computeRangeAsymmetric(DeviceState* myDistantDevice, DW1000Time* myTOF) {
+	// asymmetric two-way ranging (more computation intense, less error prone)
+	DW1000Time round1 = (myDistantDevice->timePollAckReceived-myDistantDevice->timePollSent).wrap();
+	DW1000Time reply1 = (myDistantDevice->timePollAckSent-myDistantDevice->timePollReceived).wrap();
+	DW1000Time round2 = (myDistantDevice->timeRangeReceived-myDistantDevice->timePollAckSent).wrap();
+	DW1000Time reply2 = (myDistantDevice->timeRangeSent-myDistantDevice->timePollAckReceived).wrap();
+	
+	myTOF->setTimestamp(DW1000Time::asymmetricTimeOfFlight(round1.getTimestamp(), reply1.getTimestamp(),
+	                                                       round2.getTimestamp(), reply2.getTimestamp()));
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::computeRangeSingleSided(DeviceState* myDistantDevice, const byte anchorTimes[],
+                                                                    int32_t carrierIntegrator, DW1000Time* myTOF) {
+	// single-sided two-way ranging, the reply was counted by the anchor's
+	// clock: converted to ours it does not grow the error with the reply time
+	DW1000Time pollReceived;
+	DW1000Time responseSent;
+	pollReceived.setTimestamp(anchorTimes);
+	responseSent.setTimestamp(anchorTimes+5);
+	DW1000Time round = (myDistantDevice->timePollAckReceived-myDistantDevice->timePollSent).wrap();
+	DW1000Time reply = (responseSent-pollReceived).wrap();
+	
+	myTOF->setTimestamp((round.getTimestamp()-DW1000.toLocalClock(reply.getTimestamp(), carrierIntegrator))/2);
+}
+
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::computeRangesOnTag() {
+	// TAG: the ranges of all anchors whose RANGE_TIMES came in, in one pass
+	for(uint8_t i = 0; i < _networkDevicesNumber; i++) {
+		if(_deviceHot[i].protocolState != PROTOCOL_RANGE_TIMES_RECEIVED) {
+			continue;
+		}
+		DeviceState* device = getNetworkDevice(i);
+		DW1000Time   myTOF;
+		computeRangeAsymmetric(device, &myTOF);
+		
+		int32_t distance = (int32_t)myTOF.getAsMillimeters();
+		
+		if (_useRangeFilter) {
+			// Skip first range
+			if (device->getRangeMillimeters() != 0) {
+				distance = filterValue(distance, device->getRangeMillimeters(), _rangeFilterValue);
+			}
+		}
+		
+		device->setRangeMillimeters(distance);
+		device->setProtocolState(PROTOCOL_IDLE);
+		
+		_lastDistantDevice = device->getIndex();
+		if(_handleNewRange != 0) {
+			(*_handleNewRange)();
+		}
+		
+		if(_handleRangeComplete != 0) {
+			(*_handleRangeComplete)(device);
+		}
+	}
+}
+
+/* FOR DEBUGGING*/
+template<uint8_t Capacity, class DeviceState>
+void DW1000RangingT<Capacity, DeviceState>::visualizeDatas(byte datas[]) {
+	char string[60];
+	sprintf(string, "%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X",
+					datas[0], datas[1], datas[2], datas[3], datas[4], datas[5], datas[6], datas[7], datas[8], datas[9], datas[10], datas[11], datas[12], datas[13], datas[14], datas[15]);
+	Serial.println(string);
+}
+
+/* ###########################################################################
+ * #### Utils  ###############################################################
+ * ######################################################################### */
+
+template<uint8_t Capacity, class DeviceState>
+float DW1000RangingT<Capacity, DeviceState>::filterValue(float value, float previousValue, uint16_t numberOfElements) {
+	float k = 2.0f / ((float)numberOfElements + 1.0f);
+	return (value * k) + previousValue * (1.0f - k);
+}
+
+// same filter in fixed point, k = 2/(n+1) rounded to nearest
+template<uint8_t Capacity, class DeviceState>
+int32_t DW1000RangingT<Capacity, DeviceState>::filterValue(int32_t value, int32_t previousValue, uint16_t numberOfElements) {
+	int64_t sum = 2*(int64_t)value+((int64_t)numberOfElements-1)*previousValue;
+	int64_t n   = (int64_t)numberOfElements+1;
+	return (int32_t)((sum+(sum < 0 ? -n/2 : n/2))/n);
+}
+
+#endif
@@ -62,14 +62,23 @@ DW1000Time::DW1000Time(float timeUs) {
 	setTime(timeUs);
 }
 
+/**
+ * Initiates DW100Time with time in a unit, no float involved
+ * @param value time
+ * @param unit unit of value, e.g. TimeUnit::MICROSECONDS
+ */
+DW1000Time::DW1000Time(int32_t value, TimeUnit unit) {
+	setTime(value, unit);
+}
+
 /**
  * Initiates DW100Time with time and factor
  * @param value time
  * @param factorUs multiply factor for time
- * @todo maybe replace by better function without float
+ * @deprecated use DW1000Time(int32_t, TimeUnit)
  */
 DW1000Time::DW1000Time(int32_t value, float factorUs) {
-	setTime(value, factorUs);
+	setTime(value*factorUs);
 }
 
 /**
@@ -89,7 +98,7 @@ void DW1000Time::setTimestamp(int64_t value) {
  * Set timestamp
  * @param data timestamp as byte array
  */
-void DW1000Time::setTimestamp(byte data[]) {
+void DW1000Time::setTimestamp(const byte data[]) {
 	_timestamp = 0;
 	for(uint8_t i = 0; i < LENGTH_TIMESTAMP; i++) {
 		_timestamp |= ((int64_t)data[i] << (i*8));
@@ -114,11 +123,20 @@ void DW1000Time::setTime(float timeUs) {
 //	_timestamp %= TIME_OVERFLOW; // clean overflow
 }
 
+/**
+ * Set DW100Time with time in a unit, exact integer conversion
+ * @param value time
+ * @param unit unit of value, e.g. TimeUnit::MICROSECONDS
+ */
+void DW1000Time::setTime(int32_t value, TimeUnit unit) {
+	_timestamp = toTicks(value, unit);
+}
+
 /**
  * Set DW100Time with time and factor
  * @param value time
  * @param factorUs multiply factor for time
- * @todo maybe replace by better function without float
+ * @deprecated use setTime(int32_t, TimeUnit)
  */
 void DW1000Time::setTime(int32_t value, float factorUs) {
 	//float tsValue = value*factorUs;
@@ -174,6 +192,89 @@ float DW1000Time::getAsMeters() const {
 	return (_timestamp%TIME_OVERFLOW)*DISTANCE_OF_RADIO;
 }
 
+/**
+ * Return time as distance in millimeters, d=c*t, without float
+ * @return distance in millimeters, rounded
+ */
+int64_t DW1000Time::getAsMillimeters() const {
+	return ticksToMillimeters(_timestamp%TIME_OVERFLOW);
+}
+
+// a*b of two unsigned 64 bit values as 128 bit hi:lo, from 32 bit halves
+static void multiplyWide(uint64_t a, uint64_t b, uint64_t& hi, uint64_t& lo) {
+	uint64_t a0  = (uint32_t)a;
+	uint64_t a1  = a >> 32;
+	uint64_t b0  = (uint32_t)b;
+	uint64_t b1  = b >> 32;
+	uint64_t p00 = a0*b0;
+	uint64_t p01 = a0*b1;
+	uint64_t p10 = a1*b0;
+	uint64_t mid = (p00 >> 32)+(uint32_t)p01+(uint32_t)p10;
+	lo = (mid << 32) | (uint32_t)p00;
+	hi = a1*b1+(p01 >> 32)+(p10 >> 32)+(mid >> 32);
+}
+
+/**
+ * Time of flight of asymmetric two-way ranging in timestamp units, rounded
+ * towards zero:
+ * (round1*round2-reply1*reply2)/(round1+round2+reply1+reply2)
+ * The products need up to 80 bits. Rewritten as
+ * round1*(round2-reply2)+reply2*(round1-reply1) the numerator fits into
+ * int64_t whenever round and reply differ by less than 2^22 (65us, so any
+ * real time of flight) and one division is all it takes. Other durations are
+ * multiplied in 128 bits and divided in 22 bit steps, the divisor has at
+ * most 42 bits.
+ * @param round1 poll sent until poll ack received, 0..TIME_MAX
+ * @param reply1 poll received until poll ack sent, 0..TIME_MAX
+ * @param round2 poll ack sent until range received, 0..TIME_MAX
+ * @param reply2 poll ack received until range sent, 0..TIME_MAX
+ * @return time of flight, 0 if all durations are 0
+ */
+int64_t DW1000Time::asymmetricTimeOfFlight(int64_t round1, int64_t reply1, int64_t round2, int64_t reply2) {
+	int64_t sum = round1+round2+reply1+reply2;
+	if(sum == 0) {
+		return 0;
+	}
+	int64_t difference1 = round1-reply1;
+	int64_t difference2 = round2-reply2;
+	if((uint64_t)(difference1+(1LL << 22)) < (1ULL << 23) && (uint64_t)(difference2+(1LL << 22)) < (1ULL << 23)) {
+		// both terms below 2^62
+		return (round1*difference2+reply2*difference1)/sum;
+	}
+	uint64_t positiveHi, positiveLo, negativeHi, negativeLo;
+	multiplyWide(round1, round2, positiveHi, positiveLo);
+	multiplyWide(reply1, reply2, negativeHi, negativeLo);
+	// magnitude of the difference
+	bool negative = positiveHi < negativeHi || (positiveHi == negativeHi && positiveLo < negativeLo);
+	if(negative) {
+		uint64_t swap;
+		swap = positiveHi; positiveHi = negativeHi; negativeHi = swap;
+		swap = positiveLo; positiveLo = negativeLo; negativeLo = swap;
+	}
+	uint64_t hi = positiveHi-negativeHi-(positiveLo < negativeLo ? 1 : 0);
+	uint64_t lo = positiveLo-negativeLo;
+	// long division, the remainder (< sum < 2^42) shifted by 22 bits fits 64 bits
+	const uint64_t mask      = (1ULL << 22)-1;
+	uint64_t       quotient  = 0;
+	uint64_t       remainder = 0;
+	for(int8_t shift = 66; shift >= 0; shift -= 22) {
+		uint64_t digit;
+		if(shift >= 64) {
+			digit = hi >> (shift-64);
+		}
+		else if(shift > 42) {
+			digit = (lo >> shift) | (hi << (64-shift));
+		}
+		else {
+			digit = lo >> shift;
+		}
+		remainder = (remainder << 22) | (digit & mask);
+		quotient  = (quotient << 22) | (remainder/(uint64_t)sum);
+		remainder = remainder%(uint64_t)sum;
+	}
+	return negative ? -(int64_t)quotient : (int64_t)quotient;
+}
+
 /**
  * Converts negative values due overflow of one node to correct value
  * @example:
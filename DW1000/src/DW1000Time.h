@@ -19,8 +19,9 @@
  * Arduino driver library timestamp wrapper (header file) for the Decawave 
  * DW1000 UWB transceiver IC.
  * 
- * @TODO
- * - avoid/remove floating operations, expensive on most microprocessors
+ * @note
+ * time units and the range in millimeters are converted with exact integer
+ * ratios, the float getters/setters are kept for printing and compatibility.
  * 
  * @note
  * comments in cpp file, makes .h smaller and gives a better overview about
@@ -59,30 +60,72 @@ public:
 	static constexpr int64_t TIME_OVERFLOW = 0x10000000000; //1099511627776LL
 	static constexpr int64_t TIME_MAX      = 0xffffffffff;
 	
-	// time factors (relative to [us]) for setting delayed transceive
-	// TODO use non float
+	// time units for setting delayed transceive, scoped: the factors below
+	// have the same names
+	enum class TimeUnit : uint8_t {
+		NANOSECONDS,
+		MICROSECONDS,
+		MILLISECONDS,
+		SECONDS
+	};
+	
+	// time factors (relative to [us]), for the float setters
+	DEPRECATED_MSG("use DW1000Time::TimeUnit::SECONDS")
 	static constexpr float SECONDS      = 1e6;
+	DEPRECATED_MSG("use DW1000Time::TimeUnit::MILLISECONDS")
 	static constexpr float MILLISECONDS = 1e3;
+	DEPRECATED_MSG("use DW1000Time::TimeUnit::MICROSECONDS")
 	static constexpr float MICROSECONDS = 1;
+	DEPRECATED_MSG("use DW1000Time::TimeUnit::NANOSECONDS")
 	static constexpr float NANOSECONDS  = 1e-3;
 	
+	// a tick is 1/(128*499.2MHz), 63897.6 ticks per us -> 319488/5
+	static constexpr int64_t TICKS_PER_SECOND = 63897600000LL;
+	// speed of radio waves [299792458 m/s] in mm per tick -> 149896229/31948800
+	static constexpr int64_t MM_PER_TICK_NUM  = 149896229LL;
+	static constexpr int64_t MM_PER_TICK_DEN  = 31948800LL;
+	
+	// integer conversions, truncated towards zero like setTime(float)
+	static constexpr int64_t nanosecondsToTicks(int64_t ns) { return ns*39936/625; }
+	static constexpr int64_t microsecondsToTicks(int64_t us) { return us*319488/5; }
+	static constexpr int64_t millisecondsToTicks(int64_t ms) { return ms*(TICKS_PER_SECOND/1000); }
+	static constexpr int64_t secondsToTicks(int64_t s) { return s*TICKS_PER_SECOND; }
+	static constexpr int64_t toTicks(int64_t value, TimeUnit unit) {
+		return unit == TimeUnit::SECONDS ? secondsToTicks(value) :
+		       unit == TimeUnit::MILLISECONDS ? millisecondsToTicks(value) :
+		       unit == TimeUnit::MICROSECONDS ? microsecondsToTicks(value) : nanosecondsToTicks(value);
+	}
+	// distance d=c*t in mm, rounded; split so no product exceeds 53 bits
+	static constexpr int64_t ticksToMillimeters(int64_t ticks) {
+		return (ticks/MM_PER_TICK_DEN)*MM_PER_TICK_NUM
+		       +((ticks%MM_PER_TICK_DEN)*MM_PER_TICK_NUM+(ticks < 0 ? -MM_PER_TICK_DEN/2 : MM_PER_TICK_DEN/2))/MM_PER_TICK_DEN;
+	}
+	
+	// asymmetric two-way ranging (round1*round2-reply1*reply2)/(round1+round2+reply1+reply2)
+	// exact for durations of 0..TIME_MAX, the 80 bit products are split in 32 bit halves
+	static int64_t asymmetricTimeOfFlight(int64_t round1, int64_t reply1, int64_t round2, int64_t reply2);
+	
 	// constructor
 	DW1000Time();
 	DW1000Time(int64_t time);
 	DW1000Time(byte data[]);
 	DW1000Time(const DW1000Time& copy);
 	DW1000Time(float timeUs);
+	DW1000Time(int32_t value, TimeUnit unit);
+	DEPRECATED_MSG("use DW1000Time(value, DW1000Time::TimeUnit::MICROSECONDS) or another TimeUnit")
 	DW1000Time(int32_t value, float factorUs);
 	~DW1000Time();
 	
 	// setter
 	// dw1000 timestamp, increase of +1 approx approx. 15.65ps real time
 	void setTimestamp(int64_t value);
-	void setTimestamp(byte data[]);
+	void setTimestamp(const byte data[]);
 	void setTimestamp(const DW1000Time& copy);
 	
 	// real time in us
 	void setTime(float timeUs);
+	void setTime(int32_t value, TimeUnit unit);
+	DEPRECATED_MSG("use setTime(value, DW1000Time::TimeUnit::MICROSECONDS) or another TimeUnit")
 	void setTime(int32_t value, float factorUs);
 	
 	// getter
@@ -95,6 +138,7 @@ public:
 	float getAsMicroSeconds() const;
 	//void getAsBytes(byte data[]) const; // TODO check why it is here, is it old version of getTimestamp(byte) ?
 	float getAsMeters() const;
+	int64_t getAsMillimeters() const;
 	
 	DW1000Time& wrap();
 	
@@ -0,0 +1,274 @@
+/*
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000Transport.cpp
+ * SPI transports used by DW1000Class, see DW1000Transport.h.
+ */
+
+#include "DW1000Transport.h"
+
+#if defined(ESP32)
+#include <esp_heap_caps.h>
+#endif
+
+void DW1000SpiTransport::transfer(const SPISettings& settings, uint8_t ss, const byte header[], uint8_t headerLen,
+                                  byte data[], uint16_t n, boolean write) {
+	// header and data in chunks of one bulk transfer each, the first chunk
+	// carries the header, so a register access is usually a single one
+	byte     buffer[DW1000_SPI_CHUNK];
+	uint8_t  used = headerLen;
+	uint16_t done = 0;
+	memcpy(buffer, header, headerLen);
+	SPI.beginTransaction(settings);
+	digitalWrite(ss, LOW);
+	do {
+		uint16_t count = n-done;
+		if(count > DW1000_SPI_CHUNK-used) {
+			count = DW1000_SPI_CHUNK-used;
+		}
+		if(write) {
+			memcpy(buffer+used, data+done, count);
+		}
+		else {
+			memset(buffer+used, JUNK, count);
+		}
+		SPI.transfer(buffer, used+count);
+		if(!write) {
+			memcpy(data+done, buffer+used, count);
+		}
+		done += count;
+		used  = 0;
+	} while(done < n);
+	delayMicroseconds(5);
+	digitalWrite(ss, HIGH);
+	SPI.endTransaction();
+}
+
+#if defined(ESP32)
+DW1000Esp32DmaTransport::DW1000Esp32DmaTransport(spi_host_device_t host, int sck, int miso, int mosi)
+	: _host(host), _sck(sck), _miso(miso), _mosi(mosi), _initialized(false), _busInitialized(false), _failed(false),
+	  _ss(0xFF), _rxBuffer(nullptr), _head(0), _queued(0) {
+	for(uint8_t i = 0; i < 2; i++) {
+		_devices[i] = nullptr;
+		_clocks[i]  = 0;
+	}
+	for(uint8_t i = 0; i < DW1000_DMA_QUEUE; i++) {
+		_queuedOn[i] = nullptr;
+		_buffers[i]  = nullptr;
+	}
+}
+
+spi_device_handle_t DW1000Esp32DmaTransport::device(const SPISettings& settings, uint8_t ss) {
+	if(_failed) {
+		return nullptr;
+	}
+	if(!_initialized) {
+		_initialized = true;
+		_ss          = ss;
+		if(!start()) {
+			fallBack();
+			return nullptr;
+		}
+	}
+	if(ss != _ss) {
+		// other chip, chip select is part of the device
+		flush();
+		if(_failed) {
+			return nullptr;
+		}
+		for(uint8_t i = 0; i < 2; i++) {
+			if(_devices[i] != nullptr && spi_bus_remove_device(_devices[i]) != ESP_OK) {
+				fallBack();
+				return nullptr;
+			}
+			_devices[i] = nullptr;
+			_clocks[i]  = 0;
+		}
+		_ss = ss;
+	}
+	for(uint8_t i = 0; i < 2; i++) {
+		if(_devices[i] != nullptr && _clocks[i] == settings._clock) {
+			return _devices[i];
+		}
+	}
+	// new clock, replace the older device
+	flush();
+	if(_failed) {
+		return nullptr;
+	}
+	if(_devices[1] != nullptr) {
+		if(spi_bus_remove_device(_devices[1]) != ESP_OK) {
+			fallBack();
+			return nullptr;
+		}
+		_devices[1] = nullptr;
+	}
+	spi_device_interface_config_t config = {};
+	config.mode             = settings._dataMode;
+	config.clock_speed_hz   = settings._clock;
+	config.spics_io_num     = ss;
+	config.cs_ena_posttrans = 2;
+	config.queue_size       = DW1000_DMA_QUEUE;
+	spi_device_handle_t added = nullptr;
+	if(spi_bus_add_device(_host, &config, &added) != ESP_OK) {
+		fallBack();
+		return nullptr;
+	}
+	_devices[1] = _devices[0];
+	_clocks[1]  = _clocks[0];
+	_devices[0] = added;
+	_clocks[0]  = settings._clock;
+	return _devices[0];
+}
+
+boolean DW1000Esp32DmaTransport::start() {
+	// DW1000.begin() started the Arduino SPI class on the host, its HAL and
+	// the driver must not both drive it
+	SPI.end();
+	spi_bus_config_t bus = {};
+	bus.mosi_io_num     = _mosi;
+	bus.miso_io_num     = _miso;
+	bus.sclk_io_num     = _sck;
+	bus.quadwp_io_num   = -1;
+	bus.quadhd_io_num   = -1;
+	bus.max_transfer_sz = DW1000_DMA_BUFFER;
+	if(spi_bus_initialize(_host, &bus, SPI_DMA_CH_AUTO) != ESP_OK) {
+		return false;
+	}
+	_busInitialized = true;
+	for(uint8_t i = 0; i < DW1000_DMA_QUEUE; i++) {
+		_buffers[i] = (byte*)heap_caps_malloc(DW1000_DMA_BUFFER, MALLOC_CAP_DMA);
+		if(_buffers[i] == nullptr) {
+			return false;
+		}
+	}
+	_rxBuffer = (byte*)heap_caps_malloc(DW1000_DMA_BUFFER, MALLOC_CAP_DMA);
+	return _rxBuffer != nullptr;
+}
+
+void DW1000Esp32DmaTransport::fallBack() {
+	_failed = true;
+	// what is still in flight is lost, the driver refuses to let go of a
+	// device with pending transactions and the DMA may still read the buffers
+	boolean released = true;
+	for(uint8_t i = 0; i < 2; i++) {
+		if(_devices[i] != nullptr && spi_bus_remove_device(_devices[i]) != ESP_OK) {
+			released = false;
+		}
+		_devices[i] = nullptr;
+	}
+	if(_busInitialized && (!released || spi_bus_free(_host) != ESP_OK)) {
+		released = false;
+	}
+	_busInitialized = false;
+	if(released) {
+		for(uint8_t i = 0; i < DW1000_DMA_QUEUE; i++) {
+			heap_caps_free(_buffers[i]);
+			_buffers[i] = nullptr;
+		}
+		heap_caps_free(_rxBuffer);
+		_rxBuffer = nullptr;
+	}
+	_queued = 0;
+	// chip select back from the peripheral to the GPIO DW1000SpiTransport drives
+	if(_ss != 0xFF) {
+		pinMode(_ss, OUTPUT);
+		digitalWrite(_ss, HIGH);
+	}
+	SPI.begin(_sck, _miso, _mosi);
+}
+
+void DW1000Esp32DmaTransport::collect(boolean block) {
+	spi_transaction_t* done;
+	while(_queued > 0) {
+		if(spi_device_get_trans_result(_queuedOn[_head], &done, block ? portMAX_DELAY : 0) != ESP_OK) {
+			if(block) {
+				// not a timeout, the driver failed
+				fallBack();
+			}
+			return;
+		}
+		_head = (_head+1) % DW1000_DMA_QUEUE;
+		_queued--;
+	}
+}
+
+void DW1000Esp32DmaTransport::transfer(const SPISettings& settings, uint8_t ss, const byte header[], uint8_t headerLen,
+                                       byte data[], uint16_t n, boolean write) {
+	collect(true);
+	spi_device_handle_t handle = device(settings, ss);
+	if(handle == nullptr) {
+		_fallback.transfer(settings, ss, header, headerLen, data, n, write);
+		return;
+	}
+	byte* tx = _buffers[_head];
+	memcpy(tx, header, headerLen);
+	if(write) {
+		memcpy(tx+headerLen, data, n);
+	}
+	else {
+		memset(tx+headerLen, JUNK, n);
+	}
+	spi_transaction_t transaction = {};
+	transaction.length    = (headerLen+n)*8;
+	transaction.tx_buffer = tx;
+	transaction.rx_buffer = write ? nullptr : _rxBuffer;
+	// short register accesses, polling is cheaper than the interrupt
+	if(spi_device_polling_transmit(handle, &transaction) != ESP_OK) {
+		fallBack();
+		_fallback.transfer(settings, ss, header, headerLen, data, n, write);
+		return;
+	}
+	if(!write) {
+		memcpy(data, _rxBuffer+headerLen, n);
+	}
+}
+
+void DW1000Esp32DmaTransport::queueWrite(const SPISettings& settings, uint8_t ss, const byte header[], uint8_t headerLen,
+                                         const byte data[], uint16_t n) {
+	if(_queued == DW1000_DMA_QUEUE) {
+		collect(true);
+	}
+	spi_device_handle_t handle = device(settings, ss);
+	if(handle == nullptr) {
+		_fallback.queueWrite(settings, ss, header, headerLen, data, n);
+		return;
+	}
+	uint8_t slot = (_head+_queued) % DW1000_DMA_QUEUE;
+	byte*   tx   = _buffers[slot];
+	memcpy(tx, header, headerLen);
+	memcpy(tx+headerLen, data, n);
+	spi_transaction_t& transaction = _transactions[slot];
+	memset(&transaction, 0, sizeof(transaction));
+	transaction.length    = (headerLen+n)*8;
+	transaction.tx_buffer = tx;
+	if(spi_device_queue_trans(handle, &transaction, portMAX_DELAY) != ESP_OK) {
+		fallBack();
+		_fallback.queueWrite(settings, ss, header, headerLen, data, n);
+		return;
+	}
+	_queuedOn[slot] = handle;
+	_queued++;
+}
+
+boolean DW1000Esp32DmaTransport::busy() {
+	collect(false);
+	return _queued > 0;
+}
+
+void DW1000Esp32DmaTransport::flush() {
+	collect(true);
+}
+#endif
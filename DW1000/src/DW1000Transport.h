@@ -0,0 +1,136 @@
+/*
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000Transport.h
+ * SPI transports used by DW1000Class for all register access.
+ *
+ * A transport runs one transaction per call: chip select low, the 1-3 byte
+ * header built by DW1000Class, the data written or read, chip select high.
+ * Writes may also be queued with queueWrite(): the data is copied, the call
+ * returns while the transaction is still clocked out and queued writes
+ * complete in order. Every transfer() waits for the queue first, so a read
+ * always sees the queued writes. busy() polls and flush() waits for the end
+ * of the queue.
+ *
+ * DW1000SpiTransport (the default) uses the Arduino SPI class with bulk
+ * transfers and runs queued writes right away. DW1000Esp32DmaTransport drives
+ * an ESP32 SPI host with DMA through the ESP-IDF driver and queues writes in
+ * the background, it falls back to DW1000SpiTransport if the driver fails.
+ * Select a transport with DW1000.setTransport().
+ */
+
+#ifndef _DW1000Transport_H_INCLUDED
+#define _DW1000Transport_H_INCLUDED
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "DW1000Constants.h"
+
+// bytes per bulk SPI.transfer(), the ESP32 SPI FIFO
+#ifndef DW1000_SPI_CHUNK
+#define DW1000_SPI_CHUNK 64
+#endif
+
+class DW1000Transport {
+public:
+	virtual ~DW1000Transport() {}
+
+	/* one transaction on the chip at ss: header, then n bytes written from or read into data */
+	virtual void transfer(const SPISettings& settings, uint8_t ss, const byte header[], uint8_t headerLen,
+	                      byte data[], uint16_t n, boolean write) = 0;
+	/* a write which may still be in progress on return, data can be reused right away */
+	virtual void queueWrite(const SPISettings& settings, uint8_t ss, const byte header[], uint8_t headerLen,
+	                        const byte data[], uint16_t n) {
+		transfer(settings, ss, header, headerLen, (byte*)data, n, true);
+	}
+	/* queued writes in progress */
+	virtual boolean busy() {
+		return false;
+	}
+	/* wait until all queued writes completed */
+	virtual void flush() {}
+};
+
+class DW1000SpiTransport : public DW1000Transport {
+public:
+	void transfer(const SPISettings& settings, uint8_t ss, const byte header[], uint8_t headerLen,
+	              byte data[], uint16_t n, boolean write) override;
+};
+
+#if defined(ESP32)
+#include <driver/spi_master.h>
+
+// transactions in flight, each with a buffer for the largest frame
+#ifndef DW1000_DMA_QUEUE
+#define DW1000_DMA_QUEUE 4
+#endif
+#define DW1000_DMA_BUFFER (3+LEN_EXT_UWB_FRAMES)
+
+class DW1000Esp32DmaTransport : public DW1000Transport {
+public:
+	/* SPI host with DMA and its pins (Makerfabs ESP32 UWB: VSPI, 18/19/23), the
+	host and pins DW1000.begin() started the Arduino SPI class on. On first use
+	the transport ends the Arduino SPI class (SPI.end()) and initialises the
+	host with the ESP-IDF driver, do not begin or use the SPI class again while
+	the transport is selected. Chip select is driven by the peripheral. If the
+	driver or its DMA buffers cannot be had, or a transaction fails, the
+	transport releases the host, begins the SPI class on the pins again and
+	goes on as DW1000SpiTransport, see failed(). The ESP-IDF driver blocks on a
+	semaphore, so with this transport DW1000Class::handleInterrupt() has to run
+	in a task (attach an interrupt of your own which notifies it) instead of
+	the GPIO interrupt DW1000.begin() attaches. */
+	DW1000Esp32DmaTransport(spi_host_device_t host = SPI3_HOST, int sck = 18, int miso = 19, int mosi = 23);
+
+	void    transfer(const SPISettings& settings, uint8_t ss, const byte header[], uint8_t headerLen,
+	                 byte data[], uint16_t n, boolean write) override;
+	void    queueWrite(const SPISettings& settings, uint8_t ss, const byte header[], uint8_t headerLen,
+	                   const byte data[], uint16_t n) override;
+	boolean busy() override;
+	void    flush() override;
+	/* the driver failed, all transfers go through the Arduino SPI class */
+	boolean failed() const {
+		return _failed;
+	}
+
+private:
+	// one device per SPI clock (the DW1000 runs slow until its PLL locked),
+	// nullptr once failed
+	spi_device_handle_t device(const SPISettings& settings, uint8_t ss);
+	// the host from the Arduino SPI class, and the DMA buffers
+	boolean start();
+	// release what we have of the host and hand it back to the SPI class
+	void fallBack();
+	// collect completed transactions, waiting for them if block
+	void collect(boolean block);
+
+	spi_host_device_t   _host;
+	int                 _sck, _miso, _mosi;
+	boolean             _initialized;
+	boolean             _busInitialized;
+	boolean             _failed;
+	DW1000SpiTransport  _fallback;
+	spi_device_handle_t _devices[2];
+	uint32_t            _clocks[2];
+	uint8_t             _ss;
+	spi_transaction_t   _transactions[DW1000_DMA_QUEUE];
+	spi_device_handle_t _queuedOn[DW1000_DMA_QUEUE];
+	byte*               _buffers[DW1000_DMA_QUEUE];
+	byte*               _rxBuffer;
+	uint8_t             _head;   // oldest transaction in flight
+	uint8_t             _queued; // transactions in flight
+};
+#endif
+
+#endif
@@ -79,8 +79,9 @@ void setup() {
     // Initialize DW1000 ranging
     DW1000Ranging.initCommunication(PIN_RST, PIN_SS, PIN_IRQ);
     
-    // Start as anchor
-    DW1000Ranging.startAsAnchor(ANCHOR_ADDR, DW1000.MODE_LONGDATA_RANGE_LOWPOWER);
+    // Start as anchor, with the first two bytes of ANCHOR_ADDR as short address:
+    // the tag looks up our position by it
+    DW1000Ranging.startAsAnchor(ANCHOR_ADDR, DW1000.MODE_LONGDATA_RANGE_LOWPOWER, false);
     
     // Attach callback handlers
     DW1000Ranging.attachNewRange(newRange);
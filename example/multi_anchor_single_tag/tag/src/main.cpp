@@ -2,6 +2,7 @@
 #include <Wire.h>
 #include <SPI.h>
 #include "DW1000Ranging.h"
+#include "DW1000Multilateration.h"
 
 // Display support
 #include <Adafruit_GFX.h>
@@ -40,6 +41,28 @@ struct AnchorInfo {
 AnchorInfo knownAnchors[MAX_ANCHORS];
 int anchorCount = 0;
 
+// Anchor positions in meters, by short address: the first two bytes of the
+// anchor's ANCHOR_ADDR, low byte first ("86:17:5B:..." is 0x1786). Anchors
+// not listed here are ranged but not used for the position.
+struct AnchorPosition {
+    uint16_t shortAddress;
+    float position[2];
+};
+
+const AnchorPosition ANCHOR_POSITIONS[] = {
+    { 0x1782, { 0.0f, 0.0f } },
+    { 0x1783, { 5.0f, 0.0f } },
+    { 0x1784, { 5.0f, 4.0f } },
+    { 0x1785, { 0.0f, 4.0f } },
+    { 0x1786, { 2.5f, 6.0f } },
+};
+
+// 2D position from the ranges, use DW1000Multilateration<MAX_ANCHORS, 3> and
+// x, y, z anchor positions for 3D (needs anchors at different heights)
+DW1000Multilateration<MAX_ANCHORS, 2> multilateration;
+float tagPosition[2];
+bool tagPositionValid = false;
+
 // Statistics
 uint32_t totalRanges = 0;
 uint32_t lastStatsTime = 0;
@@ -56,6 +79,7 @@ void updateAnchorInfo(DW1000Device* device);
 int getActiveAnchorCount();
 void checkInactiveAnchors();
 void printStatistics();
+const float* findAnchorPosition(uint16_t shortAddress);
 void calculatePosition();
 void displayInit();
 void displayUpdate();
@@ -418,43 +442,43 @@ void printStatistics() {
     Serial.println();
 }
 
+const float* findAnchorPosition(uint16_t shortAddress) {
+    for (size_t i = 0; i < sizeof(ANCHOR_POSITIONS)/sizeof(ANCHOR_POSITIONS[0]); i++) {
+        if (ANCHOR_POSITIONS[i].shortAddress == shortAddress) {
+            return ANCHOR_POSITIONS[i].position;
+        }
+    }
+    return nullptr;
+}
+
 void calculatePosition() {
-    // Simple trilateration example (requires at least 3 anchors)
-    // This is a basic implementation - real positioning would use more sophisticated algorithms
-    
-    int activeCount = 0;
-    float ranges[MAX_ANCHORS];
-    uint16_t addresses[MAX_ANCHORS];
-    
-    // Collect active anchor data
-    for (int i = 0; i < anchorCount && activeCount < MAX_ANCHORS; i++) {
-        if (knownAnchors[i].isActive && knownAnchors[i].lastRange > 0) {
-            ranges[activeCount] = knownAnchors[i].lastRange;
-            addresses[activeCount] = knownAnchors[i].shortAddress;
-            activeCount++;
+    // Multilateration over all active anchors with a known position: linearized
+    // least squares, refined by Gauss-Newton (well below a millisecond on the ESP32)
+    multilateration.clear();
+    for (int i = 0; i < anchorCount; i++) {
+        const float* position = findAnchorPosition(knownAnchors[i].shortAddress);
+        if (knownAnchors[i].isActive && knownAnchors[i].lastRange > 0 && position != nullptr) {
+            multilateration.add(position, knownAnchors[i].lastRange);
         }
     }
     
-    if (activeCount >= 3) {
-        Serial.println("\n--- Position Calculation ---");
-        Serial.print("Using ");
-        Serial.print(activeCount);
-        Serial.println(" anchors for positioning:");
-        
-        for (int i = 0; i < activeCount; i++) {
-            Serial.print("  Anchor 0x");
-            Serial.print(addresses[i], HEX);
-            Serial.print(": ");
-            Serial.print(ranges[i], 2);
-            Serial.println("m");
-        }
-        
-        // Here you would implement actual trilateration/multilateration
-        // For now, just show that we have the data needed
-        Serial.println("  [Position calculation would be implemented here]");
-        Serial.println("  [Requires known anchor positions and trilateration algorithm]");
-        Serial.println("----------------------------\n");
+    tagPositionValid = multilateration.solve(tagPosition);
+    if (!tagPositionValid) {
+        // fewer than 3 anchors with a known position, or all of them on a line
+        return;
     }
+    
+    Serial.print("Position: x=");
+    Serial.print(tagPosition[0], 2);
+    Serial.print("m y=");
+    Serial.print(tagPosition[1], 2);
+    Serial.print("m (");
+    Serial.print(multilateration.count());
+    Serial.print(" anchors, residual ");
+    Serial.print(multilateration.residual(), 2);
+    Serial.print("m, ");
+    Serial.print(multilateration.iterations());
+    Serial.println(" iterations)");
 }
 
 // Additional utility functions for advanced usage
@@ -0,0 +1,40 @@
+/*
+ * Device Table Footprint
+ *
+ * RAM taken by the device table of DW1000RangingT<Capacity, DeviceState>
+ * (devices, hot array, slot list and short address index) for the full
+ * DW1000Device and the role specific DW1000AnchorDevice / DW1000TagDevice, as
+ * compiled for the host. Sizes on the ESP32 differ only by alignment.
+ *
+ * Build and run with: make -C test bench
+ */
+
+#include <stdio.h>
+
+#include "DW1000Ranging.h"
+
+template<uint8_t Capacity, class DeviceState>
+static unsigned tableBytes() {
+	return Capacity*(sizeof(DeviceState)+sizeof(DW1000DeviceHot)+1)+sizeof(DW1000DeviceIndex<Capacity>);
+}
+
+template<uint8_t Capacity>
+static void printRow() {
+	unsigned full   = tableBytes<Capacity, DW1000Device>();
+	unsigned anchor = tableBytes<Capacity, DW1000AnchorDevice>();
+	unsigned tag    = tableBytes<Capacity, DW1000TagDevice>();
+	printf("%8d | %11u | %11u (%3.0f%%) | %11u (%3.0f%%)\n",
+	       Capacity, full, anchor, 100.0*anchor/full, tag, 100.0*tag/full);
+}
+
+int main() {
+	printf("=== Device Table Footprint ===\n\n");
+	printf("per device: DW1000Device %u B, DW1000AnchorDevice %u B, DW1000TagDevice %u B\n\n",
+	       (unsigned)sizeof(DW1000Device), (unsigned)sizeof(DW1000AnchorDevice), (unsigned)sizeof(DW1000TagDevice));
+	printf("capacity | full [B]    | anchor [B]        | tag [B]\n");
+	printRow<4>();
+	printRow<16>();
+	printRow<64>();
+	printRow<128>();
+	return 0;
+}
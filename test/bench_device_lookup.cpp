@@ -0,0 +1,123 @@
+/*
+ * Device Lookup Benchmark
+ *
+ * Cost of finding the sender of a received frame in the device table
+ * (DW1000RangingClass::searchDistantDevice) versus the number of known
+ * devices, against the linear memcmp scan it replaced. The library is linked
+ * directly (no simulator) and built with MAX_DEVICES=128.
+ *
+ * Build and run with: make -C test bench
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "DW1000Ranging.h"
+
+#define LOOKUPS 2000000
+
+// previous implementation of searchDistantDevice()
+static DW1000Device* linearSearch(byte shortAddress[]) {
+	for(uint16_t i = 0; i < DW1000Ranging.getNetworkDevicesNumber(); i++) {
+		if(memcmp(shortAddress, DW1000Ranging.getNetworkDevice(i)->getByteShortAddress(), 2) == 0) {
+			return DW1000Ranging.getNetworkDevice(i);
+		}
+	}
+	return nullptr;
+}
+
+static uint32_t rng = 12345;
+
+static uint32_t nextRandom() {
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static void fill(int count) {
+	DW1000Ranging.initCommunication();
+	for(int i = 0; i < count; i++) {
+		byte shortAddress[2];
+		do {
+			shortAddress[0] = nextRandom();
+			shortAddress[1] = nextRandom();
+		} while(DW1000Ranging.searchDistantDevice(shortAddress) != nullptr);
+		DW1000Device device(shortAddress, true);
+		DW1000Ranging.addNetworkDevices(&device, true);
+	}
+}
+
+// addresses of received frames: mostly known devices, some strangers
+static std::vector<uint16_t> frames(int count) {
+	std::vector<uint16_t> addresses(4096);
+	for(uint16_t& address : addresses) {
+		if(nextRandom()%8 == 0) {
+			address = (uint16_t)nextRandom();
+		}
+		else {
+			byte* shortAddress = DW1000Ranging.getNetworkDevice(nextRandom()%count)->getByteShortAddress();
+			address            = (uint16_t)shortAddress[0] << 8 | shortAddress[1];
+		}
+	}
+	return addresses;
+}
+
+template<typename Search>
+static double measure(const std::vector<uint16_t>& addresses, Search search, uintptr_t& sink) {
+	auto start = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < LOOKUPS; i++) {
+		uint16_t address = addresses[i & 4095];
+		byte     shortAddress[2] = { (byte)(address >> 8), (byte)address };
+		sink += (uintptr_t)search(shortAddress);
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end-start).count()/LOOKUPS;
+}
+
+static bool checkChurn() {
+	// remove/insert in random order and compare against the linear scan
+	fill(64);
+	for(int round = 0; round < 10000; round++) {
+		if(nextRandom()%2 && DW1000Ranging.getNetworkDevicesNumber() > 0) {
+			DW1000Ranging.removeNetworkDevices(nextRandom()%DW1000Ranging.getNetworkDevicesNumber());
+		}
+		else {
+			byte shortAddress[2] = { (byte)nextRandom(), (byte)nextRandom() };
+			DW1000Device device(shortAddress, true);
+			DW1000Ranging.addNetworkDevices(&device, true);
+		}
+		for(int probe = 0; probe < 16; probe++) {
+			byte shortAddress[2] = { (byte)nextRandom(), (byte)nextRandom() };
+			if(probe < 8 && DW1000Ranging.getNetworkDevicesNumber() > 0) {
+				memcpy(shortAddress, DW1000Ranging.getNetworkDevice(nextRandom()%DW1000Ranging.getNetworkDevicesNumber())->getByteShortAddress(), 2);
+			}
+			if(DW1000Ranging.searchDistantDevice(shortAddress) != linearSearch(shortAddress)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main() {
+	printf("=== Device Lookup Benchmark (MAX_DEVICES %d, %d lookups, 1/8 unknown senders) ===\n\n", MAX_DEVICES, LOOKUPS);
+	if(!checkChurn()) {
+		printf("✗ FAIL: index and linear scan disagree\n");
+		return 1;
+	}
+	printf("devices | linear [ns] | index [ns] | speedup\n");
+	uintptr_t sink = 0;
+	const int counts[] = { 4, 8, 16, 32, 64, 128 };
+	for(int count : counts) {
+		fill(count);
+		std::vector<uint16_t> addresses = frames(count);
+		double linear = measure(addresses, linearSearch, sink);
+		double index  = measure(addresses, DW1000RangingClass::searchDistantDevice, sink);
+		printf("%7d | %11.2f | %10.2f | %6.1fx\n", count, linear, index, linear/index);
+	}
+	return sink == 1 ? 1 : 0;
+}
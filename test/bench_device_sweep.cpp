@@ -0,0 +1,238 @@
+/*
+ * Device Sweep Benchmark
+ *
+ * Cost of the per-loop() work on the device table for 32/64/128 known devices.
+ * "prev." are the two passes loop() used to make (isAnyDeviceActive() and the
+ * protocol timeout check) over whole device objects with the previous
+ * DW1000Device layout (addresses, six timestamps and protocol state in one
+ * object). "hot" are the same two passes over the packed hot array
+ * (isAnyDeviceActive(), getActiveDeviceCount()). "loop()" is a complete idle
+ * iteration with the deadline heaps, which visits no device unless a deadline
+ * expired. Before that, the timeout handling is checked against a full scan
+ * on a simulated clock. "cold" writes EVICT_BYTES
+ * before every sweep, as the frame processing in between does, which clears
+ * L1/L2 but not a large L3. The library is linked directly (no simulator) and
+ * built with MAX_DEVICES=128.
+ *
+ * Build and run with: make -C test bench
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "DW1000Ranging.h"
+#include "DW1000SimNode.h"
+
+#define SWEEPS 200000
+#define COLD_SWEEPS 2000
+#define EVICT_BYTES (16*1024*1024)
+
+// DW1000Device before the hot/cold split
+struct LegacyDevice {
+	DW1000Time       timePollSent;
+	DW1000Time       timePollReceived;
+	DW1000Time       timePollAckSent;
+	DW1000Time       timePollAckReceived;
+	DW1000Time       timeRangeSent;
+	DW1000Time       timeRangeReceived;
+	byte             ownAddress[8];
+	byte             shortAddress[2];
+	int32_t          activity;
+	uint16_t         replyDelayTimeUS;
+	int8_t           index;
+	int16_t          range;
+	int16_t          RXPower;
+	int16_t          FPPower;
+	int16_t          quality;
+	ProtocolState    protocolState;
+	MessageType      expectedMsgId;
+	volatile boolean sentAck;
+	volatile boolean receivedAck;
+	boolean          protocolFailed;
+	uint32_t         lastProtocolActivity;
+
+	boolean isProtocolActive() {
+		return (protocolState != PROTOCOL_IDLE && protocolState != PROTOCOL_FAILED);
+	}
+};
+
+static LegacyDevice legacyDevices[MAX_DEVICES];
+static uint8_t      legacySlots[MAX_DEVICES];
+static int          legacyCount;
+
+static uint32_t rng = 12345;
+
+static uint32_t nextRandom() {
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+// previous loop(): checkForReset() and handleDeviceTimeout() through the slot list into whole objects
+static int legacySweep() {
+	int result = 0;
+	for(int i = 0; i < legacyCount; i++) {
+		if(legacyDevices[legacySlots[i]].isProtocolActive()) {
+			result++;
+			break;
+		}
+	}
+	for(int i = 0; i < legacyCount; i++) {
+		LegacyDevice& device = legacyDevices[legacySlots[i]];
+		if(device.isProtocolActive() && millis()-device.lastProtocolActivity > PROTOCOL_TIMEOUT) {
+			result++;
+		}
+	}
+	return result;
+}
+
+static int librarySweep() {
+	return DW1000Ranging.isAnyDeviceActive()+DW1000Ranging.getActiveDeviceCount();
+}
+
+static int libraryLoop() {
+	DW1000Ranging.loop();
+	return 0;
+}
+
+// simulated clock for the timeout check
+static uint64_t clockNs = 0;
+
+static uint64_t clockNow(void* ctx) {
+	(void)ctx;
+	return clockNs;
+}
+
+static int timeouts = 0;
+
+static void protocolError(DW1000Device* device, int errorCode) {
+	(void)device;
+	if(errorCode == -1) {
+		timeouts++;
+	}
+}
+
+static void fill(int count) {
+	// churn first so that the slots are not in network order
+	DW1000Ranging.initCommunication();
+	for(int round = 0; round < 4*count; round++) {
+		if(DW1000Ranging.getNetworkDevicesNumber() == count || (nextRandom()%3 == 0 && DW1000Ranging.getNetworkDevicesNumber() > 0)) {
+			DW1000Ranging.removeNetworkDevices(nextRandom()%DW1000Ranging.getNetworkDevicesNumber());
+		}
+		byte shortAddress[2] = { (byte)nextRandom(), (byte)nextRandom() };
+		DW1000Device device(shortAddress, true);
+		DW1000Ranging.addNetworkDevices(&device, true);
+	}
+	while(DW1000Ranging.getNetworkDevicesNumber() < count) {
+		byte shortAddress[2] = { (byte)nextRandom(), (byte)nextRandom() };
+		DW1000Device device(shortAddress, true);
+		DW1000Ranging.addNetworkDevices(&device, true);
+	}
+	legacyCount = count;
+	for(int i = 0; i < count; i++) {
+		legacySlots[i] = DW1000Ranging.getNetworkDevice(i)->getIndex();
+		LegacyDevice& device = legacyDevices[legacySlots[i]];
+		memset((void*)&device, 0, sizeof(device));
+		memcpy(device.shortAddress, DW1000Ranging.getNetworkDevice(i)->getByteShortAddress(), 2);
+		device.protocolState = PROTOCOL_IDLE;
+	}
+}
+
+// random protocol activity; the deadline heap must report exactly the
+// timeouts a full scan finds
+static bool checkTimeouts() {
+	// fill() starts the radio, which needs the simulator hooks beyond the clock
+	fill(64);
+	DW1000SimHooks hooks = {};
+	hooks.nowNs = clockNow;
+	hostBindHooks(&hooks);
+	clockNs = 5000000000ULL;
+	DW1000Ranging.attachProtocolError(protocolError);
+	bool passed = true;
+	for(int round = 0; round < 20000 && passed; round++) {
+		clockNs += (nextRandom()%300)*1000000ULL;
+		for(int change = nextRandom()%4; change > 0; change--) {
+			DW1000Device* device = DW1000Ranging.getNetworkDevice(nextRandom()%DW1000Ranging.getNetworkDevicesNumber());
+			if(nextRandom()%3) {
+				device->setProtocolState(PROTOCOL_POLL_SENT);
+				device->noteProtocolActivity();
+			}
+			else {
+				device->setProtocolState(PROTOCOL_IDLE);
+			}
+		}
+		int expected = 0;
+		for(int i = 0; i < DW1000Ranging.getNetworkDevicesNumber(); i++) {
+			if(DW1000Ranging.getNetworkDevice(i)->isProtocolTimedOut(PROTOCOL_TIMEOUT)) {
+				expected++;
+			}
+		}
+		timeouts = 0;
+		DW1000Ranging.handleDeviceTimeout();
+		passed = timeouts == expected;
+	}
+	DW1000Ranging.attachProtocolError(nullptr);
+	hostBindHooks(nullptr);
+	return passed;
+}
+
+static std::vector<char> evictBuffer(EVICT_BYTES);
+
+static void evict() {
+	for(size_t i = 0; i < evictBuffer.size(); i += 64) {
+		evictBuffer[i]++;
+	}
+}
+
+template<typename Sweep>
+static double measureWarm(Sweep sweep, int& sink) {
+	auto start = std::chrono::steady_clock::now();
+	for(int i = 0; i < SWEEPS; i++) {
+		sink += sweep();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end-start).count()/SWEEPS;
+}
+
+template<typename Sweep>
+static double measureCold(Sweep sweep, int& sink) {
+	double total = 0;
+	for(int i = 0; i < COLD_SWEEPS; i++) {
+		evict();
+		auto start = std::chrono::steady_clock::now();
+		sink += sweep();
+		auto end = std::chrono::steady_clock::now();
+		total += std::chrono::duration<double, std::nano>(end-start).count();
+	}
+	return total/COLD_SWEEPS;
+}
+
+int main() {
+	printf("=== Device Sweep Benchmark (MAX_DEVICES %d, %d warm / %d cold sweeps) ===\n\n", MAX_DEVICES, SWEEPS, COLD_SWEEPS);
+	printf("hot entry %u B, device object %u B, previous device object %u B\n\n",
+	       (unsigned)sizeof(DW1000DeviceHot), (unsigned)sizeof(DW1000Device), (unsigned)sizeof(LegacyDevice));
+	if(!checkTimeouts()) {
+		printf("✗ FAIL: deadline heap and full scan disagree\n");
+		return 1;
+	}
+	printf("         | warm [ns]                  | cold [ns]\n");
+	printf("devices  | prev.  | hot    | loop()   | prev.  | hot    | loop()\n");
+	int sink = 0;
+	const int counts[] = { 32, 64, 128 };
+	for(int count : counts) {
+		fill(count);
+		double warmLegacy = measureWarm(legacySweep, sink);
+		double warmHot    = measureWarm(librarySweep, sink);
+		double warmLoop   = measureWarm(libraryLoop, sink);
+		double coldLegacy = measureCold(legacySweep, sink);
+		double coldHot    = measureCold(librarySweep, sink);
+		double coldLoop   = measureCold(libraryLoop, sink);
+		printf("%8d | %6.1f | %6.1f | %8.1f | %6.1f | %6.1f | %6.1f\n",
+		       count, warmLegacy, warmHot, warmLoop, coldLegacy, coldHot, coldLoop);
+	}
+	return sink == -1 ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * Message Queue Benchmark
+ *
+ * Time the received frames wait in the DW1000Ranging message queue (ISR to
+ * handling in loop()) for one tag and 4 anchors, for per-loop() message
+ * budgets of 1 (one message per loop(), the old behaviour), 2, 4 and 8 (the
+ * default, a full queue). Every node queues all frames it hears, also those
+ * for other devices. The loop interval stands for the rest of the sketch:
+ * 0.1 ms is an empty loop(), 10-25 ms a sketch which also drives a display or
+ * network. The anchors answer a POLL 7/21/35/49 ms after it, so frames only
+ * stack up once loop() is that slow. Reports the latency percentiles over all
+ * nodes, the deepest queue and the frames dropped because the queue was full.
+ *
+ * Build and run with: make -C test bench
+ */
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "DW1000.h"
+#include "DW1000Sim.h"
+
+#define SIM_SECONDS 10
+#define FLOOR_SIZE_M 12.0
+#define DEAF_DB 200.0
+#define TAGS 1
+#define ANCHORS 4
+
+static std::vector<uint32_t> latencies;
+static uint64_t              ranges = 0;
+
+static void queueLatency(uint32_t us) {
+	latencies.push_back(us);
+}
+
+static void newRange() {
+	if(DW1000Sim::current()->index() < TAGS) {
+		ranges++;
+	}
+}
+
+static void address(char* out, uint8_t first, uint8_t second) {
+	sprintf(out, "%02X:%02X:22:EA:82:60:3B:9C", first, second);
+}
+
+static uint32_t percentile(double p) {
+	return latencies[std::min(latencies.size()-1, (size_t)(p*latencies.size()))];
+}
+
+static void runScenario(uint32_t loopIntervalNs, uint8_t budget) {
+	DW1000SimConfig config;
+	config.seed           = 77;
+	config.loopIntervalNs = loopIntervalNs;
+	DW1000Sim sim(config);
+
+	// same floor as bench_network.cpp, tags first
+	for(int i = 0; i < TAGS; i++) {
+		sim.addNode((sim.random()%1000)/1000.0*FLOOR_SIZE_M, (sim.random()%1000)/1000.0*FLOOR_SIZE_M, 1.0);
+	}
+	const double corners[4][2] = { { 0, 0 }, { FLOOR_SIZE_M, 0 }, { FLOOR_SIZE_M, FLOOR_SIZE_M }, { 0, FLOOR_SIZE_M } };
+	for(int i = 0; i < ANCHORS; i++) {
+		DW1000SimNode& anchor = sim.addNode(corners[i][0], corners[i][1], 2.5);
+		anchor.extraLossDb = DEAF_DB;
+		char addr[24];
+		address(addr, 0x82+i, 0x17);
+		anchor.initCommunication();
+		anchor.exec([budget](const DW1000SimNodeApi* api) { api->setMessageBudget(budget); });
+		anchor.startAsAnchor(addr, DW1000Class::MODE_LONGDATA_RANGE_LOWPOWER);
+	}
+	for(int i = 0; i < TAGS; i++) {
+		char addr[24];
+		address(addr, 0x7D, i);
+		DW1000SimNode& tag = sim.node(i);
+		tag.initCommunication();
+		tag.exec([budget](const DW1000SimNodeApi* api) {
+			api->setMessageBudget(budget);
+			api->attachNewRange(newRange);
+		});
+		tag.startAsTag(addr, DW1000Class::MODE_LONGDATA_RANGE_LOWPOWER);
+		sim.runFor(sim.random()%100000000);
+	}
+	for(int i = 0; i < ANCHORS; i++) {
+		sim.node(TAGS+i).extraLossDb = 0;
+		sim.runFor(4000000000ULL);
+	}
+
+	latencies.clear();
+	ranges = 0;
+	for(int i = 0; i < TAGS+ANCHORS; i++) {
+		sim.node(i).exec([](const DW1000SimNodeApi* api) {
+			api->resetMessageQueueStats();
+			api->attachQueueLatency(queueLatency);
+		});
+	}
+	sim.runFor(SIM_SECONDS*1000000000ULL);
+
+	uint32_t dropped  = 0;
+	uint8_t  maxDepth = 0;
+	for(int i = 0; i < TAGS+ANCHORS; i++) {
+		dropped += sim.node(i).api()->getDroppedMessages();
+		maxDepth = std::max(maxDepth, sim.node(i).api()->getMessageQueueMaxDepth());
+	}
+	std::sort(latencies.begin(), latencies.end());
+	if(latencies.empty()) {
+		latencies.push_back(0);
+	}
+	printf("%9.1f | %6d | %7u | %7u | %7u | %7u | %5u | %7u | %8.1f\n",
+	       loopIntervalNs/1e6, budget,
+	       percentile(0.5), percentile(0.9), percentile(0.99), latencies.back(),
+	       maxDepth, dropped, ranges/(double)SIM_SECONDS);
+}
+
+int main() {
+	printf("=== Message Queue Benchmark (%d tag, %d anchors, %d s simulated) ===\n\n",
+	       TAGS, ANCHORS, SIM_SECONDS);
+	printf("loop int. | budget | p50     | p90     | p99     | max     | max   | dropped | ranges/s\n");
+	printf("[ms]      |        | [us]    | [us]    | [us]    | [us]    | depth |         | (floor)\n");
+	const uint32_t intervals[] = { 100000, 10000000, 20000000, 25000000 };
+	const uint8_t  budgets[]   = { 1, 2, 4, 8 };
+	for(uint32_t interval : intervals) {
+		for(uint8_t budget : budgets) {
+			runScenario(interval, budget);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Multilateration Benchmark
+ *
+ * Solves per second of DW1000Multilateration (linearized least squares and
+ * Gauss-Newton) in 2D and 3D for 4-16 anchors: anchors in a 20x20 m room
+ * (3 m high in 3D), Dimensions+1 of them in its corners, tags at least 1 m
+ * from every anchor, ranges with 10 cm of gaussian noise. The "linear" error
+ * is that of solveLinear() alone, "solved" the one of solve() with the
+ * Gauss-Newton iterations (mean and most taken). Cycles are counted with the time stamp counter of the host
+ * CPU; the ESP32 has a single precision FPU and runs at 240 MHz, so expect
+ * it to take tens of times as long.
+ *
+ * Build and run with: make -C test bench
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES() __rdtsc()
+#else
+#define CYCLES() 0ULL
+#endif
+
+#include "DW1000Multilateration.h"
+#include "HostRandom.h"
+
+#define POSITIONS 100000
+#define ROUNDS 5
+#define MAX_ANCHORS 16
+
+struct Problem {
+	float anchors[MAX_ANCHORS][3];
+	float ranges[MAX_ANCHORS];
+	float tag[3];
+};
+
+static float distance(const float a[], const float b[], uint8_t dimensions) {
+	float sum = 0;
+	for(uint8_t k = 0; k < dimensions; k++) {
+		sum += (a[k]-b[k])*(a[k]-b[k]);
+	}
+	return sqrtf(sum);
+}
+
+static std::vector<Problem> problems(uint8_t dimensions, uint8_t anchors) {
+	std::vector<Problem> all(POSITIONS);
+	for(Problem& p : all) {
+		for(uint8_t i = 0; i < anchors; i++) {
+			for(uint8_t k = 0; k < dimensions; k++) {
+				float size      = k < 2 ? 20.0f : 3.0f;
+				p.anchors[i][k] = i <= dimensions ? (i == k+1 ? size : 0) : uniform(0, size);
+			}
+		}
+		for(bool near = true; near;) {
+			for(uint8_t k = 0; k < dimensions; k++) {
+				p.tag[k] = uniform(0, k < 2 ? 20.0f : 3.0f);
+			}
+			near = false;
+			for(uint8_t i = 0; i < anchors; i++) {
+				near = near || distance(p.anchors[i], p.tag, dimensions) < 1.0f;
+			}
+		}
+		for(uint8_t i = 0; i < anchors; i++) {
+			p.ranges[i] = distance(p.anchors[i], p.tag, dimensions)+gaussian(0.1f);
+		}
+	}
+	return all;
+}
+
+template<uint8_t D>
+static void measure(uint8_t anchors) {
+	std::vector<Problem>                  all = problems(D, anchors);
+	DW1000Multilateration<MAX_ANCHORS, D> solver;
+	double                                bestNs     = 0;
+	double                                bestCycles = 0;
+	for(int round = 0; round < ROUNDS; round++) {
+		float    sink   = 0;
+		auto     start  = std::chrono::steady_clock::now();
+		uint64_t cycles = CYCLES();
+		for(const Problem& p : all) {
+			float position[3];
+			solver.clear();
+			for(uint8_t i = 0; i < anchors; i++) {
+				solver.add(p.anchors[i], p.ranges[i]);
+			}
+			solver.solve(position);
+			sink += position[0];
+		}
+		cycles = CYCLES()-cycles;
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-start).count();
+		if(round == 0 || ns < bestNs) {
+			bestNs     = ns;
+			bestCycles = (double)cycles;
+		}
+		if(sink == 1) {
+			printf("\n");
+		}
+	}
+	// accuracy: the linearized start alone and the full solve
+	DW1000Multilateration<MAX_ANCHORS, D> linear;
+	double                                linearError   = 0;
+	double                                error         = 0;
+	uint64_t                              iterations    = 0;
+	uint8_t                               maxIterations = 0;
+	for(const Problem& p : all) {
+		float position[3];
+		solver.clear();
+		for(uint8_t i = 0; i < anchors; i++) {
+			solver.add(p.anchors[i], p.ranges[i]);
+		}
+		solver.solve(position);
+		error        += distance(position, p.tag, D);
+		iterations   += solver.iterations();
+		maxIterations = solver.iterations() > maxIterations ? solver.iterations() : maxIterations;
+		linear.clear();
+		for(uint8_t i = 0; i < anchors; i++) {
+			linear.add(p.anchors[i], p.ranges[i]);
+		}
+		linear.solveLinear(position);
+		linearError += distance(position, p.tag, D);
+	}
+	printf("%dD | %7d | %8.0f | %7.0f | %10.0f | %5.2f | %4d | %11.1f | %8.1f\n", D, anchors,
+	       bestCycles/all.size(), bestNs/all.size(), 1e9*all.size()/bestNs, iterations/(double)all.size(),
+	       maxIterations, 1000*linearError/all.size(), 1000*error/all.size());
+}
+
+int main() {
+	printf("=== Multilateration Benchmark (%d positions, best of %d, 10 cm range noise, %d byte solver) ===\n\n",
+	       POSITIONS, ROUNDS, (int)sizeof(DW1000Multilateration<MAX_ANCHORS, 3>));
+	printf("   | anchors | cycles   | ns      | solves/s   | iter. | max  | linear      | solved\n");
+	printf("   |         | /solve   | /solve  |            | mean  | iter.| error [mm]  | error [mm]\n");
+	const uint8_t anchors[] = { 4, 6, 8, 12, 16 };
+	for(uint8_t n : anchors) {
+		measure<2>(n);
+	}
+	for(uint8_t n : anchors) {
+		measure<3>(n);
+	}
+	return 0;
+}
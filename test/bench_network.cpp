@@ -0,0 +1,137 @@
+/*
+ * Network Throughput Benchmark
+ *
+ * Runs N tags and M anchors of the real library on one shared simulated
+ * medium and reports what the whole floor achieves: ranges per second per
+ * tag, collision rate at the receivers and channel occupancy. Each
+ * scenario runs with the ranges reported in their own RANGE_REPORT frame
+ * ("frame"), appended to the next POLL_ACK ("poll_ack",
+ * DW1000Ranging::useRangeReportInPollAck()) and computed by the tag from
+ * the anchors' RANGE_TIMES ("on tag", RANGING_ASYMMETRIC_ON_TAG).
+ *
+ * Build and run with: make -C test bench
+ */
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "DW1000.h"
+#include "DW1000Ranging.h"
+#include "DW1000Sim.h"
+
+#define SIM_SECONDS 10
+#define FLOOR_SIZE_M 12.0
+#define DEAF_DB 200.0
+
+static std::vector<uint64_t> tagRanges;
+
+static void newRange() {
+	DW1000SimNode* node = DW1000Sim::current();
+	if(node->index() < (int)tagRanges.size()) {
+		tagRanges[node->index()]++;
+	}
+}
+
+static void address(char* out, uint8_t first, uint8_t second) {
+	sprintf(out, "%02X:%02X:22:EA:82:60:3B:9C", first, second);
+}
+
+struct Report {
+	const char* name;
+	RangingMode rangingMode;
+	bool        inPollAck;
+};
+
+static void runScenario(int tagCount, int anchorCount, const Report& report) {
+	DW1000SimConfig config;
+	config.seed = 1000+tagCount*16+anchorCount;
+	DW1000Sim sim(config);
+	tagRanges.assign(tagCount, 0);
+
+	// tags first so that node index == tag number
+	for(int i = 0; i < tagCount; i++) {
+		sim.addNode((sim.random()%1000)/1000.0*FLOOR_SIZE_M, (sim.random()%1000)/1000.0*FLOOR_SIZE_M, 1.0);
+	}
+	// anchors on the walls, corners first
+	const double corners[4][2] = { { 0, 0 }, { FLOOR_SIZE_M, 0 }, { FLOOR_SIZE_M, FLOOR_SIZE_M }, { 0, FLOOR_SIZE_M } };
+	for(int i = 0; i < anchorCount; i++) {
+		DW1000SimNode& anchor = sim.addNode(corners[i%4][0], corners[i%4][1], 2.5);
+		// all anchors answer a BLINK at the same time; let them hear the
+		// tags one after the other so every anchor gets discovered
+		anchor.extraLossDb = DEAF_DB;
+		char addr[24];
+		address(addr, 0x82+i, 0x17);
+		anchor.exec([&report](const DW1000SimNodeApi* api) {
+			api->setRangingMode(report.rangingMode);
+			api->useRangeReportInPollAck(report.inPollAck);
+		});
+		anchor.initCommunication();
+		anchor.startAsAnchor(addr, DW1000Class::MODE_LONGDATA_RANGE_LOWPOWER);
+	}
+	for(int i = 0; i < tagCount; i++) {
+		char addr[24];
+		address(addr, 0x7D, i);
+		DW1000SimNode& tag = sim.node(i);
+		tag.initCommunication();
+		tag.exec([&report](const DW1000SimNodeApi* api) {
+			api->attachNewRange(newRange);
+			api->setRangingMode(report.rangingMode);
+			api->useRangeReportInPollAck(report.inPollAck);
+		});
+		tag.startAsTag(addr, DW1000Class::MODE_LONGDATA_RANGE_LOWPOWER);
+		// real tags are not switched on in the same microsecond
+		sim.runFor(sim.random()%100000000);
+	}
+	for(int i = 0; i < anchorCount; i++) {
+		sim.node(tagCount+i).extraLossDb = 0;
+		sim.runFor(4000000000ULL);
+	}
+
+	std::fill(tagRanges.begin(), tagRanges.end(), 0);
+	DW1000SimChannelStats before = sim.channelStats();
+	sim.runFor(SIM_SECONDS*1000000000ULL);
+	DW1000SimChannelStats after = sim.channelStats();
+
+	uint64_t total    = 0;
+	uint64_t minimum  = tagRanges[0];
+	for(uint64_t ranges : tagRanges) {
+		total  += ranges;
+		minimum = std::min(minimum, ranges);
+	}
+	uint64_t received = after.framesReceived-before.framesReceived;
+	uint64_t collided = after.framesCollided-before.framesCollided;
+	uint64_t airtimeNs = after.airtimeNs-before.airtimeNs;
+	printf("%-8s | %4d | %7d | %8.1f | %8.2f | %8.2f | %8.1f | %7.1f | %6.1f | %7.1f\n",
+	       report.name, tagCount, anchorCount,
+	       total/(double)SIM_SECONDS,
+	       total/(double)SIM_SECONDS/tagCount,
+	       minimum/(double)SIM_SECONDS,
+	       (after.framesSent-before.framesSent)/(double)SIM_SECONDS,
+	       received+collided ? 100.0*collided/(received+collided) : 0.0,
+	       airtimeNs/1e7/SIM_SECONDS,
+	       total ? airtimeNs/1e6/total : 0.0);
+}
+
+int main() {
+	printf("=== Network Throughput Benchmark (%d s simulated, 110 kb/s, 2048 preamble, %.0fx%.0f m) ===\n\n",
+	       SIM_SECONDS, FLOOR_SIZE_M, FLOOR_SIZE_M);
+	printf("report   | tags | anchors | ranges/s | per tag  | worst    | frames/s | coll.   | air    | air per\n");
+	printf("         |      |         | (floor)  | [1/s]    | tag [1/s]|          | [%%]     | [%%]    | range [ms]\n");
+	const int tags[]    = { 1, 2, 4, 8 };
+	const int anchors[] = { 1, 2, 4 };
+	const Report reports[] = {
+		{ "frame", RANGING_ASYMMETRIC, false },
+		{ "poll_ack", RANGING_ASYMMETRIC, true },
+		{ "on tag", RANGING_ASYMMETRIC_ON_TAG, false },
+	};
+	for(const Report& report : reports) {
+		for(int n : tags) {
+			for(int m : anchors) {
+				runScenario(n, m, report);
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * Message Queue Throughput Benchmark
+ *
+ * Messages per second through DW1000MessageQueue<MessageQueueItem, N>:
+ *  - "in place": one thread fills a slot with a frame of FRAME_BYTES and
+ *    handles it in place (reserve/push/front/pop), as handleReceived() and
+ *    loop() do now.
+ *  - "copy": the same through enqueueMessage()/dequeueMessage()-style copies
+ *    of LEN_DATA and the whole item, as before.
+ *  - "2 threads": producer and consumer threads in place; on a single CPU
+ *    host this mostly measures the scheduler.
+ *
+ * Build and run with: make -C test bench
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+
+#include "DW1000Ranging.h"
+
+#define MESSAGES 4000000
+#define FRAME_BYTES 24
+
+static byte frame[LEN_DATA];
+static uint32_t sink = 0;
+
+template<uint8_t Size>
+static double inPlace() {
+	static DW1000MessageQueue<MessageQueueItem, Size> queue;
+	auto start = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < MESSAGES; i++) {
+		MessageQueueItem* item = queue.reserve();
+		memcpy(item->data, frame, FRAME_BYTES);
+		item->length = FRAME_BYTES;
+		queue.push();
+		item = queue.front();
+		sink += item->data[i%FRAME_BYTES];
+		queue.pop();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return MESSAGES/std::chrono::duration<double>(end-start).count();
+}
+
+template<uint8_t Size>
+static double copying() {
+	static DW1000MessageQueue<MessageQueueItem, Size> queue;
+	static byte data[LEN_DATA];
+	auto start = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < MESSAGES; i++) {
+		// SPI read into the global buffer, copy in, copy out
+		memcpy(data, frame, FRAME_BYTES);
+		MessageQueueItem* slot = queue.reserve();
+		memcpy(slot->data, data, LEN_DATA);
+		queue.push();
+		MessageQueueItem item;
+		memcpy(&item, queue.front(), sizeof(item));
+		queue.pop();
+		sink += item.data[i%FRAME_BYTES];
+	}
+	auto end = std::chrono::steady_clock::now();
+	return MESSAGES/std::chrono::duration<double>(end-start).count();
+}
+
+template<uint8_t Size>
+static double twoThreads() {
+	static DW1000MessageQueue<MessageQueueItem, Size> queue;
+	auto start = std::chrono::steady_clock::now();
+	std::thread producer([]() {
+		for(uint32_t i = 0; i < MESSAGES;) {
+			MessageQueueItem* item = queue.reserve();
+			if(item == nullptr) {
+				std::this_thread::yield();
+				continue;
+			}
+			memcpy(item->data, frame, FRAME_BYTES);
+			item->length = FRAME_BYTES;
+			queue.push();
+			i++;
+		}
+	});
+	for(uint32_t i = 0; i < MESSAGES;) {
+		MessageQueueItem* item = queue.front();
+		if(item == nullptr) {
+			std::this_thread::yield();
+			continue;
+		}
+		sink += item->data[i%FRAME_BYTES];
+		queue.pop();
+		i++;
+	}
+	producer.join();
+	auto end = std::chrono::steady_clock::now();
+	return MESSAGES/std::chrono::duration<double>(end-start).count();
+}
+
+template<uint8_t Size>
+static void printRow() {
+	printf("%4d | %14.1f | %11.1f | %14.1f\n", Size, inPlace<Size>()/1e6, copying<Size>()/1e6, twoThreads<Size>()/1e6);
+}
+
+int main() {
+	printf("=== Message Queue Throughput Benchmark (%d messages, %d B frames, %u hardware threads) ===\n\n",
+	       MESSAGES, FRAME_BYTES, std::thread::hardware_concurrency());
+	printf("size | in place [M/s] | copy [M/s] | 2 threads [M/s]\n");
+	printRow<8>();
+	printRow<32>();
+	printRow<128>();
+	return sink == 1 ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * Range Cycle Benchmark
+ *
+ * Measures one full ranging cycle of the real library on the simulator:
+ * broadcast POLL on the air until the tag reports the range of each anchor,
+ * together with the CPU and SPI cost the tag pays per range. "spi" runs all
+ * nodes on the default transport, "dma" queues the transmit path on a
+ * simulated DMA transport (DW1000SimNodeApi::useDmaTransport()), where the
+ * CPU no longer waits for the frame data to be clocked out. "fixed" are the
+ * (2*i+1)*7 ms reply delays, "adaptive" the ones the tag derives from the
+ * turnaround it measured and the airtime of the mode
+ * (DW1000Ranging::useAdaptiveReplyDelay()), at 110 kb/s with a 2048 symbol
+ * preamble and at 6.8 Mb/s with 128. "exchange" is the tag's own measure
+ * (getCycleTime()), POLL until the last reply.
+ *
+ * Build and run with: make -C test bench
+ */
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "DW1000.h"
+#include "DW1000Sim.h"
+
+#define POLL 0
+#define SHORT_MAC_LEN 9
+#define SIM_SECONDS 10
+
+static const char* TAG_ADDR = "7D:00:22:EA:82:60:3B:9C";
+static const char* ANCHOR_ADDR[4] = {
+	"82:17:5B:D5:A9:9A:E2:9C",
+	"83:17:5B:D5:A9:9A:E2:9C",
+	"84:17:5B:D5:A9:9A:E2:9C",
+	"85:17:5B:D5:A9:9A:E2:9C"
+};
+
+static int64_t              lastPollStart = -1;
+static std::vector<int64_t> cycleTicks;
+static uint64_t             ranges = 0;
+
+static void newRange() {
+	DW1000SimNode* node = DW1000Sim::current();
+	if(node->index() != 0) {
+		return;
+	}
+	ranges++;
+	if(lastPollStart >= 0) {
+		cycleTicks.push_back(node->nowTicks()-lastPollStart);
+	}
+}
+
+static void runScenario(int anchorCount, bool dma, bool adaptive, bool fast) {
+	const byte* mode = fast ? DW1000Class::MODE_SHORTDATA_FAST_ACCURACY : DW1000Class::MODE_LONGDATA_RANGE_LOWPOWER;
+	lastPollStart = -1;
+	cycleTicks.clear();
+	ranges = 0;
+
+	DW1000Sim      sim;
+	DW1000SimNode& tag = sim.addNode(0, 0);
+	for(int i = 0; i < anchorCount; i++) {
+		DW1000SimNode& anchor = sim.addNode(3.0*i, 3.0);
+		anchor.exec([dma](const DW1000SimNodeApi* api) { api->useDmaTransport(dma); });
+		anchor.initCommunication();
+		anchor.startAsAnchor(ANCHOR_ADDR[i], mode);
+	}
+	tag.exec([dma](const DW1000SimNodeApi* api) { api->useDmaTransport(dma); });
+	tag.initCommunication();
+	tag.exec([adaptive](const DW1000SimNodeApi* api) {
+		api->attachNewRange(newRange);
+		api->useAdaptiveReplyDelay(adaptive);
+	});
+	tag.startAsTag(TAG_ADDR, mode);
+	sim.onTransmit = [](const DW1000SimFrame& frame) {
+		if(frame.sender == 0 && frame.data.size() > SHORT_MAC_LEN && frame.data[SHORT_MAC_LEN] == POLL) {
+			lastPollStart = frame.start;
+		}
+	};
+
+	// discover the anchors one at a time (see host_ranging_test.cpp)
+	for(int i = 0; i < anchorCount; i++) {
+		tag.x = sim.node(i+1).x;
+		tag.y = 2.5;
+		sim.runFor(3000000000ULL);
+	}
+	tag.x = 0;
+	tag.y = 0;
+	cycleTicks.clear();
+	ranges = 0;
+	DW1000SimNodeStats before = tag.stats;
+	sim.runFor(SIM_SECONDS*1000000000ULL);
+	DW1000SimNodeStats& after = tag.stats;
+
+	const char* scenario = fast ? (adaptive ? "6.8M adapt" : "6.8M fixed") : (adaptive ? "110k adapt" : "110k fixed");
+	if(ranges == 0) {
+		printf("%-10s | %-9s | %7d | no ranges\n", scenario, dma ? "dma" : "spi", anchorCount);
+		return;
+	}
+	std::sort(cycleTicks.begin(), cycleTicks.end());
+	double median = DW1000Sim::ticksToNs(cycleTicks[cycleTicks.size()/2])/1e6;
+	double worst  = DW1000Sim::ticksToNs(cycleTicks.back())/1e6;
+	printf("%-10s | %-9s | %7d | %8.1f | %10.2f | %9.2f | %8.2f | %8.1f | %8.1f | %7.2f\n",
+	       scenario, dma ? "dma" : "spi", tag.api()->getNetworkDevicesNumber(),
+	       ranges/(double)SIM_SECONDS,
+	       median, worst, tag.api()->getCycleTime()/1000.0,
+	       (after.spiTransactions-before.spiTransactions)/(double)ranges,
+	       (after.spiBytes-before.spiBytes)/(double)ranges,
+	       (after.busyNs-before.busyNs)/1e4/SIM_SECONDS/1e3);
+}
+
+int main() {
+	printf("=== Range Cycle Benchmark (%d s simulated) ===\n\n", SIM_SECONDS);
+	printf("replies    | transport | anchors | ranges/s | cycle p50  | cycle max | exchange | SPI tx/r | SPI B/r  | tag CPU\n");
+	printf("           |           |         |          | [ms]       | [ms]      | [ms]     |          |          | [%%]\n");
+	for(int dma = 0; dma < 2; dma++) {
+		for(int n = 1; n <= 4; n++) {
+			runScenario(n, dma, false, false);
+		}
+	}
+	// fixed 110 kb/s above
+	const bool scenarios[3][2] = { { true, false }, { false, true }, { true, true } };
+	for(auto& scenario : scenarios) {
+		for(int n = 1; n <= 4; n++) {
+			runScenario(n, false, scenario[0], scenario[1]);
+		}
+	}
+	return 0;
+}
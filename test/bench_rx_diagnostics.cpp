@@ -0,0 +1,155 @@
+/*
+ * RX Diagnostics Benchmark
+ *
+ * SPI traffic to read what a range needs of one received frame (timestamp,
+ * receive power, first path power and quality), counted on the SPI bus of the
+ * host shim:
+ *  - "separate reads": the register reads the four getters used to make, one
+ *    per field (11 transactions).
+ *  - "getters": the four argument-less getters now, which read adjacent fields
+ *    in one burst.
+ *  - "snapshot": readRxDiagnostics() (RX_FINFO, RX_TIME and RX_FQUAL in one
+ *    burst each) and everything derived from the snapshot, as
+ *    DW1000Ranging does in the interrupt handler.
+ * Bus time uses the cost model of the simulator (DW1000SimConfig: 8 bits per
+ * byte at the SPI clock, per transfer call and per transaction overheads) plus the CS
+ * hold delay of readBytes(). The library is linked directly (no simulator).
+ *
+ * Build and run with: make -C test bench
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "DW1000.h"
+#include "DW1000Sim.h"
+
+struct BusStats {
+	uint32_t clockHz;
+	uint32_t transactions;
+	uint32_t bytes;
+	uint64_t busNs;
+};
+
+static DW1000SimConfig config;
+
+static uint64_t busNow(void* ctx) {
+	return ((BusStats*)ctx)->busNs;
+}
+
+static void busConsume(void* ctx, uint64_t ns) {
+	((BusStats*)ctx)->busNs += ns;
+}
+
+static void busDigitalWrite(void*, uint8_t, uint8_t) {}
+static int  busAnalogRead(void*, uint8_t) { return 0; }
+static void busAttachInterrupt(void*, uint8_t, void (*)(void)) {}
+static void busPrint(void*, const char*, uint32_t) {}
+
+static void busBegin(void* ctx, uint32_t clockHz) {
+	BusStats* bus = (BusStats*)ctx;
+	bus->clockHz  = clockHz ? clockHz : 1000000;
+	bus->busNs   += config.spiTransactionOverheadNs/2;
+}
+
+static uint8_t busTransfer(void* ctx, uint8_t) {
+	BusStats* bus = (BusStats*)ctx;
+	bus->bytes++;
+	bus->busNs += 8000000000ULL/bus->clockHz+config.spiByteOverheadNs;
+	return 0;
+}
+
+static void busTransferBytes(void* ctx, uint8_t* buf, uint32_t count) {
+	BusStats* bus = (BusStats*)ctx;
+	bus->bytes += count;
+	bus->busNs += 8000000000ULL*count/bus->clockHz+config.spiByteOverheadNs;
+	memset(buf, 0, count);
+}
+
+static void busEnd(void* ctx) {
+	BusStats* bus = (BusStats*)ctx;
+	bus->transactions++;
+	bus->busNs += config.spiTransactionOverheadNs/2;
+}
+
+static float sink = 0;
+
+// what getReceiveTimestamp(), getReceivePower(), getFirstPathPower() and
+// getReceiveQuality() read before, one register field at a time
+static void separateReads() {
+	byte buffer[LEN_RX_STAMP];
+	// timestamp and its correction by the receive power
+	DW1000.readBytes(RX_TIME, RX_STAMP_SUB, buffer, LEN_RX_STAMP);
+	DW1000.readBytes(RX_FQUAL, CIR_PWR_SUB, buffer, LEN_CIR_PWR);
+	DW1000.readBytes(RX_FINFO, NO_SUB, buffer, LEN_RX_FINFO);
+	// receive power
+	DW1000.readBytes(RX_FQUAL, CIR_PWR_SUB, buffer, LEN_CIR_PWR);
+	DW1000.readBytes(RX_FINFO, NO_SUB, buffer, LEN_RX_FINFO);
+	// first path power
+	DW1000.readBytes(RX_TIME, FP_AMPL1_SUB, buffer, LEN_FP_AMPL1);
+	DW1000.readBytes(RX_FQUAL, FP_AMPL2_SUB, buffer, LEN_FP_AMPL2);
+	DW1000.readBytes(RX_FQUAL, FP_AMPL3_SUB, buffer, LEN_FP_AMPL3);
+	DW1000.readBytes(RX_FINFO, NO_SUB, buffer, LEN_RX_FINFO);
+	// quality
+	DW1000.readBytes(RX_FQUAL, STD_NOISE_SUB, buffer, LEN_STD_NOISE);
+	DW1000.readBytes(RX_FQUAL, FP_AMPL2_SUB, buffer, LEN_FP_AMPL2);
+}
+
+static void getters() {
+	DW1000Time time;
+	DW1000.getReceiveTimestamp(time);
+	sink += time.getAsMicroSeconds();
+	sink += DW1000.getReceivePower();
+	sink += DW1000.getFirstPathPower();
+	sink += DW1000.getReceiveQuality();
+}
+
+static void snapshot() {
+	DW1000RxDiagnostics diagnostics;
+	DW1000Time          time;
+	DW1000.readRxDiagnostics(diagnostics);
+	DW1000.getReceiveTimestamp(diagnostics, time);
+	sink += time.getAsMicroSeconds();
+	sink += DW1000.getReceivePower(diagnostics);
+	sink += DW1000.getFirstPathPower(diagnostics);
+	sink += DW1000.getReceiveQuality(diagnostics);
+}
+
+static BusStats measure(void (*read)()) {
+	BusStats       bus   = {};
+	DW1000SimHooks hooks = {};
+	hooks.ctx                 = &bus;
+	hooks.nowNs               = busNow;
+	hooks.consumeNs           = busConsume;
+	hooks.digitalWrite        = busDigitalWrite;
+	hooks.analogRead          = busAnalogRead;
+	hooks.attachInterrupt     = busAttachInterrupt;
+	hooks.spiBeginTransaction = busBegin;
+	hooks.spiTransfer         = busTransfer;
+	hooks.spiTransferBytes    = busTransferBytes;
+	hooks.spiEndTransaction   = busEnd;
+	hooks.print               = busPrint;
+	hostBindHooks(&hooks);
+	read();
+	hostBindHooks(nullptr);
+	return bus;
+}
+
+static void printRow(const char* name, const BusStats& bus, const BusStats& reference) {
+	printf("%-14s | %12u | %5u | %8.1f | %7.0f %%\n", name, bus.transactions, bus.bytes, bus.busNs/1000.0,
+	       100.0*bus.busNs/reference.busNs);
+}
+
+int main() {
+	printf("=== RX Diagnostics Benchmark (timestamp, power, first path power, quality of one frame) ===\n\n");
+	BusStats before = measure(separateReads);
+	BusStats now    = measure(getters);
+	BusStats burst  = measure(snapshot);
+	printf("%u Hz SPI, %u ns per transfer call and %u ns per transaction overhead\n\n",
+	       burst.clockHz, config.spiByteOverheadNs, config.spiTransactionOverheadNs);
+	printf("reads          | transactions | bytes | bus [us] | vs. separate\n");
+	printRow("separate reads", before, before);
+	printRow("getters", now, before);
+	printRow("snapshot", burst, before);
+	return sink == 1 ? 1 : 0;
+}
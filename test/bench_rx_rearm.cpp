@@ -0,0 +1,100 @@
+/*
+ * RX Re-arm Benchmark
+ *
+ * Receiver dead time after a frame on the simulator: two senders put POLL_ACK
+ * sized frames (LEN_DATA) on the air back to back, the second one starting a
+ * given gap after the end of the first, as two anchors replying to a POLL in
+ * consecutive slots. The receiving node runs the real library in permanent
+ * receive (an anchor, which does not transmit on its own). Reported are the
+ * frames it received, the ones which arrived while its receiver was still off
+ * and the time from the end of a received frame until its receiver was on
+ * again (DW1000SimNodeStats::rxRearm*). "single" is the default receive
+ * mode, "double" DW1000Ranging::useDoubleBuffering(), where the chip keeps
+ * receiving into the second buffer while the first one is read.
+ *
+ * 6.8 Mb/s with 128 preamble symbols, where a frame is about as long as the
+ * interrupt handler takes to read it.
+ *
+ * Build and run with: make -C test bench
+ */
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "DW1000.h"
+#include "DW1000Sim.h"
+
+#define PAIRS 200
+#define PAIR_INTERVAL_NS 5000000ULL
+#define LEN_DATA 90
+
+static const char* RECEIVER_ADDR  = "82:17:5B:D5:A9:9A:E2:9C";
+static const char* SENDER_ADDR[2] = {
+	"83:17:5B:D5:A9:9A:E2:9C",
+	"84:17:5B:D5:A9:9A:E2:9C"
+};
+
+// POLL_ACK from a sender, short MAC frame, padded to LEN_DATA as sent
+static std::vector<uint8_t> pollAck(uint16_t from, uint16_t to, uint8_t sequence) {
+	std::vector<uint8_t> frame(LEN_DATA, 0);
+	frame[0] = 0x41;
+	frame[1] = 0x88;
+	frame[2] = sequence;
+	frame[3] = 0xCA;
+	frame[4] = 0xDE;
+	frame[5] = to & 0xFF;
+	frame[6] = to >> 8;
+	frame[7] = from & 0xFF;
+	frame[8] = from >> 8;
+	frame[9] = 1; // POLL_ACK
+	return frame;
+}
+
+static void runScenario(uint32_t gapNs, bool doubleBuffering) {
+	DW1000Sim      sim;
+	DW1000SimNode& receiver = sim.addNode(0, 0);
+	receiver.exec([doubleBuffering](const DW1000SimNodeApi* api) { api->useDoubleBuffering(doubleBuffering); });
+	for(int i = 0; i < 2; i++) {
+		DW1000SimNode& sender = sim.addNode(3.0*(i+1), 0);
+		sender.initCommunication();
+		sender.startAsAnchor(SENDER_ADDR[i], DW1000Class::MODE_SHORTDATA_FAST_ACCURACY);
+		// only its TX settings are used
+		sender.setRunning(false);
+	}
+	receiver.initCommunication();
+	receiver.startAsAnchor(RECEIVER_ADDR, DW1000Class::MODE_SHORTDATA_FAST_ACCURACY);
+	sim.runFor(100000000ULL);
+
+	int64_t  preambleSfd;
+	uint64_t airtimeNs = DW1000Sim::ticksToNs(DW1000Sim::airtime(DW1000Class::TRX_RATE_6800KBPS, DW1000Class::TX_PULSE_FREQ_64MHZ, 128, LEN_DATA+2, &preambleSfd));
+	uint16_t to        = receiver.shortAddress();
+	DW1000SimNodeStats before = receiver.stats;
+	for(int i = 0; i < PAIRS; i++) {
+		uint64_t start = sim.nowNs()+100000;
+		sim.injectFrame(1, pollAck(sim.node(1).shortAddress(), to, (uint8_t)i), start);
+		sim.injectFrame(2, pollAck(sim.node(2).shortAddress(), to, (uint8_t)i), start+airtimeNs+gapNs);
+		sim.runFor(PAIR_INTERVAL_NS);
+	}
+	DW1000SimNodeStats& after = receiver.stats;
+	uint64_t rearms = after.rxRearms-before.rxRearms;
+	printf("%-6s | %8.0f | %6d | %8llu | %6llu | %9.1f | %9.1f\n",
+	       doubleBuffering ? "double" : "single", gapNs/1000.0, 2*PAIRS,
+	       (unsigned long long)(after.framesReceived-before.framesReceived),
+	       (unsigned long long)(after.framesMissed-before.framesMissed),
+	       rearms ? (after.rxRearmNs-before.rxRearmNs)/1000.0/rearms : 0.0,
+	       after.rxRearmMaxNs/1000.0);
+}
+
+int main() {
+	printf("=== RX Re-arm Benchmark (%d frame pairs, 6.8 Mb/s, 128 preamble, %d byte frames) ===\n\n", PAIRS, LEN_DATA);
+	printf("mode   | gap      | frames | received | missed | dead time | dead time\n");
+	printf("       | [us]     |        |          |        | avg [us]  | max [us]\n");
+	const uint32_t gaps[] = { 0, 20, 40, 60, 80, 100, 150, 200 };
+	for(int doubleBuffering = 0; doubleBuffering < 2; doubleBuffering++) {
+		for(uint32_t gap : gaps) {
+			runScenario(gap*1000, doubleBuffering);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Superframe Benchmark
+ *
+ * Aggregate ranges per second of a cell of 4 anchors as tags are added, with
+ * every tag polling on its own timer ("free") and in the slot the
+ * coordinator's BEACON assigns it ("superframe", DW1000Ranging::
+ * setCoordinator() on the first anchor and useSuperframe() on the tags).
+ * Free running tags collide more the more there are; in the superframe one
+ * tag polls at a time, so the cell stays at about anchors/slot ranges per
+ * second however many tags share it (each tag getting its share of that).
+ * The anchors keep up to 64 tags (the _anchor library).
+ *
+ * Build and run with: make -C test bench
+ */
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "DW1000.h"
+#include "DW1000Sim.h"
+
+#define SIM_SECONDS 20
+#define FLOOR_SIZE_M 12.0
+#define ANCHORS 4
+#define SLOT_MS 160
+
+static std::vector<uint64_t> tagRanges;
+
+static void newRange() {
+	DW1000SimNode* node = DW1000Sim::current();
+	if(node->index() < (int)tagRanges.size()) {
+		tagRanges[node->index()]++;
+	}
+}
+
+static void address(char* out, uint8_t first, uint8_t second) {
+	sprintf(out, "%02X:%02X:22:EA:82:60:3B:9C", first, second);
+}
+
+static void runScenario(int tagCount, bool superframe) {
+	DW1000SimConfig config;
+	config.seed = 2000+tagCount;
+	DW1000Sim sim(config);
+	tagRanges.assign(tagCount, 0);
+
+	// tags first so that node index == tag number
+	for(int i = 0; i < tagCount; i++) {
+		sim.addNode((sim.random()%1000)/1000.0*FLOOR_SIZE_M, (sim.random()%1000)/1000.0*FLOOR_SIZE_M, 1.0);
+	}
+	const double corners[ANCHORS][2] = { { 0, 0 }, { FLOOR_SIZE_M, 0 }, { FLOOR_SIZE_M, FLOOR_SIZE_M }, { 0, FLOOR_SIZE_M } };
+	for(int i = 0; i < ANCHORS; i++) {
+		DW1000SimNode& anchor = sim.addNode(corners[i][0], corners[i][1], 2.5, DW1000_SIM_ANCHOR_NODE_LIB);
+		char addr[24];
+		address(addr, 0x82+i, 0x17);
+		anchor.initCommunication();
+		if(superframe && i == 0) {
+			anchor.exec([](const DW1000SimNodeApi* api) { api->setCoordinator(SLOT_MS); });
+		}
+		anchor.startAsAnchor(addr, DW1000Class::MODE_LONGDATA_RANGE_LOWPOWER);
+	}
+	for(int i = 0; i < tagCount; i++) {
+		char addr[24];
+		address(addr, 0x7D, i);
+		DW1000SimNode& tag = sim.node(i);
+		tag.initCommunication();
+		tag.exec([superframe](const DW1000SimNodeApi* api) {
+			api->attachNewRange(newRange);
+			api->useSuperframe(superframe);
+		});
+		tag.startAsTag(addr, DW1000Class::MODE_LONGDATA_RANGE_LOWPOWER);
+		// real tags are not switched on in the same microsecond
+		sim.runFor(sim.random()%100000000);
+	}
+	// the coordinator takes about one new tag per superframe (BLINKs in slot 0)
+	sim.runFor(120000000000ULL);
+
+	std::fill(tagRanges.begin(), tagRanges.end(), 0);
+	DW1000SimChannelStats before = sim.channelStats();
+	sim.runFor(SIM_SECONDS*1000000000ULL);
+	DW1000SimChannelStats after = sim.channelStats();
+
+	uint64_t total   = 0;
+	uint64_t minimum = tagRanges[0];
+	for(uint64_t ranges : tagRanges) {
+		total  += ranges;
+		minimum = std::min(minimum, ranges);
+	}
+	uint64_t received = after.framesReceived-before.framesReceived;
+	uint64_t collided = after.framesCollided-before.framesCollided;
+	printf("%-10s | %4d | %8.1f | %8.2f | %8.2f | %7.1f | %6.1f\n",
+	       superframe ? "superframe" : "free", tagCount,
+	       total/(double)SIM_SECONDS,
+	       total/(double)SIM_SECONDS/tagCount,
+	       minimum/(double)SIM_SECONDS,
+	       received+collided ? 100.0*collided/(received+collided) : 0.0,
+	       (after.airtimeNs-before.airtimeNs)/1e7/SIM_SECONDS);
+}
+
+int main() {
+	printf("=== Superframe Benchmark (%d s simulated, %d anchors, %d ms slots, 110 kb/s, 2048 preamble) ===\n\n",
+	       SIM_SECONDS, ANCHORS, SLOT_MS);
+	printf("tags poll  | tags | ranges/s | per tag  | worst    | coll.   | air\n");
+	printf("           |      | (cell)   | [1/s]    | tag [1/s]| [%%]     | [%%]\n");
+	const int tags[] = { 1, 2, 4, 8, 16, 24, 32 };
+	for(int superframe = 0; superframe < 2; superframe++) {
+		for(int n : tags) {
+			runScenario(n, superframe);
+		}
+	}
+	return 0;
+}
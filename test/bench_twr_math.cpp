@@ -0,0 +1,130 @@
+/*
+ * Two-Way Ranging Math Benchmark
+ *
+ * Cost of the asymmetric two-way ranging time of flight
+ * (round1*round2-reply1*reply2)/(round1+round2+reply1+reply2) per range:
+ *  - "int64 (before)": the products in int64_t, as computeRangeAsymmetric()
+ *    did. They overflow once the durations get longer than about 47 ms, the
+ *    result is only right while the wrapped around difference happens to
+ *    fit (undefined behavior in C++).
+ *  - "split multiply": DW1000Time::asymmetricTimeOfFlight(), int64_t while
+ *    round and reply differ by less than 2^22 ticks, else 32 bit halves and
+ *    a long division, which also builds for the 32 bit ESP32.
+ *  - "__int128": host only reference.
+ * Durations are the reply delays of the anchor slots (7 ms for the first,
+ * 63 ms for the 5th) plus up to 100 m of flight, and random up to 40 bits.
+ * Cycles are counted with the time stamp counter of the host CPU, the
+ * "exact" column is the share of results equal to the reference.
+ *
+ * Build and run with: make -C test bench
+ */
+
+#include <stdio.h>
+
+#include <chrono>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES() __rdtsc()
+#else
+#define CYCLES() 0ULL
+#endif
+
+#include "DW1000Time.h"
+#include "HostRandom.h"
+
+#define RANGES 1000000
+#define ROUNDS 5
+
+struct Durations {
+	int64_t round1;
+	int64_t reply1;
+	int64_t round2;
+	int64_t reply2;
+};
+
+__attribute__((noinline)) static int64_t int64Before(const Durations& d) {
+	return (d.round1*d.round2-d.reply1*d.reply2)/(d.round1+d.round2+d.reply1+d.reply2);
+}
+
+__attribute__((noinline)) static int64_t splitMultiply(const Durations& d) {
+	return DW1000Time::asymmetricTimeOfFlight(d.round1, d.reply1, d.round2, d.reply2);
+}
+
+__attribute__((noinline)) static int64_t int128(const Durations& d) {
+	__int128 sum = (__int128)d.round1+d.round2+d.reply1+d.reply2;
+	if(sum == 0) {
+		return 0;
+	}
+	return (int64_t)(((__int128)d.round1*d.round2-(__int128)d.reply1*d.reply2)/sum);
+}
+
+static std::vector<Durations> replies(uint32_t replyUs) {
+	std::vector<Durations> durations(RANGES);
+	int64_t reply = DW1000Time::microsecondsToTicks(replyUs);
+	for(Durations& d : durations) {
+		// 100 m are about 21300 ticks of flight
+		int64_t tof = (int64_t)(nextRandom()%21300);
+		d.reply1 = reply+(int64_t)(nextRandom()%1000);
+		d.reply2 = reply+(int64_t)(nextRandom()%1000);
+		d.round1 = d.reply1+2*tof;
+		d.round2 = d.reply2+2*tof;
+	}
+	return durations;
+}
+
+static std::vector<Durations> random40() {
+	std::vector<Durations> durations(RANGES);
+	for(Durations& d : durations) {
+		d.round1 = (int64_t)(nextRandom() & DW1000Time::TIME_MAX);
+		d.reply1 = (int64_t)(nextRandom() & DW1000Time::TIME_MAX);
+		d.round2 = (int64_t)(nextRandom() & DW1000Time::TIME_MAX);
+		d.reply2 = (int64_t)(nextRandom() & DW1000Time::TIME_MAX);
+	}
+	return durations;
+}
+
+static void measure(const char* scenario, const char* name, int64_t (*tof)(const Durations&),
+                    const std::vector<Durations>& durations) {
+	double   bestNs     = 0;
+	double   bestCycles = 0;
+	uint64_t exact      = 0;
+	for(int round = 0; round < ROUNDS; round++) {
+		int64_t  sink   = 0;
+		auto     start  = std::chrono::steady_clock::now();
+		uint64_t cycles = CYCLES();
+		for(const Durations& d : durations) {
+			sink += tof(d);
+		}
+		cycles = CYCLES()-cycles;
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-start).count();
+		if(round == 0 || ns < bestNs) {
+			bestNs     = ns;
+			bestCycles = (double)cycles;
+		}
+		if(sink == 1) {
+			printf("\n");
+		}
+	}
+	for(const Durations& d : durations) {
+		exact += tof(d) == int128(d);
+	}
+	printf("%-18s | %-14s | %8.1f | %6.1f | %7.2f %%\n", scenario, name, bestCycles/durations.size(),
+	       bestNs/durations.size(), 100.0*exact/durations.size());
+}
+
+static void scenario(const char* name, const std::vector<Durations>& durations) {
+	measure(name, "int64 (before)", int64Before, durations);
+	measure(name, "split multiply", splitMultiply, durations);
+	measure(name, "__int128", int128, durations);
+}
+
+int main() {
+	printf("=== Two-Way Ranging Math Benchmark (%d ranges, best of %d) ===\n\n", RANGES, ROUNDS);
+	printf("durations          | computation    | cycles   | ns     | exact\n");
+	scenario("7 ms replies", replies(7000));
+	scenario("63 ms replies", replies(63000));
+	scenario("random 40 bit", random40());
+	return 0;
+}
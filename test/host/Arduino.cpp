@@ -0,0 +1,364 @@
+/*
+ * Host implementation of the Arduino shim. One copy of this file is linked into
+ * every simulated node, so all state below is per node.
+ */
+
+#include <stdarg.h>
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "DW1000SimNode.h"
+
+HardwareSerial Serial;
+SPIClass       SPI;
+
+static const DW1000SimHooks* _hooks = nullptr;
+// per node PRNG, the C library generator would be shared between all nodes
+static uint32_t _randomState = 1;
+
+void hostBindHooks(const DW1000SimHooks* hooks) {
+	_hooks = hooks;
+}
+
+/* ###########################################################################
+ * #### Time #################################################################
+ * ######################################################################### */
+
+// static constructors run before the simulator binds the hooks
+unsigned long millis() {
+	return _hooks ? (unsigned long)(_hooks->nowNs(_hooks->ctx) / 1000000ULL) : 0;
+}
+
+unsigned long micros() {
+	return _hooks ? (unsigned long)(_hooks->nowNs(_hooks->ctx) / 1000ULL) : 0;
+}
+
+void delay(unsigned long ms) {
+	if(_hooks) {
+		_hooks->consumeNs(_hooks->ctx, (uint64_t)ms*1000000ULL);
+	}
+}
+
+void delayMicroseconds(unsigned int us) {
+	if(_hooks) {
+		_hooks->consumeNs(_hooks->ctx, (uint64_t)us*1000ULL);
+	}
+}
+
+/* ###########################################################################
+ * #### Pins and interrupts ##################################################
+ * ######################################################################### */
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	(void)pin;
+	(void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+	if(_hooks) {
+		_hooks->digitalWrite(_hooks->ctx, pin, val);
+	}
+}
+
+int digitalRead(uint8_t pin) {
+	(void)pin;
+	return LOW;
+}
+
+int analogRead(uint8_t pin) {
+	return _hooks ? _hooks->analogRead(_hooks->ctx, pin) : 0;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+	(void)mode;
+	if(_hooks) {
+		_hooks->attachInterrupt(_hooks->ctx, pin, isr);
+	}
+}
+
+void detachInterrupt(uint8_t pin) {
+	if(_hooks) {
+		_hooks->attachInterrupt(_hooks->ctx, pin, nullptr);
+	}
+}
+
+// interrupts are delivered between simulated slices, so there is nothing to mask
+void noInterrupts() {}
+
+void interrupts() {}
+
+/* ###########################################################################
+ * #### Random ###############################################################
+ * ######################################################################### */
+
+static uint32_t nextRandom() {
+	// xorshift32
+	uint32_t x = _randomState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	_randomState = x;
+	return x;
+}
+
+long random(long howbig) {
+	if(howbig <= 0) {
+		return 0;
+	}
+	return (long)(nextRandom()%(uint32_t)howbig);
+}
+
+long random(long howsmall, long howbig) {
+	if(howsmall >= howbig) {
+		return howsmall;
+	}
+	return howsmall+random(howbig-howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+	if(seed != 0) {
+		_randomState = (uint32_t)seed;
+	}
+}
+
+/* ###########################################################################
+ * #### SPI ##################################################################
+ * ######################################################################### */
+
+void SPIClass::beginTransaction(SPISettings settings) {
+	if(_hooks) {
+		_hooks->spiBeginTransaction(_hooks->ctx, settings._clock);
+	}
+}
+
+void SPIClass::endTransaction() {
+	if(_hooks) {
+		_hooks->spiEndTransaction(_hooks->ctx);
+	}
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+	return _hooks ? _hooks->spiTransfer(_hooks->ctx, data) : 0;
+}
+
+void SPIClass::transfer(void* buf, size_t count) {
+	if(_hooks) {
+		_hooks->spiTransferBytes(_hooks->ctx, (uint8_t*)buf, (uint32_t)count);
+	}
+}
+
+void hostSpiQueueWrite(uint32_t clockHz, const uint8_t* out, uint32_t count) {
+	if(_hooks) {
+		_hooks->spiQueueWrite(_hooks->ctx, clockHz, out, count);
+	}
+}
+
+uint64_t hostSpiIdleNs() {
+	return _hooks ? _hooks->spiIdleNs(_hooks->ctx) : 0;
+}
+
+/* ###########################################################################
+ * #### String ###############################################################
+ * ######################################################################### */
+
+String::String(const char* str) : _buf(nullptr), _len(0), _capacity(0) {
+	*this = str;
+}
+
+String::String(const String& str) : _buf(nullptr), _len(0), _capacity(0) {
+	*this = str;
+}
+
+String::~String() {
+	free(_buf);
+}
+
+void String::reserve(unsigned int size) {
+	if(size+1 <= _capacity) {
+		return;
+	}
+	_capacity = size+1;
+	_buf      = (char*)realloc(_buf, _capacity);
+}
+
+String& String::operator=(const String& rhs) {
+	if(this != &rhs) {
+		reserve(rhs._len);
+		memcpy(_buf, rhs._buf, rhs._len+1);
+		_len = rhs._len;
+	}
+	return *this;
+}
+
+String& String::operator=(const char* rhs) {
+	unsigned int len = rhs ? (unsigned int)strlen(rhs) : 0;
+	reserve(len);
+	memcpy(_buf, rhs ? rhs : "", len+1);
+	_len = len;
+	return *this;
+}
+
+String& String::operator+=(char c) {
+	reserve(_len+1);
+	_buf[_len++] = c;
+	_buf[_len]   = 0;
+	return *this;
+}
+
+String& String::operator+=(const char* str) {
+	unsigned int len = (unsigned int)strlen(str);
+	reserve(_len+len);
+	memcpy(_buf+_len, str, len+1);
+	_len += len;
+	return *this;
+}
+
+String& String::operator+=(const String& str) {
+	return *this += str.c_str();
+}
+
+void String::getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index) const {
+	if(bufsize == 0 || buf == nullptr) {
+		return;
+	}
+	if(index >= _len) {
+		buf[0] = 0;
+		return;
+	}
+	unsigned int n = bufsize-1;
+	if(n > _len-index) {
+		n = _len-index;
+	}
+	memcpy(buf, _buf+index, n);
+	buf[n] = 0;
+}
+
+void String::remove(unsigned int index) {
+	if(index < _len) {
+		_len       = index;
+		_buf[_len] = 0;
+	}
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+	if(index >= _len) {
+		return;
+	}
+	if(count > _len-index) {
+		count = _len-index;
+	}
+	memmove(_buf+index, _buf+index+count, _len-index-count+1);
+	_len -= count;
+}
+
+/* ###########################################################################
+ * #### Print / Serial #######################################################
+ * ######################################################################### */
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+	size_t n = 0;
+	while(size--) {
+		n += write(*buffer++);
+	}
+	return n;
+}
+
+size_t Print::print(const char* str) {
+	return write((const uint8_t*)str, strlen(str));
+}
+
+size_t Print::print(const String& str) {
+	return write((const uint8_t*)str.c_str(), str.length());
+}
+
+size_t Print::print(char c) {
+	return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char b, int base) {
+	return printNumber(b, base, false);
+}
+
+size_t Print::print(int n, int base) {
+	return print((long long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+	return printNumber(n, base, false);
+}
+
+size_t Print::print(long n, int base) {
+	return print((long long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+	return printNumber(n, base, false);
+}
+
+size_t Print::print(long long n, int base) {
+	if(base == DEC && n < 0) {
+		return printNumber((unsigned long long)(-n), base, true);
+	}
+	return printNumber((unsigned long long)n, base, false);
+}
+
+size_t Print::print(unsigned long long n, int base) {
+	return printNumber(n, base, false);
+}
+
+size_t Print::print(double n, int digits) {
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%.*f", digits, n);
+	return print(buf);
+}
+
+size_t Print::print(const Printable& p) {
+	return p.printTo(*this);
+}
+
+size_t Print::println() {
+	return print("\r\n");
+}
+
+size_t Print::printf(const char* format, ...) {
+	char    buf[256];
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	if(len < 0) {
+		return 0;
+	}
+	return write((const uint8_t*)buf, (size_t)len < sizeof(buf) ? (size_t)len : sizeof(buf)-1);
+}
+
+size_t Print::printNumber(unsigned long long n, int base, bool negative) {
+	char buf[8*sizeof(n)+2];
+	char* str = &buf[sizeof(buf)-1];
+	*str = 0;
+	if(base < 2) {
+		base = 10;
+	}
+	do {
+		int digit = (int)(n%base);
+		n /= base;
+		*--str = digit < 10 ? '0'+digit : 'A'+digit-10;
+	} while(n);
+	if(negative) {
+		*--str = '-';
+	}
+	return print(str);
+}
+
+void HardwareSerial::flush() {}
+
+size_t HardwareSerial::write(uint8_t c) {
+	return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+	if(_hooks) {
+		_hooks->print(_hooks->ctx, (const char*)buffer, (uint32_t)size);
+	}
+	return size;
+}
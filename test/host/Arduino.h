@@ -0,0 +1,151 @@
+/*
+ * Minimal Arduino core replacement used to build the DW1000 library natively
+ * on Linux. Every hardware access (time, pins, SPI, interrupts, serial output)
+ * is forwarded to the hooks installed with hostBindHooks(), which the simulator
+ * in test/sim provides per node.
+ *
+ * Only what the library actually uses is provided here.
+ */
+
+#ifndef _HOST_ARDUINO_H_INCLUDED
+#define _HOST_ARDUINO_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define HIGH    0x1
+#define LOW     0x0
+
+#define INPUT   0x01
+#define OUTPUT  0x03
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+#define digitalPinToInterrupt(p) (p)
+#define IRAM_ATTR
+
+struct DW1000SimHooks;
+void hostBindHooks(const DW1000SimHooks* hooks);
+// simulated DMA, see DW1000SimHooks
+void     hostSpiQueueWrite(uint32_t clockHz, const uint8_t* out, uint32_t count);
+uint64_t hostSpiIdleNs();
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+int  analogRead(uint8_t pin);
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+void noInterrupts();
+void interrupts();
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+class Print;
+
+class Printable {
+public:
+	virtual ~Printable() {}
+	virtual size_t printTo(Print& p) const = 0;
+};
+
+class String {
+public:
+	String(const char* str = "");
+	String(const String& str);
+	~String();
+	String& operator=(const String& rhs);
+	String& operator=(const char* rhs);
+	String& operator+=(char c);
+	String& operator+=(const char* str);
+	String& operator+=(const String& str);
+
+	unsigned int length() const { return _len; }
+	const char* c_str() const { return _buf; }
+	char charAt(unsigned int index) const { return index < _len ? _buf[index] : 0; }
+	char operator[](unsigned int index) const { return charAt(index); }
+	void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const;
+	void remove(unsigned int index);
+	void remove(unsigned int index, unsigned int count);
+	bool operator==(const String& rhs) const { return _len == rhs._len && memcmp(_buf, rhs._buf, _len) == 0; }
+	bool operator!=(const String& rhs) const { return !(*this == rhs); }
+
+private:
+	void reserve(unsigned int size);
+	char*        _buf;
+	unsigned int _len;
+	unsigned int _capacity;
+};
+
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size);
+
+	size_t print(const char* str);
+	size_t print(const String& str);
+	size_t print(char c);
+	size_t print(unsigned char b, int base = DEC);
+	size_t print(int n, int base = DEC);
+	size_t print(unsigned int n, int base = DEC);
+	size_t print(long n, int base = DEC);
+	size_t print(unsigned long n, int base = DEC);
+	size_t print(long long n, int base = DEC);
+	size_t print(unsigned long long n, int base = DEC);
+	size_t print(double n, int digits = 2);
+	size_t print(const Printable& p);
+
+	size_t println();
+	template<typename T> size_t println(const T& value) { return print(value) + println(); }
+	template<typename T> size_t println(const T& value, int format) { return print(value, format) + println(); }
+
+	size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+	size_t printNumber(unsigned long long n, int base, bool negative);
+};
+
+class HardwareSerial : public Print {
+public:
+	void begin(unsigned long baud) { (void)baud; }
+	void end() {}
+	int  available() { return 0; }
+	int  read() { return -1; }
+	void flush();
+	size_t write(uint8_t c);
+	size_t write(const uint8_t* buffer, size_t size);
+	using Print::write;
+	operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
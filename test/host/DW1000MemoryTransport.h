@@ -0,0 +1,108 @@
+/*
+ * Memory backed DW1000Transport for host tests without the simulator: every
+ * register file is a plain byte array, transactions are decoded and logged.
+ * Queued writes stay pending until complete() (the DMA finishing) or the next
+ * transfer()/flush(), so tests can check what DW1000Class leaves in flight.
+ */
+
+#ifndef _DW1000MemoryTransport_H_INCLUDED
+#define _DW1000MemoryTransport_H_INCLUDED
+
+#include <deque>
+#include <vector>
+
+#include "DW1000Transport.h"
+
+class DW1000MemoryTransport : public DW1000Transport {
+public:
+	struct Transaction {
+		uint8_t  reg;
+		uint16_t offset;
+		uint16_t length;
+		bool     write;
+		bool     queued;
+	};
+
+	std::vector<uint8_t>     registers[64];
+	std::vector<Transaction> log;
+
+	DW1000MemoryTransport() {
+		// room for the largest sub-address in use (LDE_IF)
+		for(int i = 0; i < 64; i++) {
+			registers[i].assign(0x3000, 0);
+		}
+	}
+
+	void transfer(const SPISettings& settings, uint8_t ss, const byte header[], uint8_t headerLen,
+	              byte data[], uint16_t n, boolean write) override {
+		(void)settings;
+		(void)ss;
+		flush();
+		execute(header, headerLen, data, n, write, false);
+	}
+
+	void queueWrite(const SPISettings& settings, uint8_t ss, const byte header[], uint8_t headerLen,
+	                const byte data[], uint16_t n) override {
+		(void)settings;
+		(void)ss;
+		std::vector<uint8_t> transaction(header, header+headerLen);
+		transaction.insert(transaction.end(), data, data+n);
+		_queue.push_back(transaction);
+	}
+
+	boolean busy() override {
+		return !_queue.empty();
+	}
+
+	void flush() override {
+		while(complete()) {
+		}
+	}
+
+	// the oldest queued write reaches the chip, false if none was queued
+	bool complete() {
+		if(_queue.empty()) {
+			return false;
+		}
+		std::vector<uint8_t> transaction = _queue.front();
+		_queue.pop_front();
+		uint8_t headerLen = headerLength(transaction[0], transaction.size() > 1 ? transaction[1] : 0);
+		execute(transaction.data(), headerLen, transaction.data()+headerLen,
+		        (uint16_t)(transaction.size()-headerLen), true, true);
+		return true;
+	}
+
+private:
+	static uint8_t headerLength(uint8_t first, uint8_t second) {
+		if(!(first & 0x40)) {
+			return 1;
+		}
+		return (second & 0x80) ? 3 : 2;
+	}
+
+	void execute(const byte header[], uint8_t headerLen, byte data[], uint16_t n, bool write, bool queued) {
+		Transaction transaction;
+		transaction.reg    = header[0] & 0x3F;
+		transaction.offset = headerLen > 1 ? header[1] & 0x7F : 0;
+		if(headerLen > 2) {
+			transaction.offset |= (uint16_t)header[2] << 7;
+		}
+		transaction.length = n;
+		transaction.write  = write;
+		transaction.queued = queued;
+		log.push_back(transaction);
+		std::vector<uint8_t>& file = registers[transaction.reg];
+		for(uint16_t i = 0; i < n && transaction.offset+i < file.size(); i++) {
+			if(write) {
+				file[transaction.offset+i] = data[i];
+			}
+			else {
+				data[i] = file[transaction.offset+i];
+			}
+		}
+	}
+
+	std::deque<std::vector<uint8_t> > _queue;
+};
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * Seeded xorshift64 random numbers for the host tests and benchmarks, so a
+ * run gives the same numbers every time.
+ */
+
+#ifndef _HostRandom_H_INCLUDED
+#define _HostRandom_H_INCLUDED
+
+#include <math.h>
+#include <stdint.h>
+
+static uint64_t rng = 88172645463325252ULL;
+
+static inline uint64_t nextRandom() {
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return rng;
+}
+
+// uniform in [low, high)
+static inline float uniform(float low, float high) {
+	return low+(high-low)*(nextRandom()%1000000)/1000000.0f;
+}
+
+// normal distribution, Box-Muller
+static inline float gaussian(float sigma) {
+	float u = uniform(1e-6f, 1.0f);
+	float v = uniform(0.0f, 1.0f);
+	return sigma*sqrtf(-2*logf(u))*cosf(2*(float)M_PI*v);
+}
+
+#endif
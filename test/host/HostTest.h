@@ -0,0 +1,40 @@
+/*
+ * Pass/fail bookkeeping of the host tests: every check ends in one
+ * logTestResult() call, main() returns non-zero if testsFailed is.
+ */
+
+#ifndef _HostTest_H_INCLUDED
+#define _HostTest_H_INCLUDED
+
+#include <iostream>
+#include <string>
+
+#ifndef TEST_DEBUG
+#define TEST_DEBUG 1
+#endif
+
+static int testsRun    = 0;
+static int testsPassed = 0;
+static int testsFailed = 0;
+
+static inline void logTestResult(const std::string& testName, bool passed, const std::string& errorMessage = "") {
+	testsRun++;
+	if(passed) {
+		testsPassed++;
+		if(TEST_DEBUG) {
+			std::cout << "✓ PASS: " << testName << std::endl;
+		}
+	}
+	else {
+		testsFailed++;
+		if(TEST_DEBUG) {
+			std::cout << "✗ FAIL: " << testName;
+			if(!errorMessage.empty()) {
+				std::cout << " - " << errorMessage;
+			}
+			std::cout << std::endl;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * Minimal Arduino SPI replacement for the host build. Transfers are forwarded
+ * to the simulator hooks (see Arduino.h), which model the DW1000 register file
+ * and charge the configured bus time to the calling node.
+ */
+
+#ifndef _HOST_SPI_H_INCLUDED
+#define _HOST_SPI_H_INCLUDED
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x01
+#define SPI_MODE2 0x02
+#define SPI_MODE3 0x03
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+class SPISettings {
+public:
+	SPISettings() : _clock(1000000), _bitOrder(MSBFIRST), _dataMode(SPI_MODE0) {}
+	SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+		: _clock(clock), _bitOrder(bitOrder), _dataMode(dataMode) {}
+
+	uint32_t _clock;
+	uint8_t  _bitOrder;
+	uint8_t  _dataMode;
+};
+
+class SPIClass {
+public:
+	// ESP32 signature, pins ignored
+	void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {
+		(void)sck;
+		(void)miso;
+		(void)mosi;
+		(void)ss;
+	}
+	void end() {}
+	void beginTransaction(SPISettings settings);
+	void endTransaction();
+	uint8_t transfer(uint8_t data);
+	void transfer(void* buf, size_t count);
+};
+
+extern SPIClass SPI;
+
+#endif
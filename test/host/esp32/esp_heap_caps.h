@@ -0,0 +1,17 @@
+/*
+ * ESP-IDF capability based allocation as DW1000Esp32DmaTransport uses it, for
+ * the host build with -DESP32. The functions are left to the test.
+ */
+
+#ifndef _HOST_ESP_HEAP_CAPS_H_INCLUDED
+#define _HOST_ESP_HEAP_CAPS_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_DMA (1 << 3)
+
+void* heap_caps_malloc(size_t size, uint32_t caps);
+void  heap_caps_free(void* ptr);
+
+#endif
@@ -0,0 +1,344 @@
+/*
+ * Host ESP32 Transport Test
+ *
+ * DW1000Esp32DmaTransport built with -DESP32 against the ESP-IDF SPI master
+ * and heap declarations in host/esp32, the driver faked below: register
+ * accesses and queued writes go through the driver in order, one device per
+ * SPI clock, and when any driver call or DMA buffer allocation fails the
+ * transport releases the bus and its buffers and carries on through the
+ * Arduino SPI class, the access which failed included. Only
+ * DW1000Transport.cpp and the Arduino shim are linked.
+ *
+ * Build and run with: make -C test test
+ */
+
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <esp_heap_caps.h>
+
+#include "DW1000SimNode.h"
+#include "DW1000Transport.h"
+#include "HostTest.h"
+
+/* what reached the chip, through the driver or the Arduino SPI class; reads
+return 0xA0, 0xA1, ... after the one byte header */
+
+struct Access {
+	uint8_t  header;
+	uint16_t length;
+	bool     dma;
+};
+
+static std::vector<Access> chip;
+
+/* fake ESP-IDF driver, each function fails on its n-th call (1 based, 0 never) */
+
+struct spi_device_t {
+	int clock;
+	int ss;
+};
+
+struct Driver {
+	int  failInitialize, failMalloc, failAddDevice, failRemoveDevice, failPolling, failQueue, failResult;
+	int  initializeCalls, mallocCalls, addCalls, removeCalls, pollingCalls, queueCalls, resultCalls;
+	bool busInitialized;
+	int  devices;
+	int  allocations; // not freed
+	int  maxTransfer;
+	int  queueSize;
+	std::vector<int>                clocks; // of the devices added
+	std::deque<spi_transaction_t*> inFlight;
+};
+
+static Driver driver;
+
+static void chipAccess(const spi_transaction_t* transaction) {
+	const uint8_t* tx     = (const uint8_t*)transaction->tx_buffer;
+	uint16_t       length = (uint16_t)(transaction->length/8-1);
+	chip.push_back({ tx[0], length, true });
+	if(transaction->rx_buffer != nullptr) {
+		for(uint16_t i = 0; i < length; i++) {
+			((uint8_t*)transaction->rx_buffer)[1+i] = (uint8_t)(0xA0+i);
+		}
+	}
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t* bus_config, spi_dma_chan_t dma_chan) {
+	(void)host_id;
+	if(++driver.initializeCalls == driver.failInitialize || driver.busInitialized || dma_chan != SPI_DMA_CH_AUTO) {
+		return ESP_ERR_INVALID_STATE;
+	}
+	driver.busInitialized = true;
+	driver.maxTransfer    = bus_config->max_transfer_sz;
+	return ESP_OK;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host_id) {
+	(void)host_id;
+	if(!driver.busInitialized || driver.devices > 0) {
+		return ESP_ERR_INVALID_STATE;
+	}
+	driver.busInitialized = false;
+	return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t* dev_config,
+                             spi_device_handle_t* handle) {
+	(void)host_id;
+	if(++driver.addCalls == driver.failAddDevice || !driver.busInitialized) {
+		return ESP_ERR_NO_MEM;
+	}
+	*handle = new spi_device_t { dev_config->clock_speed_hz, dev_config->spics_io_num };
+	driver.devices++;
+	driver.queueSize = dev_config->queue_size;
+	driver.clocks.push_back(dev_config->clock_speed_hz);
+	return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle) {
+	if(++driver.removeCalls == driver.failRemoveDevice) {
+		return ESP_ERR_INVALID_STATE;
+	}
+	delete handle;
+	driver.devices--;
+	return ESP_OK;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t* trans_desc, TickType_t ticks_to_wait) {
+	(void)handle;
+	(void)ticks_to_wait;
+	if(++driver.queueCalls == driver.failQueue) {
+		return ESP_FAIL;
+	}
+	// done right away
+	chipAccess(trans_desc);
+	driver.inFlight.push_back(trans_desc);
+	return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t** trans_desc,
+                                      TickType_t ticks_to_wait) {
+	(void)handle;
+	if(driver.inFlight.empty()) {
+		return ticks_to_wait == 0 ? ESP_ERR_TIMEOUT : ESP_FAIL;
+	}
+	if(++driver.resultCalls == driver.failResult) {
+		return ESP_FAIL;
+	}
+	*trans_desc = driver.inFlight.front();
+	driver.inFlight.pop_front();
+	return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t* trans_desc) {
+	(void)handle;
+	if(++driver.pollingCalls == driver.failPolling) {
+		return ESP_FAIL;
+	}
+	chipAccess(trans_desc);
+	return ESP_OK;
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+	if(++driver.mallocCalls == driver.failMalloc || caps != MALLOC_CAP_DMA) {
+		return nullptr;
+	}
+	driver.allocations++;
+	return malloc(size);
+}
+
+void heap_caps_free(void* ptr) {
+	if(ptr != nullptr) {
+		driver.allocations--;
+	}
+	free(ptr);
+}
+
+/* Arduino SPI class on the host hooks */
+
+static Access spiAccess;
+static bool   spiFirst;
+
+static uint64_t busNow(void*) { return 0; }
+static void     busConsume(void*, uint64_t) {}
+static void     busDigitalWrite(void*, uint8_t, uint8_t) {}
+
+static void busBegin(void*, uint32_t) {
+	spiAccess = { 0, 0, false };
+	spiFirst  = true;
+}
+
+static uint8_t busTransfer(void*, uint8_t out) {
+	(void)out;
+	return 0;
+}
+
+static void busTransferBytes(void*, uint8_t* buf, uint32_t count) {
+	for(uint32_t i = 0; i < count; i++) {
+		if(spiFirst) {
+			spiAccess.header = buf[i];
+			spiFirst         = false;
+			continue;
+		}
+		buf[i] = (uint8_t)(0xA0+spiAccess.length++);
+	}
+}
+
+static void busEnd(void*) {
+	chip.push_back(spiAccess);
+}
+
+/* the same accesses on every transport: a write and a read at 2 MHz, 6
+queued writes at 20 MHz (more than DW1000_DMA_QUEUE), a read at 20 MHz and a
+write at a third clock, which replaces the 2 MHz device */
+
+static const uint8_t SS = 4;
+
+static std::string runAccesses(DW1000Esp32DmaTransport& transport) {
+	const SPISettings slow(2000000, MSBFIRST, SPI_MODE0);
+	const SPISettings fast(20000000, MSBFIRST, SPI_MODE0);
+	const SPISettings other(8000000, MSBFIRST, SPI_MODE0);
+	byte data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	byte header  = 0x81;
+	transport.transfer(slow, SS, &header, 1, data, 4, true);
+	header = 0x02;
+	transport.transfer(slow, SS, &header, 1, data, 4, false);
+	if(data[0] != 0xA0 || data[3] != 0xA3) {
+		return "4 byte read returned wrong data";
+	}
+	for(uint8_t i = 3; i <= 8; i++) {
+		header = 0x80 | i;
+		transport.queueWrite(fast, SS, &header, 1, data, 6);
+	}
+	transport.flush();
+	if(transport.busy()) {
+		return "busy after flush()";
+	}
+	header = 0x09;
+	transport.transfer(fast, SS, &header, 1, data, 8, false);
+	if(data[0] != 0xA0 || data[7] != 0xA7) {
+		return "8 byte read returned wrong data";
+	}
+	header = 0x8A;
+	transport.transfer(other, SS, &header, 1, data, 4, true);
+
+	const uint8_t  headers[10] = { 0x81, 0x02, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x09, 0x8A };
+	const uint16_t lengths[10] = { 4, 4, 6, 6, 6, 6, 6, 6, 8, 4 };
+	if(chip.size() != 10) {
+		return std::to_string(chip.size()) + " of 10 accesses reached the chip";
+	}
+	for(size_t i = 0; i < 10; i++) {
+		if(chip[i].header != headers[i] || chip[i].length != lengths[i]) {
+			return "access " + std::to_string(i+1) + " out of order or changed";
+		}
+	}
+	return "";
+}
+
+static void reset() {
+	chip.clear();
+	driver = Driver();
+}
+
+static DW1000SimHooks hooks() {
+	DW1000SimHooks bus = {};
+	bus.nowNs               = busNow;
+	bus.consumeNs           = busConsume;
+	bus.digitalWrite        = busDigitalWrite;
+	bus.spiBeginTransaction = busBegin;
+	bus.spiTransfer         = busTransfer;
+	bus.spiTransferBytes    = busTransferBytes;
+	bus.spiEndTransaction   = busEnd;
+	return bus;
+}
+
+bool testDriverAccesses() {
+	reset();
+	DW1000SimHooks bus = hooks();
+	hostBindHooks(&bus);
+	DW1000Esp32DmaTransport transport;
+	std::string error = runAccesses(transport);
+	if(error.empty()) {
+		for(const Access& access : chip) {
+			if(!access.dma) {
+				error = "access through the SPI class";
+			}
+		}
+	}
+	if(error.empty() && transport.failed()) {
+		error = "fell back without a failure";
+	}
+	if(error.empty() && (driver.initializeCalls != 1 || driver.maxTransfer != DW1000_DMA_BUFFER ||
+	                     driver.queueSize != DW1000_DMA_QUEUE)) {
+		error = "bus or device set up wrong";
+	}
+	if(error.empty() && (driver.clocks != std::vector<int> { 2000000, 20000000, 8000000 } || driver.devices != 2)) {
+		error = "not one device per clock, the last two kept";
+	}
+	if(error.empty() && driver.allocations != DW1000_DMA_QUEUE+1) {
+		error = std::to_string(driver.allocations) + " DMA buffers";
+	}
+	hostBindHooks(nullptr);
+	logTestResult("DMA Transport Through The Driver", error.empty(), error);
+	return error.empty();
+}
+
+bool testFallBack(const std::string& name, int Driver::*fail, int call) {
+	reset();
+	driver.*fail = call;
+	DW1000SimHooks bus = hooks();
+	hostBindHooks(&bus);
+	DW1000Esp32DmaTransport transport;
+	std::string error = runAccesses(transport);
+	if(error.empty() && !transport.failed()) {
+		error = "did not fall back";
+	}
+	if(error.empty() && chip.back().dma) {
+		error = "still on the driver";
+	}
+	// everything after the first access through the SPI class too
+	bool spi = false;
+	for(const Access& access : chip) {
+		if(spi && access.dma && error.empty()) {
+			error = "back on the driver after falling back";
+		}
+		spi = spi || !access.dma;
+	}
+	if(error.empty() && (driver.busInitialized || driver.devices != 0 || driver.allocations != 0)) {
+		error = "bus, " + std::to_string(driver.devices) + " devices or " + std::to_string(driver.allocations) +
+		        " DMA buffers not released";
+	}
+	hostBindHooks(nullptr);
+	logTestResult("Falls Back When " + name + " Fails", error.empty(), error);
+	return error.empty();
+}
+
+void runAllTests() {
+	std::cout << "=== Host ESP32 Transport Test ===" << std::endl;
+	std::cout << std::endl;
+
+	testDriverAccesses();
+	testFallBack("spi_bus_initialize()", &Driver::failInitialize, 1);
+	testFallBack("The Second DMA Buffer", &Driver::failMalloc, 2);
+	testFallBack("The Receive DMA Buffer", &Driver::failMalloc, DW1000_DMA_QUEUE+1);
+	testFallBack("spi_bus_add_device()", &Driver::failAddDevice, 1);
+	testFallBack("spi_bus_add_device() For A New Clock", &Driver::failAddDevice, 2);
+	testFallBack("spi_bus_remove_device()", &Driver::failRemoveDevice, 1);
+	testFallBack("spi_device_polling_transmit()", &Driver::failPolling, 2);
+	testFallBack("spi_device_queue_trans()", &Driver::failQueue, 3);
+	testFallBack("spi_device_get_trans_result()", &Driver::failResult, 2);
+
+	std::cout << std::endl;
+	std::cout << "=== Test Results ===" << std::endl;
+	std::cout << "Tests Run: " << testsRun << std::endl;
+	std::cout << "Tests Passed: " << testsPassed << std::endl;
+	std::cout << "Tests Failed: " << testsFailed << std::endl;
+}
+
+int main() {
+	runAllTests();
+	return testsFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/*
+ * Host Message Queue Test
+ *
+ * Hammers DW1000MessageQueue from a producer and a consumer thread, as the
+ * ISR and loop() use it (on the ESP32 possibly on two cores), and checks that
+ * every message arrives once, in order and intact, and that the depth and drop
+ * counters agree with what the producer saw.
+ *
+ * Build and run with: make -C test test
+ */
+
+#include <string.h>
+
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "DW1000MessageQueue.h"
+#include "HostTest.h"
+
+#define MESSAGES 2000000
+#define PAYLOAD 90
+
+struct TestItem {
+	uint32_t sequence;
+	uint16_t length;
+	byte     data[PAYLOAD];
+};
+
+static byte pattern(uint32_t sequence, uint16_t i) {
+	return (byte)(sequence*31+i*7);
+}
+
+template<uint8_t Size>
+bool testTwoThreads() {
+	static DW1000MessageQueue<TestItem, Size> queue;
+	queue.clear();
+	queue.resetStats();
+	uint32_t    full = 0;
+	std::string error;
+
+	std::thread producer([&full]() {
+		for(uint32_t sequence = 0; sequence < MESSAGES;) {
+			TestItem* item = queue.reserve();
+			if(item == nullptr) {
+				full++;
+				std::this_thread::yield();
+				continue;
+			}
+			// vary the length like real frames, only that much is written
+			item->sequence = sequence;
+			item->length   = 1+sequence%PAYLOAD;
+			for(uint16_t i = 0; i < item->length; i++) {
+				item->data[i] = pattern(sequence, i);
+			}
+			queue.push();
+			sequence++;
+		}
+	});
+
+	uint32_t expected = 0;
+	while(expected < MESSAGES && error.empty()) {
+		uint8_t size = queue.size();
+		if(size > Size) {
+			error = "size " + std::to_string(size);
+			break;
+		}
+		TestItem* item = queue.front();
+		if(item == nullptr) {
+			std::this_thread::yield();
+			continue;
+		}
+		if(item->sequence != expected || item->length != 1+expected%PAYLOAD) {
+			error = "message " + std::to_string(item->sequence) + " where " + std::to_string(expected) + " was expected";
+			break;
+		}
+		for(uint16_t i = 0; i < item->length; i++) {
+			if(item->data[i] != pattern(expected, i)) {
+				error = "message " + std::to_string(expected) + " corrupted";
+				break;
+			}
+		}
+		queue.pop();
+		expected++;
+	}
+	if(!error.empty()) {
+		// let the producer finish
+		while(expected < MESSAGES) {
+			if(queue.front() != nullptr) {
+				queue.pop();
+				expected++;
+			}
+		}
+	}
+	producer.join();
+
+	if(error.empty() && queue.size() != 0) {
+		error = std::to_string(queue.size()) + " messages left";
+	}
+	if(error.empty() && queue.dropped() != full) {
+		error = "dropped " + std::to_string(queue.dropped()) + ", producer found it full " + std::to_string(full) + " times";
+	}
+	if(error.empty() && (queue.maxDepth() == 0 || queue.maxDepth() > Size)) {
+		error = "max depth " + std::to_string(queue.maxDepth());
+	}
+	if(TEST_DEBUG && error.empty()) {
+		std::cout << "    size " << (int)Size << ": " << MESSAGES << " messages, full " << full
+		          << " times, max depth " << (int)queue.maxDepth() << std::endl;
+	}
+	logTestResult("Two Threads, Size " + std::to_string(Size), error.empty(), error);
+	return error.empty();
+}
+
+bool testStats() {
+	static DW1000MessageQueue<TestItem, 4> queue;
+	std::string error;
+	for(int i = 0; i < 6; i++) {
+		if(queue.reserve() != nullptr) {
+			queue.push();
+		}
+	}
+	if(queue.size() != 4 || queue.maxDepth() != 4 || queue.dropped() != 2) {
+		error = "after filling: size " + std::to_string(queue.size()) + ", max depth " + std::to_string(queue.maxDepth()) +
+		        ", dropped " + std::to_string(queue.dropped());
+	}
+	queue.front();
+	queue.pop();
+	queue.front();
+	queue.pop();
+	queue.resetStats();
+	if(error.empty() && (queue.maxDepth() != 2 || queue.dropped() != 0)) {
+		error = "after reset: max depth " + std::to_string(queue.maxDepth()) + ", dropped " + std::to_string(queue.dropped());
+	}
+	queue.reserve();
+	queue.push();
+	if(error.empty() && queue.maxDepth() != 3) {
+		error = "after push: max depth " + std::to_string(queue.maxDepth());
+	}
+	logTestResult("Depth And Drop Counters", error.empty(), error);
+	return error.empty();
+}
+
+void runAllTests() {
+	std::cout << "=== Host Message Queue Test ===" << std::endl;
+	std::cout << std::endl;
+
+	testStats();
+	testTwoThreads<1>();
+	testTwoThreads<8>();
+	testTwoThreads<128>();
+
+	std::cout << std::endl;
+	std::cout << "=== Test Results ===" << std::endl;
+	std::cout << "Tests Run: " << testsRun << std::endl;
+	std::cout << "Tests Passed: " << testsPassed << std::endl;
+	std::cout << "Tests Failed: " << testsFailed << std::endl;
+}
+
+int main() {
+	runAllTests();
+	return testsFailed == 0 ? 0 : 1;
+}
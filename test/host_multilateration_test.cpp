@@ -0,0 +1,225 @@
+/*
+ * Host Multilateration Test
+ *
+ * DW1000Multilateration: exact ranges give back the tag position in 2D and
+ * 3D for 3 to 16 anchors, also far outside the anchors, noisy ranges end at
+ * the least squares position (the gradient of the squared residuals is
+ * zero), and too few anchors or anchors on a line (2D) or in a plane (3D)
+ * are refused. Only the header is needed.
+ *
+ * Build and run with: make -C test test
+ */
+
+#include <math.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "DW1000Multilateration.h"
+#include "HostRandom.h"
+#include "HostTest.h"
+
+template<uint8_t D>
+static float distance(const float a[], const float b[]) {
+	float sum = 0;
+	for(uint8_t k = 0; k < D; k++) {
+		sum += (a[k]-b[k])*(a[k]-b[k]);
+	}
+	return sqrtf(sum);
+}
+
+// room of 20x20 m (3 m high in 3D): Dimensions+1 anchors in its corners,
+// the rest anywhere in it
+template<uint8_t D>
+static void placeAnchors(float anchor[][3], uint8_t anchors) {
+	for(uint8_t i = 0; i < anchors; i++) {
+		for(uint8_t k = 0; k < D; k++) {
+			float size   = k < 2 ? 20.0f : 3.0f;
+			anchor[i][k] = i <= D ? (i == k+1 ? size : 0) : uniform(0, size);
+		}
+	}
+}
+
+// tag in the room or scale times as far out, at least 1 m from the anchors
+// (where a range residual has no usable slope)
+template<uint8_t D>
+static void placeTag(float tag[], const float anchor[][3], uint8_t anchors, float scale) {
+	for(;;) {
+		for(uint8_t k = 0; k < D; k++) {
+			float size = k < 2 ? 20.0f : 3.0f;
+			tag[k]     = size/2+uniform(-scale, scale)*size/2;
+		}
+		uint8_t i = 0;
+		while(i < anchors && distance<D>(anchor[i], tag) >= 1.0f) {
+			i++;
+		}
+		if(i == anchors) {
+			return;
+		}
+	}
+}
+
+// worst position error of exact ranges
+template<uint8_t D>
+static float exactWorstError(uint8_t anchors, float scale, int positions, int& failed) {
+	DW1000Multilateration<16, D> solver;
+	float                        worst = 0;
+	for(int n = 0; n < positions; n++) {
+		float anchor[16][3];
+		float tag[3];
+		placeAnchors<D>(anchor, anchors);
+		placeTag<D>(tag, anchor, anchors, scale);
+		solver.clear();
+		for(uint8_t i = 0; i < anchors; i++) {
+			solver.add(anchor[i], distance<D>(anchor[i], tag));
+		}
+		float position[3];
+		if(!solver.solve(position)) {
+			failed++;
+			continue;
+		}
+		float error = distance<D>(position, tag);
+		worst = error > worst ? error : worst;
+	}
+	return worst;
+}
+
+bool testExactRanges() {
+	std::ostringstream error;
+	int                failed = 0;
+	struct {
+		uint8_t dimensions;
+		uint8_t anchors;
+		float   scale;
+	} cases[] = {
+		{ 2, 3, 1 }, { 2, 4, 1 }, { 2, 8, 1 }, { 2, 16, 1 }, { 2, 4, 3 },
+		{ 3, 4, 1 }, { 3, 6, 1 }, { 3, 16, 1 }, { 3, 6, 3 },
+	};
+	for(auto& c : cases) {
+		float worst = c.dimensions == 2 ? exactWorstError<2>(c.anchors, c.scale, 10000, failed)
+		                                : exactWorstError<3>(c.anchors, c.scale, 10000, failed);
+		// float resolution over up to 60 m
+		if(worst > 0.005f) {
+			error << c.anchors << " anchors in " << (int)c.dimensions << "D (x" << c.scale << ") off by " << worst << " m; ";
+		}
+		if(TEST_DEBUG) {
+			std::cout << "    " << (int)c.dimensions << "D, " << (int)c.anchors << " anchors, tag within x" << c.scale
+			          << ": worst error " << worst*1000 << " mm" << std::endl;
+		}
+	}
+	if(failed > 0) {
+		error << failed << " solves refused";
+	}
+	logTestResult("Exact Ranges, 2D and 3D", error.str().empty(), error.str());
+	return error.str().empty();
+}
+
+// 10 cm range noise: the result is where the squared residuals have no
+// slope, sum of u*(|x-anchor|-range) with u the unit vector to the tag
+template<uint8_t D>
+static bool testLeastSquares(const char* name, uint8_t anchors) {
+	std::ostringstream           error;
+	DW1000Multilateration<16, D> solver;
+	float                        worstGradient = 0;
+	float                        sumError      = 0;
+	uint32_t                     iterations    = 0;
+	const int                    positions     = 10000;
+	for(int n = 0; n < positions && error.str().empty(); n++) {
+		float anchor[16][3];
+		float range[16];
+		float tag[3];
+		placeAnchors<D>(anchor, anchors);
+		placeTag<D>(tag, anchor, anchors, 1);
+		solver.clear();
+		for(uint8_t i = 0; i < anchors; i++) {
+			range[i] = distance<D>(anchor[i], tag)+gaussian(0.1f);
+			solver.add(anchor[i], range[i]);
+		}
+		float position[3];
+		if(!solver.solve(position)) {
+			error << "refused a solve";
+			break;
+		}
+		float gradient[3] = { 0 };
+		for(uint8_t i = 0; i < anchors; i++) {
+			float d = distance<D>(anchor[i], position);
+			for(uint8_t k = 0; k < D; k++) {
+				gradient[k] += (position[k]-anchor[i][k])/d*(d-range[i]);
+			}
+		}
+		float length = 0;
+		for(uint8_t k = 0; k < D; k++) {
+			length += gradient[k]*gradient[k];
+		}
+		length        = sqrtf(length)/anchors;
+		worstGradient = length > worstGradient ? length : worstGradient;
+		sumError     += distance<D>(position, tag);
+		iterations   += solver.iterations();
+	}
+	if(error.str().empty() && worstGradient > 1e-3f) {
+		error << "slope of up to " << worstGradient << " m per anchor left";
+	}
+	if(TEST_DEBUG) {
+		std::cout << "    " << (int)anchors << " anchors: mean error " << sumError/positions*1000 << " mm, "
+		          << iterations/(float)positions << " iterations, slope up to " << worstGradient*1000 << " mm"
+		          << std::endl;
+	}
+	logTestResult(name, error.str().empty(), error.str());
+	return error.str().empty();
+}
+
+bool testDegenerate() {
+	std::ostringstream          error;
+	DW1000Multilateration<4, 2> plane;
+	DW1000Multilateration<5, 3> space;
+	float                       position[3];
+	const float                 line[3][2]   = { { 0, 0 }, { 5, 0 }, { 12, 0 } };
+	const float                 square[4][3] = { { 0, 0, 2 }, { 8, 0, 2 }, { 8, 8, 2 }, { 0, 8, 2 } };
+	// too few
+	plane.add(line[0], 3.0f);
+	plane.add(line[1], 4.0f);
+	if(plane.solve(position)) {
+		error << "solved 2D with 2 anchors; ";
+	}
+	plane.add(line[2], 9.0f);
+	if(plane.solve(position)) {
+		error << "solved 2D with anchors on a line; ";
+	}
+	plane.add(square[2], 5.0f);
+	if(!plane.solve(position) || plane.add(square[3], 5.0f) || plane.count() != 4) {
+		error << "2D with 4 anchors; ";
+	}
+	for(int i = 0; i < 4; i++) {
+		space.add(square[i], 5.0f);
+	}
+	if(space.solve(position)) {
+		error << "solved 3D with anchors in a plane; ";
+	}
+	if(space.add(square[0], -1.0f)) {
+		error << "took a negative range; ";
+	}
+	logTestResult("Degenerate Geometry Refused", error.str().empty(), error.str());
+	return error.str().empty();
+}
+
+void runAllTests() {
+	std::cout << "=== Host Multilateration Test ===" << std::endl;
+	std::cout << std::endl;
+
+	testExactRanges();
+	testLeastSquares<2>("Least Squares, 2D, 8 Anchors", 8);
+	testLeastSquares<3>("Least Squares, 3D, 8 Anchors", 8);
+	testDegenerate();
+
+	std::cout << std::endl;
+	std::cout << "=== Test Results ===" << std::endl;
+	std::cout << "Tests Run: " << testsRun << std::endl;
+	std::cout << "Tests Passed: " << testsPassed << std::endl;
+	std::cout << "Tests Failed: " << testsFailed << std::endl;
+}
+
+int main() {
+	runAllTests();
+	return testsFailed == 0 ? 0 : 1;
+}
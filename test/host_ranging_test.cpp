@@ -0,0 +1,727 @@
+/*
+ * Host Ranging Regression Test
+ *
+ * Runs the real DW1000Ranging tag/anchor state machines against the
+ * register-level simulator in sim/ and checks the ranges they report for
+ * known geometries, with both ranging modes.
+ *
+ * Build and run with: make -C test test
+ */
+
+#include <math.h>
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DW1000.h"
+#include "DW1000Ranging.h"
+#include "DW1000Sim.h"
+#include "HostTest.h"
+
+#define RANGE_TOLERANCE_M 0.1f
+
+static const char* TAG_ADDR       = "7D:00:22:EA:82:60:3B:9C";
+static const char* ANCHOR_ADDR[4] = {
+	"82:17:5B:D5:A9:9A:E2:9C",
+	"83:17:5B:D5:A9:9A:E2:9C",
+	"84:17:5B:D5:A9:9A:E2:9C",
+	"85:17:5B:D5:A9:9A:E2:9C"
+};
+
+// ranges reported through attachNewRange(), per node and distant short address
+static std::map<int, std::map<uint16_t, std::vector<float> > > reportedRanges;
+static int protocolErrors = 0;
+static int inactiveDevices = 0;
+static int blinkDevices    = 0;
+// BLINK/new device handlers called with a device not in the node's table
+static int detachedDevices = 0;
+
+static void newRange() {
+	DW1000SimNode*          node   = DW1000Sim::current();
+	const DW1000SimNodeApi* api    = node->api();
+	DW1000SimDevice*        device = api->getDistantDevice();
+	reportedRanges[node->index()][api->deviceShortAddress(device)].push_back(api->deviceRange(device));
+}
+
+static void protocolError(DW1000SimDevice* device, int errorCode) {
+	(void)device;
+	(void)errorCode;
+	protocolErrors++;
+}
+
+static void inactiveDevice(DW1000SimDevice* device) {
+	(void)device;
+	inactiveDevices++;
+}
+
+// the device the handler got is the one in the table (a copy would not see
+// later changes)
+static void checkInTable(DW1000SimDevice* device) {
+	const DW1000SimNodeApi* api = DW1000Sim::current()->api();
+	for(uint8_t i = 0; i < api->getNetworkDevicesNumber(); i++) {
+		if(api->getNetworkDevice(i) == device) {
+			return;
+		}
+	}
+	detachedDevices++;
+}
+
+static void blinkDevice(DW1000SimDevice* device) {
+	checkInTable(device);
+	blinkDevices++;
+}
+
+static void newDevice(DW1000SimDevice* device) {
+	checkInTable(device);
+}
+
+static void resetTestCounters() {
+	reportedRanges.clear();
+	protocolErrors  = 0;
+	inactiveDevices = 0;
+	blinkDevices    = 0;
+	detachedDevices = 0;
+}
+
+static void startNode(DW1000SimNode& node, bool anchor, const char* address,
+                      const uint8_t mode[] = DW1000Class::MODE_LONGDATA_RANGE_LOWPOWER) {
+	node.initCommunication();
+	node.exec([](const DW1000SimNodeApi* api) {
+		api->attachNewRange(newRange);
+		api->attachProtocolError(protocolError);
+		api->attachBlinkDevice(blinkDevice);
+		api->attachNewDevice(newDevice);
+	});
+	if(anchor) {
+		node.startAsAnchor(address, mode);
+	}
+	else {
+		node.startAsTag(address, mode);
+	}
+}
+
+// checks the ranges one node reported for one distant device, skipping the first (warm-up) value
+static bool checkRanges(int node, uint16_t distant, float expected, size_t minCount, std::string& error) {
+	std::vector<float>& ranges = reportedRanges[node][distant];
+	if(ranges.size() < minCount) {
+		error = "only " + std::to_string(ranges.size()) + " ranges to " + std::to_string(distant) +
+		        ", expected " + std::to_string(minCount);
+		return false;
+	}
+	double sum = 0;
+	for(size_t i = 1; i < ranges.size(); i++) {
+		if(fabsf(ranges[i]-expected) > RANGE_TOLERANCE_M) {
+			error = "range " + std::to_string(ranges[i]) + " m, expected " + std::to_string(expected) + " m";
+			return false;
+		}
+		sum += ranges[i];
+	}
+	if(TEST_DEBUG) {
+		std::cout << "    node " << node << " -> " << std::hex << distant << std::dec << ": " << ranges.size()
+		          << " ranges, mean " << sum/(ranges.size()-1) << " m (true " << expected << " m)" << std::endl;
+	}
+	return true;
+}
+
+bool testSingleAnchorDistance(float meters) {
+	resetTestCounters();
+	DW1000Sim      sim;
+	DW1000SimNode& tag    = sim.addNode(0, 0);
+	DW1000SimNode& anchor = sim.addNode(meters, 0);
+	startNode(anchor, true, ANCHOR_ADDR[0]);
+	startNode(tag, false, TAG_ADDR);
+	sim.runFor(3000000000ULL);
+
+	std::string name = "Single Anchor " + std::to_string(meters).substr(0, 4) + " m";
+	std::string error;
+	bool passed = checkRanges(tag.index(), anchor.shortAddress(), meters, 10, error) &&
+	              checkRanges(anchor.index(), tag.shortAddress(), meters, 10, error);
+	if(passed && protocolErrors != 0) {
+		passed = false;
+		error  = std::to_string(protocolErrors) + " protocol errors";
+	}
+	logTestResult(name, passed, error);
+	return passed;
+}
+
+bool testConfiguredTimeOfFlight() {
+	resetTestCounters();
+	DW1000Sim      sim;
+	DW1000SimNode& tag    = sim.addNode(0, 0);
+	DW1000SimNode& anchor = sim.addNode(0, 0);
+	// 1000 ticks ~ 15.65 ns ~ 4.69 m, independent of the node positions
+	sim.setTimeOfFlight(tag.index(), anchor.index(), 1000);
+	startNode(anchor, true, ANCHOR_ADDR[0]);
+	startNode(tag, false, TAG_ADDR);
+	sim.runFor(2000000000ULL);
+
+	float expected = (float)(1000/DW1000SIM_TICKS_PER_US*1e-6*DW1000SIM_SPEED_OF_LIGHT);
+	std::string error;
+	bool passed = checkRanges(tag.index(), anchor.shortAddress(), expected, 5, error);
+	logTestResult("Configured Time Of Flight", passed, error);
+	return passed;
+}
+
+// both sides with the transmit path queued on a DMA transport
+bool testDmaTransport() {
+	resetTestCounters();
+	DW1000Sim      sim;
+	DW1000SimNode& tag    = sim.addNode(0, 0);
+	DW1000SimNode& anchor = sim.addNode(6.0, 0);
+	tag.exec([](const DW1000SimNodeApi* api) { api->useDmaTransport(true); });
+	anchor.exec([](const DW1000SimNodeApi* api) { api->useDmaTransport(true); });
+	startNode(anchor, true, ANCHOR_ADDR[0]);
+	startNode(tag, false, TAG_ADDR);
+	sim.runFor(3000000000ULL);
+
+	std::string error;
+	bool passed = checkRanges(tag.index(), anchor.shortAddress(), 6.0f, 10, error) &&
+	              checkRanges(anchor.index(), tag.shortAddress(), 6.0f, 10, error);
+	if(passed && protocolErrors != 0) {
+		passed = false;
+		error  = std::to_string(protocolErrors) + " protocol errors";
+	}
+	logTestResult("DMA Transport", passed, error);
+	return passed;
+}
+
+// POLL_ACK sized frame (LEN_DATA) from one short address to another
+static std::vector<uint8_t> pollAckFrame(uint16_t from, uint16_t to, uint8_t sequence) {
+	std::vector<uint8_t> frame(90, 0);
+	frame[0] = 0x41;
+	frame[1] = 0x88;
+	frame[2] = sequence;
+	frame[5] = to >> 8;
+	frame[6] = to & 0xFF;
+	frame[7] = from >> 8;
+	frame[8] = from & 0xFF;
+	frame[9] = 1; // POLL_ACK
+	return frame;
+}
+
+// two replies back to back, the second one gapNs after the end of the first
+// (6.8 Mb/s, 128 preamble: about as long as the interrupt handler reads a frame)
+bool testBackToBackFrames(uint32_t gapNs, bool doubleBuffering) {
+	resetTestCounters();
+	DW1000Sim      sim;
+	DW1000SimNode& receiver = sim.addNode(0, 0);
+	receiver.exec([doubleBuffering](const DW1000SimNodeApi* api) { api->useDoubleBuffering(doubleBuffering); });
+	for(int i = 0; i < 2; i++) {
+		DW1000SimNode& sender = sim.addNode(3.0*(i+1), 0);
+		sender.initCommunication();
+		sender.startAsAnchor(ANCHOR_ADDR[i+1], DW1000Class::MODE_SHORTDATA_FAST_ACCURACY);
+		sender.setRunning(false);
+	}
+	receiver.initCommunication();
+	receiver.startAsAnchor(ANCHOR_ADDR[0], DW1000Class::MODE_SHORTDATA_FAST_ACCURACY);
+	sim.runFor(100000000ULL);
+
+	uint64_t airtimeNs = DW1000Sim::ticksToNs(DW1000Sim::airtime(DW1000Class::TRX_RATE_6800KBPS, DW1000Class::TX_PULSE_FREQ_64MHZ, 128, 92));
+	DW1000SimNodeStats before = receiver.stats;
+	for(int i = 0; i < 20; i++) {
+		uint64_t start = sim.nowNs()+100000;
+		sim.injectFrame(1, pollAckFrame(sim.node(1).shortAddress(), receiver.shortAddress(), (uint8_t)i), start);
+		sim.injectFrame(2, pollAckFrame(sim.node(2).shortAddress(), receiver.shortAddress(), (uint8_t)i), start+airtimeNs+gapNs);
+		sim.runFor(5000000ULL);
+	}
+
+	std::string error;
+	uint64_t    received = receiver.stats.framesReceived-before.framesReceived;
+	if(received != 40) {
+		error = std::to_string(received) + " of 40 frames received, " +
+		        std::to_string(receiver.stats.framesMissed-before.framesMissed) + " missed";
+	}
+	logTestResult(std::string(doubleBuffering ? "Double Buffered " : "") + "Back-To-Back Frames, " +
+	              std::to_string(gapNs/1000) + " us Apart", error.empty(), error);
+	return error.empty();
+}
+
+// tagLibrary/anchorLibrary: node libraries built with another DeviceState, nullptr for the default
+// tagLoopNs: added to the tag's loop interval, minRanges: per anchor and side
+// doubleBuffering: all nodes receive double buffered
+// rangingMode: of all nodes, only RANGING_ASYMMETRIC ranges are known to the anchors too
+// clockPpm: crystal offsets of the tag and the 3 anchors, nullptr for none
+// rangeReportInPollAck: the anchors report ranges with their next POLL_ACK
+// adaptiveReplyDelay: the tag times the replies from what it measured, no
+// delayed frame may be late and the exchange has to take less than 100 ms
+// (about 105 ms with the fixed 7 ms reply delays, the anchors answering twice)
+bool testMultiAnchor(const std::string& name, const char* tagLibrary = nullptr, const char* anchorLibrary = nullptr,
+                     uint32_t tagLoopNs = 0, size_t minRanges = 10, bool doubleBuffering = false,
+                     RangingMode rangingMode = RANGING_ASYMMETRIC, const double* clockPpm = nullptr,
+                     bool rangeReportInPollAck = false, bool adaptiveReplyDelay = false) {
+	resetTestCounters();
+	DW1000Sim      sim;
+	DW1000SimNode& tag = sim.addNode(0.0, 0.0, 0.0, tagLibrary);
+	const double   anchors[3][2] = { { 0.0, 0.0 }, { 5.0, 0.0 }, { 0.0, 4.0 } };
+	for(int i = 0; i < 3; i++) {
+		sim.addNode(anchors[i][0], anchors[i][1], 0.0, anchorLibrary);
+	}
+	for(int i = 0; i < sim.nodeCount(); i++) {
+		sim.node(i).exec([doubleBuffering, rangingMode, rangeReportInPollAck](const DW1000SimNodeApi* api) {
+			api->useDoubleBuffering(doubleBuffering);
+			api->setRangingMode(rangingMode);
+			api->useRangeReportInPollAck(rangeReportInPollAck);
+		});
+		if(clockPpm != nullptr) {
+			sim.node(i).clockPpm = clockPpm[i];
+		}
+	}
+	for(int i = 0; i < 3; i++) {
+		startNode(sim.node(i+1), true, ANCHOR_ADDR[i]);
+	}
+	tag.exec([adaptiveReplyDelay](const DW1000SimNodeApi* api) { api->useAdaptiveReplyDelay(adaptiveReplyDelay); });
+	startNode(tag, false, TAG_ADDR);
+	tag.extraLoopNs = tagLoopNs;
+	// all anchors answer a BLINK at the same time, the tag only decodes the
+	// strongest one; walk past every anchor so each gets discovered once
+	for(int i = 0; i < 3; i++) {
+		tag.x = anchors[i][0]+0.5;
+		tag.y = anchors[i][1]+0.5;
+		sim.runFor(3000000000ULL);
+	}
+	tag.x = 1.0;
+	tag.y = 1.0;
+	sim.runFor(200000000ULL);
+	int discoveryDetached = detachedDevices;
+	resetTestCounters();
+	sim.runFor(3000000000ULL);
+
+	std::string error;
+	bool passed = true;
+	if(discoveryDetached != 0) {
+		passed = false;
+		error  = std::to_string(discoveryDetached) + " discovery callbacks got a device not in the table";
+	}
+	for(int i = 0; i < 3 && passed; i++) {
+		float expected = (float)hypot(anchors[i][0]-tag.x, anchors[i][1]-tag.y);
+		passed = checkRanges(tag.index(), sim.node(i+1).shortAddress(), expected, minRanges, error) &&
+		         (rangingMode != RANGING_ASYMMETRIC || checkRanges(i+1, tag.shortAddress(), expected, minRanges, error));
+	}
+	if(passed && adaptiveReplyDelay) {
+		for(int i = 0; i < sim.nodeCount() && passed; i++) {
+			if(sim.node(i).stats.framesLate != 0) {
+				passed = false;
+				error  = "node " + std::to_string(i) + " sent " + std::to_string(sim.node(i).stats.framesLate) + " frames late";
+			}
+		}
+		uint32_t cycleUs = tag.api()->getCycleTime();
+		if(passed && (cycleUs == 0 || cycleUs > 100000)) {
+			passed = false;
+			error  = "exchange took " + std::to_string(cycleUs) + " us";
+		}
+	}
+	logTestResult(name, passed, error);
+	return passed;
+}
+
+// single-sided ranging corrects the anchor's reply time by the carrier
+// integrator, which the chip does not double buffer: the combination is
+// refused either way round, and asked for anyway the nodes keep ranging
+// asymmetric with correct ranges despite the clock offsets
+bool testDoubleBufferedSingleSided(const double* clockPpm) {
+	DW1000Sim      sim;
+	DW1000SimNode& node = sim.addNode(0.0, 0.0);
+	bool modeRefused      = false;
+	bool bufferingRefused = false;
+	node.exec([&](const DW1000SimNodeApi* api) {
+		api->useDoubleBuffering(true);
+		modeRefused = !api->setRangingMode(RANGING_SINGLE_SIDED);
+		api->useDoubleBuffering(false);
+		api->setRangingMode(RANGING_SINGLE_SIDED);
+		bufferingRefused = !api->useDoubleBuffering(true);
+		api->setRangingMode(RANGING_ASYMMETRIC);
+	});
+	std::string error;
+	if(!modeRefused) {
+		error = "single-sided accepted with double buffering";
+	}
+	else if(!bufferingRefused) {
+		error = "double buffering accepted with single-sided";
+	}
+	logTestResult("Single-Sided Refused With Double Buffering", error.empty(), error);
+	return error.empty() &&
+	       testMultiAnchor("Double Buffered, Single-Sided Asked For", nullptr, nullptr, 0, 10, true,
+	                       RANGING_SINGLE_SIDED, clockPpm);
+}
+
+// anchors in a ring around the tag (16 are all the _tag library keeps): the
+// compact RANGE broadcast carries the round trips to all of them in one frame,
+// 6.8 Mb/s. The tag keeps the first expected ones, with the fixed reply
+// delays the POLL has 5 slots
+static DW1000SimNode& addAnchorRing(DW1000Sim& sim, int anchorCount, bool adaptive) {
+	DW1000SimNode& tag = sim.addNode(0.0, 0.0, 0.0, DW1000_SIM_TAG_NODE_LIB);
+	for(int i = 0; i < anchorCount; i++) {
+		double angle = 2*M_PI*i/anchorCount;
+		sim.addNode((8.0+0.25*i)*cos(angle), (8.0+0.25*i)*sin(angle), 0.0);
+	}
+	for(int i = 0; i < anchorCount; i++) {
+		char address[32];
+		snprintf(address, sizeof(address), "%02X:17:5B:D5:A9:9A:E2:9C", 0x82+i);
+		startNode(sim.node(1+i), true, address, DW1000Class::MODE_SHORTDATA_FAST_ACCURACY);
+	}
+	tag.exec([adaptive](const DW1000SimNodeApi* api) { api->useAdaptiveReplyDelay(adaptive); });
+	startNode(tag, false, TAG_ADDR, DW1000Class::MODE_SHORTDATA_FAST_ACCURACY);
+	// walk past every anchor so each gets discovered once, 1 m before it the
+	// neighbours are more than captureDb weaker
+	for(int i = 0; i < anchorCount; i++) {
+		double radius = hypot(sim.node(1+i).x, sim.node(1+i).y);
+		tag.x = sim.node(1+i).x*(radius-1.0)/radius;
+		tag.y = sim.node(1+i).y*(radius-1.0)/radius;
+		sim.runFor(2000000000ULL);
+	}
+	tag.x = 0.5;
+	tag.y = 0.5;
+	sim.runFor(200000000ULL);
+	return tag;
+}
+
+// the tag knows expected anchors and ranges with each of them, no frame late
+static bool checkAnchorRing(DW1000Sim& sim, DW1000SimNode& tag, int expected, std::string& error) {
+	bool passed = tag.api()->getNetworkDevicesNumber() == expected;
+	if(!passed) {
+		error = "tag knows " + std::to_string(tag.api()->getNetworkDevicesNumber()) + " anchors";
+	}
+	// the ones the tag kept, an anchor left behind in the walk may have been
+	// replaced by a later one
+	for(int i = 1; i < sim.nodeCount() && passed; i++) {
+		DW1000SimNode& anchor = sim.node(i);
+		bool           known  = false;
+		for(uint8_t k = 0; k < tag.api()->getNetworkDevicesNumber(); k++) {
+			known = known || tag.api()->deviceShortAddress(tag.api()->getNetworkDevice(k)) == anchor.shortAddress();
+		}
+		if(known) {
+			float distance = (float)hypot(anchor.x-tag.x, anchor.y-tag.y);
+			passed = checkRanges(tag.index(), anchor.shortAddress(), distance, 10, error) &&
+			         checkRanges(anchor.index(), tag.shortAddress(), distance, 10, error);
+		}
+	}
+	for(int i = 0; i < sim.nodeCount() && passed; i++) {
+		if(sim.node(i).stats.framesLate != 0) {
+			passed = false;
+			error  = "node " + std::to_string(i) + " sent " + std::to_string(sim.node(i).stats.framesLate) + " frames late";
+		}
+	}
+	return passed;
+}
+
+bool testManyAnchors(const std::string& name, int anchorCount, bool adaptive, int expected) {
+	resetTestCounters();
+	DW1000Sim      sim;
+	DW1000SimNode& tag = addAnchorRing(sim, anchorCount, adaptive);
+	resetTestCounters();
+	sim.runFor(3000000000ULL);
+
+	std::string error;
+	bool passed = checkAnchorRing(sim, tag, expected, error);
+	logTestResult(name, passed, error);
+	return passed;
+}
+
+// 7 anchors with the measured reply delays, then the fixed ones: the POLL has
+// 5 slots left, the tag drops 2 anchors without calling them inactive, keeps
+// ranging with the other 5 and does not take the 2 back
+bool testShrinkingReplySlots() {
+	resetTestCounters();
+	DW1000Sim      sim;
+	DW1000SimNode& tag = addAnchorRing(sim, 7, true);
+	std::string    error;
+	bool passed = tag.api()->getNetworkDevicesNumber() == 7;
+	if(!passed) {
+		error = "tag knows " + std::to_string(tag.api()->getNetworkDevicesNumber()) + " anchors before";
+	}
+	tag.exec([](const DW1000SimNodeApi* api) {
+		api->attachInactiveDevice(inactiveDevice);
+		api->useAdaptiveReplyDelay(false);
+	});
+	sim.runFor(200000000ULL);
+	resetTestCounters();
+	sim.runFor(3000000000ULL);
+
+	passed = passed && checkAnchorRing(sim, tag, 5, error);
+	if(passed && inactiveDevices != 0) {
+		passed = false;
+		error  = std::to_string(inactiveDevices) + " dropped anchors reported inactive";
+	}
+	logTestResult("Reply Slots Shrinking Under Known Anchors", passed, error);
+	return passed;
+}
+
+// 8 tags around 2 anchors, the first one coordinating a superframe of 100 ms
+// slots: every tag ranges with both anchors, none of the exchanges collide
+bool testSuperframe() {
+	resetTestCounters();
+	DW1000Sim      sim;
+	const double   anchors[2][2] = { { 0.0, 0.0 }, { 6.0, 0.0 } };
+	for(int i = 0; i < 2; i++) {
+		// one slot per tag, more than MAX_DEVICES
+		DW1000SimNode& anchor = sim.addNode(anchors[i][0], anchors[i][1], 0.0, DW1000_SIM_ANCHOR_NODE_LIB);
+		startNode(anchor, true, ANCHOR_ADDR[i]);
+	}
+	sim.node(0).exec([](const DW1000SimNodeApi* api) { api->setCoordinator(100); });
+	for(int i = 0; i < 8; i++) {
+		DW1000SimNode& tag = sim.addNode(1.0+0.5*i, 1.0+0.25*i);
+		char address[24];
+		snprintf(address, sizeof(address), "7D:%02X:22:EA:82:60:3B:9C", i);
+		tag.exec([](const DW1000SimNodeApi* api) { api->useSuperframe(true); });
+		startNode(tag, false, address);
+	}
+	sim.runFor(20000000000ULL);
+	resetTestCounters();
+	sim.runFor(10000000000ULL);
+
+	std::string error;
+	bool passed = true;
+	for(int t = 2; t < sim.nodeCount() && passed; t++) {
+		DW1000SimNode& tag = sim.node(t);
+		for(int i = 0; i < 2 && passed; i++) {
+			float expected = (float)hypot(anchors[i][0]-tag.x, anchors[i][1]-tag.y);
+			passed = checkRanges(tag.index(), sim.node(i).shortAddress(), expected, 10, error) &&
+			         checkRanges(i, tag.shortAddress(), expected, 10, error);
+		}
+	}
+	if(passed && protocolErrors != 0) {
+		passed = false;
+		error  = std::to_string(protocolErrors) + " protocol errors";
+	}
+	logTestResult("Superframe, 8 Tags", passed, error);
+	return passed;
+}
+
+// 3 free running tags around one anchor: the anchor keeps all of them and
+// answers each with the reply time from that tag's POLL (it used to drop the
+// known tag for every new one)
+bool testConcurrentTags() {
+	resetTestCounters();
+	DW1000Sim      sim;
+	DW1000SimNode& anchor = sim.addNode(0, 0);
+	// 6.8 Mb/s: three exchanges fit in one tag timer period
+	startNode(anchor, true, ANCHOR_ADDR[0], DW1000Class::MODE_SHORTDATA_FAST_ACCURACY);
+	// millis() is simulation time, tags started within the first timer period tick in phase
+	sim.runFor(100000000ULL);
+	const float distances[3] = { 2.0f, 4.5f, 7.0f };
+	for(int i = 0; i < 3; i++) {
+		DW1000SimNode& tag = sim.addNode(distances[i], 0);
+		char address[24];
+		snprintf(address, sizeof(address), "7D:%02X:22:EA:82:60:3B:9C", i);
+		startNode(tag, false, address, DW1000Class::MODE_SHORTDATA_FAST_ACCURACY);
+		// each in its own part of the anchor's air time
+		sim.runFor(33000000ULL);
+	}
+	sim.runFor(10000000000ULL);
+
+	std::string error;
+	bool passed = anchor.api()->getNetworkDevicesNumber() == 3;
+	if(!passed) {
+		error = "anchor knows " + std::to_string(anchor.api()->getNetworkDevicesNumber()) + " tags";
+	}
+	for(int i = 0; i < 3 && passed; i++) {
+		DW1000SimNode& tag = sim.node(1+i);
+		passed = checkRanges(tag.index(), anchor.shortAddress(), distances[i], 20, error) &&
+		         checkRanges(anchor.index(), tag.shortAddress(), distances[i], 20, error);
+	}
+	logTestResult("Concurrent Tags On One Anchor", passed, error);
+	return passed;
+}
+
+// BLINK of another tag, address and short address (0x7E40+n) reversed
+static std::vector<uint8_t> blinkFrame(uint8_t n) {
+	std::vector<uint8_t> frame(12, 0x5A);
+	frame[0]  = 0xC5;
+	frame[1]  = n;
+	frame[2]  = n;
+	frame[10] = 0x40+n;
+	frame[11] = 0x7E;
+	return frame;
+}
+
+// another tag's BLINK read while the POLL_ACK to the ranging tag waits as a
+// delayed frame: the RANGING_INIT has to wait for it, not switch the
+// transmitter off and drop it (the anchor's slow loop queues both frames)
+bool testBlinkDuringReply() {
+	resetTestCounters();
+	DW1000Sim      sim;
+	DW1000SimNode& anchor  = sim.addNode(0, 0, 0.0, DW1000_SIM_ANCHOR_NODE_LIB);
+	DW1000SimNode& tag     = sim.addNode(3.0, 0);
+	DW1000SimNode& blinker = sim.addNode(0, 3.0);
+	blinker.initCommunication();
+	blinker.startAsAnchor(ANCHOR_ADDR[1], DW1000Class::MODE_SHORTDATA_FAST_ACCURACY);
+	blinker.setRunning(false);
+	anchor.extraLoopNs = 3000000;
+	startNode(anchor, true, ANCHOR_ADDR[0], DW1000Class::MODE_SHORTDATA_FAST_ACCURACY);
+	startNode(tag, false, TAG_ADDR, DW1000Class::MODE_SHORTDATA_FAST_ACCURACY);
+	sim.runFor(2000000000ULL);
+	// only count the injected BLINKs, not the tag's
+	blinkDevices = 0;
+
+	// a BLINK right after each of 10 POLLs, the exchange of each has to end
+	// with a range before the next POLL
+	const int           blinks       = 10;
+	int                 injected     = 0;
+	int                 completed    = 0;
+	int                 rangingInits = 0;
+	size_t              ranges       = 0;
+	uint64_t            lateBefore   = anchor.stats.framesLate;
+	std::vector<float>& tagRanges    = reportedRanges[tag.index()][anchor.shortAddress()];
+	sim.onTransmit = [&](const DW1000SimFrame& frame) {
+		if(frame.sender == anchor.index() && frame.data.size() > 15 && frame.data[1] == 0x8C && frame.data[15] == 5) {
+			rangingInits++;
+		}
+		if(frame.sender != tag.index() || frame.data.size() < 10 || frame.data[1] != 0x88 || frame.data[9] != 0) {
+			return;
+		}
+		if(injected > 0 && tagRanges.size() > ranges) {
+			completed++;
+		}
+		if(injected < blinks) {
+			ranges = tagRanges.size();
+			sim.injectFrame(blinker.index(), blinkFrame((uint8_t)injected++), DW1000Sim::ticksToNs(frame.end)+300000);
+		}
+		else {
+			// the last exchange is over, do not count the rest
+			ranges = SIZE_MAX;
+		}
+	};
+	sim.runFor(2000000000ULL);
+	sim.onTransmit = nullptr;
+
+	std::string error;
+	bool passed = injected == blinks && completed == blinks;
+	if(!passed) {
+		error = std::to_string(completed) + " of " + std::to_string(injected) + " exchanges ended with a range";
+	}
+	// each BLINK the anchor heard got its RANGING_INIT (the rest came while
+	// the POLL_ACK was waiting already, the receiver is off then)
+	if(passed && (blinkDevices == 0 || rangingInits != blinkDevices)) {
+		passed = false;
+		error  = std::to_string(rangingInits) + " RANGING_INITs for " + std::to_string(blinkDevices) + " BLINKs heard";
+	}
+	if(passed && anchor.stats.framesLate != lateBefore) {
+		passed = false;
+		error  = std::to_string(anchor.stats.framesLate-lateBefore) + " late frames";
+	}
+	if(TEST_DEBUG) {
+		std::cout << "    " << completed << " exchanges with a BLINK, " << rangingInits << " RANGING_INITs for "
+		          << blinkDevices << " BLINKs heard" << std::endl;
+	}
+	logTestResult("BLINK During A Pending Reply", passed, error);
+	return passed;
+}
+
+bool testOutOfRangeAnchor() {
+	resetTestCounters();
+	DW1000Sim      sim;
+	DW1000SimNode& tag  = sim.addNode(0, 0);
+	DW1000SimNode& near = sim.addNode(3.0, 0);
+	DW1000SimNode& far  = sim.addNode(3.0, 0);
+	// below the 110 kb/s sensitivity in both directions
+	sim.setLinkLoss(tag.index(), far.index(), 60.0);
+	startNode(near, true, ANCHOR_ADDR[0]);
+	startNode(far, true, ANCHOR_ADDR[1]);
+	startNode(tag, false, TAG_ADDR);
+	sim.runFor(2000000000ULL);
+
+	std::string error;
+	bool passed = checkRanges(tag.index(), near.shortAddress(), 3.0f, 5, error);
+	if(passed && !reportedRanges[tag.index()][far.shortAddress()].empty()) {
+		passed = false;
+		error  = "ranged an anchor below sensitivity";
+	}
+	if(passed && tag.api()->getNetworkDevicesNumber() != 1) {
+		passed = false;
+		error  = "tag knows " + std::to_string(tag.api()->getNetworkDevicesNumber()) + " devices";
+	}
+	logTestResult("Out Of Range Anchor", passed, error);
+	return passed;
+}
+
+bool testInactiveTag() {
+	resetTestCounters();
+	DW1000Sim      sim;
+	DW1000SimNode& tag    = sim.addNode(0, 0);
+	DW1000SimNode& anchor = sim.addNode(5.0, 0);
+	startNode(anchor, true, ANCHOR_ADDR[0]);
+	startNode(tag, false, TAG_ADDR);
+	anchor.exec([](const DW1000SimNodeApi* api) { api->attachInactiveDevice(inactiveDevice); });
+	sim.runFor(1000000000ULL);
+
+	// the silent tag must time out of the anchor's table and be ranged again once it resumes
+	// (inactive devices are checked every 21 timer ticks, 1.7 s)
+	tag.setRunning(false);
+	sim.runFor(3000000000ULL);
+	std::string error;
+	bool passed = true;
+	if(inactiveDevices != 1 || anchor.api()->getNetworkDevicesNumber() != 0) {
+		passed = false;
+		error  = std::to_string(inactiveDevices) + " inactive devices reported, anchor knows " +
+		         std::to_string(anchor.api()->getNetworkDevicesNumber());
+	}
+	reportedRanges.clear();
+	tag.setRunning(true);
+	sim.runFor(2000000000ULL);
+	passed = passed && checkRanges(tag.index(), anchor.shortAddress(), 5.0f, 5, error) &&
+	         checkRanges(anchor.index(), tag.shortAddress(), 5.0f, 5, error);
+	logTestResult("Inactive Tag Removal", passed, error);
+	return passed;
+}
+
+void runAllTests() {
+	std::cout << "=== Host Ranging Regression Test ===" << std::endl;
+	std::cout << std::endl;
+
+	testSingleAnchorDistance(1.0f);
+	testSingleAnchorDistance(2.5f);
+	testSingleAnchorDistance(10.0f);
+	testSingleAnchorDistance(40.0f);
+	testConfiguredTimeOfFlight();
+	testMultiAnchor("Multi-Anchor Operation");
+	testMultiAnchor("Role-Specific Device State", DW1000_SIM_TAG_NODE_LIB, DW1000_SIM_ANCHOR_NODE_LIB);
+	// frames wait in the tag's queue while newer ones arrive, the range must
+	// use the timestamps captured with each frame
+	testMultiAnchor("Frames Queued Behind A Slow Loop", nullptr, nullptr, 20000000, 5);
+	testDmaTransport();
+	// receiver on again 113 us after a frame, acquires within half the preamble
+	testBackToBackFrames(60000, false);
+	// the second frame starts before the first one is read
+	testBackToBackFrames(0, true);
+	testMultiAnchor("Double Buffered Multi-Anchor", nullptr, nullptr, 0, 10, true);
+	// +-20 ppm crystals, the anchors reply after 7, 21 and 35 ms
+	const double clockPpm[4] = { 12.0, -8.0, 20.0, -15.0 };
+	testMultiAnchor("Asymmetric With Clock Offsets", nullptr, nullptr, 0, 10, false, RANGING_ASYMMETRIC, clockPpm);
+	testMultiAnchor("Single-Sided Multi-Anchor", nullptr, nullptr, 0, 10, false, RANGING_SINGLE_SIDED);
+	testMultiAnchor("Single-Sided With Clock Offsets", nullptr, nullptr, 0, 10, false, RANGING_SINGLE_SIDED, clockPpm);
+	testDoubleBufferedSingleSided(clockPpm);
+	testMultiAnchor("Single-Sided Role-Specific Device State", DW1000_SIM_TAG_NODE_LIB, DW1000_SIM_ANCHOR_NODE_LIB, 0, 10,
+	                false, RANGING_SINGLE_SIDED, clockPpm);
+	testMultiAnchor("Range Report In POLL_ACK", nullptr, nullptr, 0, 10, false, RANGING_ASYMMETRIC, nullptr, true);
+	testMultiAnchor("Range Report In POLL_ACK, Role-Specific Device State", DW1000_SIM_TAG_NODE_LIB,
+	                DW1000_SIM_ANCHOR_NODE_LIB, 0, 10, false, RANGING_ASYMMETRIC, clockPpm, true);
+	testMultiAnchor("Ranges Computed On The Tag", nullptr, nullptr, 0, 10, false, RANGING_ASYMMETRIC_ON_TAG, clockPpm);
+	testMultiAnchor("Ranges Computed On The Tag, Role-Specific Device State", DW1000_SIM_TAG_NODE_LIB,
+	                DW1000_SIM_ANCHOR_NODE_LIB, 0, 10, false, RANGING_ASYMMETRIC_ON_TAG, clockPpm);
+	testMultiAnchor("Adaptive Reply Delay", nullptr, nullptr, 0, 10, false, RANGING_ASYMMETRIC, clockPpm, false, true);
+	testMultiAnchor("Adaptive Reply Delay, Single-Sided", nullptr, nullptr, 0, 10, false, RANGING_SINGLE_SIDED, clockPpm,
+	                false, true);
+	testMultiAnchor("Adaptive Reply Delay, Ranges Computed On The Tag", nullptr, nullptr, 0, 10, false,
+	                RANGING_ASYMMETRIC_ON_TAG, clockPpm, false, true);
+	testManyAnchors("16 Anchors In One RANGE Frame", 16, true, 16);
+	testManyAnchors("Fixed Reply Delays Take 5 Of 7 Anchors", 7, false, 5);
+	testShrinkingReplySlots();
+	testConcurrentTags();
+	testBlinkDuringReply();
+	testSuperframe();
+	testOutOfRangeAnchor();
+	testInactiveTag();
+
+	std::cout << std::endl;
+	std::cout << "=== Test Results ===" << std::endl;
+	std::cout << "Tests Run: " << testsRun << std::endl;
+	std::cout << "Tests Passed: " << testsPassed << std::endl;
+	std::cout << "Tests Failed: " << testsFailed << std::endl;
+}
+
+int main() {
+	runAllTests();
+	return testsFailed == 0 ? 0 : 1;
+}
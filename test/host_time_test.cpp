@@ -0,0 +1,268 @@
+/*
+ * Host Time Test
+ *
+ * DW1000Time integer arithmetic: time units to ticks as exact ratios (also at
+ * compile time), the millimeter range of a tick count against a long double
+ * reference over the whole 40 bit timestamp range, DW1000Time built from a
+ * TimeUnit, and the asymmetric two-way ranging time of flight against a 128
+ * bit reference for random durations over the whole 40 bit range. The
+ * receive power estimates and the range bias correction of the timestamps,
+ * which are integer too, against the float formulas of the user manual. A
+ * device keeps its range to the millimeter. The library is linked directly
+ * (no simulator).
+ *
+ * Build and run with: make -C test test
+ */
+
+#include <math.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include "DW1000.h"
+#include "DW1000Device.h"
+#include "DW1000Time.h"
+#include "HostRandom.h"
+#include "HostTest.h"
+
+// usable where a constant is needed
+static_assert(DW1000Time::microsecondsToTicks(7000) == 447283200, "7 ms reply delay");
+static_assert(DW1000Time::toTicks(1, DW1000Time::TimeUnit::SECONDS) == DW1000Time::TICKS_PER_SECOND, "one second");
+// a unit is no factor, old float arithmetic on the names must not pick it up
+static_assert(!std::is_convertible<DW1000Time::TimeUnit, float>::value, "TimeUnit converts to float");
+
+bool testUnitConversions() {
+	std::ostringstream error;
+	struct {
+		int32_t              value;
+		DW1000Time::TimeUnit unit;
+		int64_t              ticks;
+	} cases[] = {
+		{ 625, DW1000Time::TimeUnit::NANOSECONDS, 39936 },
+		{ 1, DW1000Time::TimeUnit::NANOSECONDS, 63 },
+		{ -1, DW1000Time::TimeUnit::NANOSECONDS, -63 },
+		{ 5, DW1000Time::TimeUnit::MICROSECONDS, 319488 },
+		{ 1, DW1000Time::TimeUnit::MICROSECONDS, 63897 },
+		{ 7000, DW1000Time::TimeUnit::MICROSECONDS, 447283200 },
+		{ 10, DW1000Time::TimeUnit::MILLISECONDS, 638976000 },
+		{ 17, DW1000Time::TimeUnit::SECONDS, 1086259200000LL },
+	};
+	for(auto& c : cases) {
+		DW1000Time time(c.value, c.unit);
+		if(time.getTimestamp() != c.ticks) {
+			error << c.value << " in unit " << (int)c.unit << " is " << time.getTimestamp() << " ticks, expected " << c.ticks << "; ";
+		}
+	}
+	// every whole number of microseconds, as floor(us*63897.6)
+	for(int64_t us = 0; us < 1000000 && error.str().empty(); us++) {
+		int64_t reference = (int64_t)floorl((long double)us*63897.6L+1e-9L);
+		if(DW1000Time::microsecondsToTicks(us) != reference) {
+			error << us << " us is " << DW1000Time::microsecondsToTicks(us) << " ticks, expected " << reference;
+		}
+	}
+	logTestResult("Exact Time Unit Conversions", error.str().empty(), error.str());
+	return error.str().empty();
+}
+
+bool testMillimeters() {
+	std::ostringstream error;
+	long double        worst = 0;
+	// every tick count up to about 1 km, then strides over the 40 bit range
+	for(int64_t ticks = -2000; ticks < 300000; ticks++) {
+		long double reference = (long double)ticks*299792458000.0L/63897600000.0L;
+		long double deviation = fabsl(DW1000Time::ticksToMillimeters(ticks)-reference);
+		worst = deviation > worst ? deviation : worst;
+	}
+	for(int64_t ticks = 0; ticks <= DW1000Time::TIME_MAX; ticks += 7919*7907) {
+		long double reference = (long double)ticks*299792458000.0L/63897600000.0L;
+		long double deviation = fabsl(DW1000Time::ticksToMillimeters(ticks)-reference);
+		worst = deviation > worst ? deviation : worst;
+	}
+	DW1000Time max(DW1000Time::TIME_MAX);
+	long double maxReference = (long double)DW1000Time::TIME_MAX*299792458000.0L/63897600000.0L;
+	if(fabsl(max.getAsMillimeters()-maxReference) > 0.5L) {
+		error << "TIME_MAX is " << max.getAsMillimeters() << " mm, expected " << (double)maxReference << "; ";
+	}
+	if(worst > 0.5L) {
+		error << "off by up to " << (double)worst << " mm";
+	}
+	logTestResult("Millimeters Rounded Over 40 Bits", error.str().empty(), error.str());
+	return error.str().empty();
+}
+
+// random duration, small ones and ones of any bit length up to 40 bits
+static int64_t randomDuration() {
+	uint8_t bits = 1+nextRandom()%40;
+	return (int64_t)(nextRandom() & ((1ULL << bits)-1));
+}
+
+static int64_t referenceTimeOfFlight(int64_t round1, int64_t reply1, int64_t round2, int64_t reply2) {
+	__int128 sum = (__int128)round1+round2+reply1+reply2;
+	if(sum == 0) {
+		return 0;
+	}
+	return (int64_t)(((__int128)round1*round2-(__int128)reply1*reply2)/sum);
+}
+
+bool testAsymmetricTimeOfFlight() {
+	std::ostringstream error;
+	const int64_t      max = DW1000Time::TIME_MAX;
+	int64_t            edges[][4] = {
+		{ 0, 0, 0, 0 },
+		{ max, max, max, max },
+		{ max, 0, max, 0 },
+		{ 0, max, 0, max },
+		{ max, 0, 0, max },
+		{ 1, 0, 0, 0 },
+		// 5th anchor slot, 63 ms replies: overflowed int64_t before
+		{ 4025548800LL+2000, 4025548800LL, 447283200LL+2000, 447283200LL },
+		{ (1LL << 31)-1, (1LL << 31)-1, (1LL << 31)-1, 1LL << 31 },
+	};
+	for(auto& e : edges) {
+		int64_t tof       = DW1000Time::asymmetricTimeOfFlight(e[0], e[1], e[2], e[3]);
+		int64_t reference = referenceTimeOfFlight(e[0], e[1], e[2], e[3]);
+		if(tof != reference) {
+			error << "(" << e[0] << ", " << e[1] << ", " << e[2] << ", " << e[3] << ") is " << tof << ", expected " << reference << "; ";
+		}
+	}
+	int failed = 0;
+	for(int i = 0; i < 2000000; i++) {
+		int64_t round1 = randomDuration();
+		int64_t reply1 = randomDuration();
+		int64_t round2 = randomDuration();
+		int64_t reply2 = randomDuration();
+		// realistic: round trip = reply + 2 time of flight
+		if(i & 1) {
+			round1 = reply1+(int64_t)(nextRandom()%100000);
+			round2 = reply2+(int64_t)(nextRandom()%100000);
+		}
+		int64_t tof       = DW1000Time::asymmetricTimeOfFlight(round1, reply1, round2, reply2);
+		int64_t reference = referenceTimeOfFlight(round1, reply1, round2, reply2);
+		if(tof != reference && failed++ < 3) {
+			error << "(" << round1 << ", " << reply1 << ", " << round2 << ", " << reply2 << ") is " << tof << ", expected " << reference << "; ";
+		}
+	}
+	if(failed > 0) {
+		error << failed << " of 2000000 random cases differ";
+	}
+	logTestResult("Asymmetric Time Of Flight Exact Over 40 Bits", error.str().empty(), error.str());
+	return error.str().empty();
+}
+
+// user manual 4.7.2, C the CIR power, N the preamble accumulation count
+static double referenceReceivePower(uint16_t C, uint16_t N, bool prf16) {
+	double A       = prf16 ? 113.77 : 121.74;
+	double corrFac = prf16 ? 2.3334 : 1.1667;
+	double power   = 10.0*log10((double)C*131072.0/((double)N*N))-A;
+	return power <= -88 ? power : power+(power+88)*corrFac;
+}
+
+static void setDiagnostics(DW1000RxDiagnostics& diagnostics, uint16_t C, uint16_t N) {
+	memset(&diagnostics, 0, sizeof(diagnostics));
+	diagnostics.rxFrameQuality[CIR_PWR_SUB]   = C & 0xFF;
+	diagnostics.rxFrameQuality[CIR_PWR_SUB+1] = C >> 8;
+	diagnostics.rxFrameInfo[2] = (N & 0x0F) << 4;
+	diagnostics.rxFrameInfo[3] = N >> 4;
+}
+
+// the bias table of the 500 MHz channels interpolated in double, in ticks
+static double referenceBias(double power, bool prf16) {
+	const byte* table = prf16 ? DW1000Class::BIAS_500_16 : DW1000Class::BIAS_500_64;
+	byte        zero  = prf16 ? DW1000Class::BIAS_500_16_ZERO : DW1000Class::BIAS_500_64_ZERO;
+	double      base  = -(power+61.0)*0.5;
+	int         low   = (int)base;
+	int         high  = low+1;
+	if(low <= 0) {
+		low  = 0;
+		high = 0;
+	}
+	else if(high >= 17) {
+		low  = 17;
+		high = 17;
+	}
+	double biasLow  = low < zero ? -table[low] : table[low];
+	double biasHigh = high < zero ? -table[high] : table[high];
+	return (biasLow+(base-low)*(biasHigh-biasLow))*DW1000Time::DISTANCE_OF_RADIO_INV*0.001;
+}
+
+bool testReceivePower() {
+	std::ostringstream error;
+	int                worst = 0;
+	for(int prf16 = 0; prf16 <= 1; prf16++) {
+		DW1000Class::_pulseFrequency = prf16 ? DW1000Class::TX_PULSE_FREQ_16MHZ : DW1000Class::TX_PULSE_FREQ_64MHZ;
+		DW1000Class::_channel        = DW1000Class::CHANNEL_5;
+		for(uint32_t C = 1; C <= 65535; C += 1+C/64) {
+			for(uint16_t N = 16; N <= 4095; N += 1+N/16) {
+				DW1000RxDiagnostics diagnostics;
+				setDiagnostics(diagnostics, C, N);
+				double  reference = referenceReceivePower(C, N, prf16);
+				int16_t power     = DW1000.getReceivePowerCentiDbm(diagnostics);
+				// a 1/100 dBm of the estimate grows by the correction factor (up to 3.3)
+				int     difference = abs(power-(int)lround(reference*100));
+				worst = difference > worst ? difference : worst;
+				if(difference > 4 && error.str().size() < 200) {
+					error << "C " << C << " N " << N << " is " << power << " cdBm, expected " << reference << " dBm; ";
+				}
+				// the correction truncated to whole ticks like the float one
+				DW1000Time corrected((int64_t)1000000000);
+				DW1000.correctTimestamp(corrected, power);
+				double bias = trunc(referenceBias(power/100.0, prf16));
+				if(fabs(1000000000.0-bias-(double)corrected.getTimestamp()) > 0.5 && error.str().size() < 200) {
+					error << "at " << power << " cdBm corrected by " << 1000000000LL-corrected.getTimestamp() << " ticks, expected " << bias << "; ";
+				}
+			}
+		}
+	}
+	if(TEST_DEBUG) {
+		std::cout << "    worst receive power difference " << worst << " cdBm" << std::endl;
+	}
+	logTestResult("Integer Receive Power And Range Bias", error.str().empty(), error.str());
+	return error.str().empty();
+}
+
+// the range in mm as computed, not rounded to cm
+bool testDeviceRange() {
+	std::ostringstream error;
+	DW1000Device       device;
+	const int32_t      ranges[] = { 1, 9, 1234, -7, 45678, 2147483647 };
+	for(int32_t range : ranges) {
+		device.setRangeMillimeters(range);
+		if(device.getRangeMillimeters() != range) {
+			error << range << " mm read back as " << device.getRangeMillimeters() << " mm; ";
+		}
+	}
+	device.setRangeMillimeters(1234);
+	if(fabsf(device.getRange()-1.234f) > 1e-6f) {
+		error << "1234 mm is " << device.getRange() << " m; ";
+	}
+	device.setRange(2.345f);
+	if(device.getRangeMillimeters() != 2345) {
+		error << "2.345 m is " << device.getRangeMillimeters() << " mm; ";
+	}
+	logTestResult("Device Range In Millimeters", error.str().empty(), error.str());
+	return error.str().empty();
+}
+
+void runAllTests() {
+	std::cout << "=== Host Time Test ===" << std::endl;
+	std::cout << std::endl;
+
+	testUnitConversions();
+	testMillimeters();
+	testAsymmetricTimeOfFlight();
+	testReceivePower();
+	testDeviceRange();
+
+	std::cout << std::endl;
+	std::cout << "=== Test Results ===" << std::endl;
+	std::cout << "Tests Run: " << testsRun << std::endl;
+	std::cout << "Tests Passed: " << testsPassed << std::endl;
+	std::cout << "Tests Failed: " << testsFailed << std::endl;
+}
+
+int main() {
+	runAllTests();
+	return testsFailed == 0 ? 0 : 1;
+}
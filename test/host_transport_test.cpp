@@ -0,0 +1,276 @@
+/*
+ * Host Transport Test
+ *
+ * DW1000Class register access through DW1000Transport: headers and offsets
+ * on a memory backed transport (host/DW1000MemoryTransport.h), the transmit
+ * path queuing its writes in order ahead of the next read, the register
+ * cache skipping and narrowing writes of unchanged bytes, and the bulk
+ * transfers of the default transport on the Arduino SPI class. The library is
+ * linked directly (no simulator).
+ *
+ * Build and run with: make -C test test
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DW1000.h"
+#include "DW1000MemoryTransport.h"
+#include "DW1000SimNode.h"
+#include "HostTest.h"
+
+bool testRegisterRoundTrip() {
+	DW1000MemoryTransport memory;
+	std::string           error;
+	DW1000.setTransport(&memory);
+
+	byte config[LEN_SYS_CFG] = { 0x11, 0x22, 0x33, 0x44 };
+	byte antennaDelay[LEN_LDE_RXANTD] = { 0x55, 0x66 };
+	byte readBack[LEN_SYS_CFG];
+	DW1000.writeBytes(SYS_CFG, NO_SUB, config, LEN_SYS_CFG);
+	DW1000.writeByte(PMSC, PMSC_CTRL0_SUB+1, 0x77);
+	// offset above 127, three byte header
+	DW1000.writeBytes(LDE_IF, LDE_RXANTD_SUB, antennaDelay, LEN_LDE_RXANTD);
+	DW1000.readBytes(SYS_CFG, NO_SUB, readBack, LEN_SYS_CFG);
+
+	if(memcmp(memory.registers[SYS_CFG].data(), config, LEN_SYS_CFG) != 0 || memcmp(readBack, config, LEN_SYS_CFG) != 0) {
+		error = "SYS_CFG not written/read back";
+	}
+	else if(memory.registers[PMSC][PMSC_CTRL0_SUB+1] != 0x77) {
+		error = "PMSC sub-address write missed";
+	}
+	else if(memcmp(memory.registers[LDE_IF].data()+LDE_RXANTD_SUB, antennaDelay, LEN_LDE_RXANTD) != 0) {
+		error = "extended sub-address write missed";
+	}
+	else if(memory.log.size() != 4 || memory.log[2].reg != LDE_IF || memory.log[2].offset != LDE_RXANTD_SUB ||
+	        memory.log[3].write) {
+		error = "unexpected transactions";
+	}
+	DW1000.setTransport(nullptr);
+	logTestResult("Register Headers And Offsets", error.empty(), error);
+	return error.empty();
+}
+
+bool testTransmitQueued() {
+	DW1000MemoryTransport memory;
+	std::string           error;
+	DW1000.setTransport(&memory);
+
+	// setData() also sends the two CRC bytes
+	byte frame[20+2];
+	for(int i = 0; i < 20; i++) {
+		frame[i] = (byte)(0xA0+i);
+	}
+	DW1000.newTransmit();
+	DW1000.setDefaults();
+	size_t before = memory.log.size();
+	DW1000.setData(frame, 20);
+	DW1000.startTransmit();
+
+	if(memory.log.size() != before || !DW1000.isTransportBusy()) {
+		error = "transmit path did not queue its writes";
+	}
+	else if(memory.registers[TX_BUFFER][0] != 0) {
+		error = "queued frame reached the chip early";
+	}
+	if(error.empty()) {
+		// the DMA finishes the frame data, the rest is still queued
+		memory.complete();
+		if(memcmp(memory.registers[TX_BUFFER].data(), frame, 20) != 0 || !DW1000.isTransportBusy()) {
+			error = "frame data not written by the first queued write";
+		}
+	}
+	if(error.empty()) {
+		// a read waits for the queue
+		DW1000Time time;
+		DW1000.getTransmitTimestamp(time);
+		const uint8_t expected[] = { TX_BUFFER, TX_FCTRL, SYS_CTRL, TX_TIME };
+		if(memory.log.size() != before+4 || DW1000.isTransportBusy()) {
+			error = std::to_string(memory.log.size()-before) + " transactions after the read";
+		}
+		for(int i = 0; i < 4 && error.empty(); i++) {
+			const DW1000MemoryTransport::Transaction& transaction = memory.log[before+i];
+			if(transaction.reg != expected[i] || transaction.queued != (i < 3)) {
+				error = "transaction " + std::to_string(i) + " out of order";
+			}
+		}
+		if(error.empty() && (memory.registers[TX_FCTRL][0] != 22 || !(memory.registers[SYS_CTRL][0] & 0x02))) {
+			error = "frame length or TXSTRT not written";
+		}
+	}
+	DW1000.setTransport(nullptr);
+	logTestResult("Transmit Path Queued In Order", error.empty(), error);
+	return error.empty();
+}
+
+bool testRegisterCache() {
+	DW1000MemoryTransport memory;
+	std::string           error;
+	DW1000.setTransport(&memory);
+	DW1000.useRegisterCache(true);
+	DW1000.resetRegisterCacheStats();
+
+	byte config[LEN_SYS_CFG] = { 0x11, 0x22, 0x33, 0x44 };
+	DW1000.writeBytes(SYS_CFG, NO_SUB, config, LEN_SYS_CFG);
+	size_t before = memory.log.size();
+	// unchanged, skipped
+	DW1000.writeBytes(SYS_CFG, NO_SUB, config, LEN_SYS_CFG);
+	if(memory.log.size() != before || DW1000.getSavedSpiTransactions() != 1 || DW1000.getSavedSpiBytes() != 1+LEN_SYS_CFG) {
+		error = "unchanged write not skipped";
+	}
+	if(error.empty()) {
+		// only the two dirty bytes in the middle go out, sub-addressed
+		config[1] = 0xAA;
+		config[2] = 0xBB;
+		DW1000.writeBytes(SYS_CFG, NO_SUB, config, LEN_SYS_CFG);
+		const DW1000MemoryTransport::Transaction& transaction = memory.log.back();
+		if(memory.log.size() != before+1 || transaction.offset != 1 || transaction.length != 2 ||
+		   memcmp(memory.registers[SYS_CFG].data(), config, LEN_SYS_CFG) != 0) {
+			error = "write not narrowed to the dirty bytes";
+		}
+		// 5 bytes before, header with sub-address and 2 bytes now
+		else if(DW1000.getSavedSpiBytes() != 1+LEN_SYS_CFG+1) {
+			error = "saved bytes " + std::to_string(DW1000.getSavedSpiBytes());
+		}
+	}
+	if(error.empty()) {
+		// a write spanning several cached registers makes them stale
+		byte pllTune = 0x1F;
+		byte fsCtrl[LEN_FS_XTALT+FS_XTALT_SUB];
+		DW1000.writeBytes(FS_CTRL, FS_PLLTUNE_SUB, &pllTune, LEN_FS_PLLTUNE);
+		memset(fsCtrl, 0, sizeof(fsCtrl));
+		DW1000.writeBytes(FS_CTRL, NO_SUB, fsCtrl, sizeof(fsCtrl));
+		before = memory.log.size();
+		DW1000.writeBytes(FS_CTRL, FS_PLLTUNE_SUB, &pllTune, LEN_FS_PLLTUNE);
+		if(memory.log.size() != before+1 || memory.registers[FS_CTRL][FS_PLLTUNE_SUB] != pllTune) {
+			error = "overlapping write did not invalidate";
+		}
+	}
+	if(error.empty()) {
+		// the whole cache is dropped with a reset
+		DW1000.softReset();
+		before = memory.log.size();
+		DW1000.writeBytes(SYS_CFG, NO_SUB, config, LEN_SYS_CFG);
+		if(memory.log.size() != before+1 || memory.log.back().length != LEN_SYS_CFG) {
+			error = "cache still valid after a reset";
+		}
+	}
+	if(error.empty()) {
+		// receiver() sets the same configuration on every call
+		DW1000.newReceive();
+		DW1000.receivePermanently(true);
+		before = memory.log.size();
+		uint32_t saved = DW1000.getSavedSpiTransactions();
+		DW1000.newReceive();
+		DW1000.receivePermanently(true);
+		for(size_t i = before; i < memory.log.size(); i++) {
+			if(memory.log[i].reg == SYS_CFG && memory.log[i].write) {
+				error = "SYS_CFG rewritten unchanged";
+			}
+		}
+		if(error.empty() && DW1000.getSavedSpiTransactions() != saved+1) {
+			error = "skipped write not counted";
+		}
+	}
+	DW1000.flushTransport();
+	DW1000.setTransport(nullptr);
+	logTestResult("Shadow Cache Skips Unchanged Bytes", error.empty(), error);
+	return error.empty();
+}
+
+/* default transport on the host SPI class */
+
+struct Bus {
+	std::vector<uint8_t>  out;
+	std::vector<uint32_t> calls;
+	uint32_t              transactions;
+};
+
+static uint64_t busNow(void*) { return 0; }
+static void     busConsume(void*, uint64_t) {}
+static void     busDigitalWrite(void*, uint8_t, uint8_t) {}
+static void     busBegin(void*, uint32_t) {}
+
+static uint8_t busTransfer(void* ctx, uint8_t out) {
+	Bus* bus = (Bus*)ctx;
+	bus->out.push_back(out);
+	bus->calls.push_back(1);
+	return (uint8_t)bus->out.size();
+}
+
+static void busTransferBytes(void* ctx, uint8_t* buf, uint32_t count) {
+	Bus* bus = (Bus*)ctx;
+	for(uint32_t i = 0; i < count; i++) {
+		bus->out.push_back(buf[i]);
+		buf[i] = (uint8_t)bus->out.size();
+	}
+	bus->calls.push_back(count);
+}
+
+static void busEnd(void* ctx) {
+	((Bus*)ctx)->transactions++;
+}
+
+bool testBulkTransfers() {
+	Bus            bus   = {};
+	DW1000SimHooks hooks = {};
+	std::string    error;
+	hooks.ctx                 = &bus;
+	hooks.nowNs               = busNow;
+	hooks.consumeNs           = busConsume;
+	hooks.digitalWrite        = busDigitalWrite;
+	hooks.spiBeginTransaction = busBegin;
+	hooks.spiTransfer         = busTransfer;
+	hooks.spiTransferBytes    = busTransferBytes;
+	hooks.spiEndTransaction   = busEnd;
+	hostBindHooks(&hooks);
+
+	byte frame[100];
+	for(int i = 0; i < 100; i++) {
+		frame[i] = (byte)i;
+	}
+	DW1000.writeBytes(TX_BUFFER, NO_SUB, frame, sizeof(frame));
+	// header and 63 bytes, then the rest
+	if(bus.transactions != 1 || bus.calls.size() != 2 || bus.calls[0] != DW1000_SPI_CHUNK || bus.calls[1] != 101-DW1000_SPI_CHUNK) {
+		error = "write not sent in bulk";
+	}
+	else if(bus.out[0] != (0x80 | TX_BUFFER) || memcmp(bus.out.data()+1, frame, sizeof(frame)) != 0) {
+		error = "write sent wrong bytes";
+	}
+	if(error.empty()) {
+		byte data[4];
+		bus.out.clear();
+		bus.calls.clear();
+		DW1000.readBytes(RX_FQUAL, FP_AMPL2_SUB, data, sizeof(data));
+		// bytes after the two header bytes, as numbered by busTransferBytes()
+		if(bus.transactions != 2 || bus.calls.size() != 1 || bus.out.size() != 6 || bus.out[1] != FP_AMPL2_SUB ||
+		   data[0] != 3 || data[3] != 6) {
+			error = "read not done in one bulk transfer";
+		}
+	}
+	hostBindHooks(nullptr);
+	logTestResult("Default Transport Bulk Transfers", error.empty(), error);
+	return error.empty();
+}
+
+void runAllTests() {
+	std::cout << "=== Host Transport Test ===" << std::endl;
+	std::cout << std::endl;
+
+	testRegisterRoundTrip();
+	testTransmitQueued();
+	testRegisterCache();
+	testBulkTransfers();
+
+	std::cout << std::endl;
+	std::cout << "=== Test Results ===" << std::endl;
+	std::cout << "Tests Run: " << testsRun << std::endl;
+	std::cout << "Tests Passed: " << testsPassed << std::endl;
+	std::cout << "Tests Failed: " << testsFailed << std::endl;
+}
+
+int main() {
+	runAllTests();
+	return testsFailed == 0 ? 0 : 1;
+}
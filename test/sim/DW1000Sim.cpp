@@ -0,0 +1,1109 @@
+/*
+ * Register-level, discrete-event simulator for the DW1000 library.
+ * See DW1000Sim.h for the model overview.
+ */
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "DW1000Constants.h"
+#include "DW1000Sim.h"
+
+#ifndef DW1000_SIM_NODE_LIB
+#define DW1000_SIM_NODE_LIB "build/libdw1000node.so"
+#endif
+
+// values of DW1000Class::TRX_RATE_* and TX_PULSE_FREQ_*
+#define SIM_RATE_110KBPS 0x00
+#define SIM_RATE_850KBPS 0x01
+#define SIM_PRF_64MHZ    0x02
+
+// status bits not named in DW1000Constants.h
+#define SIM_RXPRD_BIT   8
+#define SIM_RXSFDD_BIT  9
+#define SIM_RXPHD_BIT   11
+#define SIM_HPDWARN_BIT 27
+
+#define SIM_TIME_MASK 0xFFFFFFFFFFULL
+
+static DW1000SimNode* _currentNode = nullptr;
+
+static uint16_t preambleSymbols(uint8_t txpsr) {
+	switch(txpsr & 0x0F) {
+		case 0x01: return 64;
+		case 0x05: return 128;
+		case 0x09: return 256;
+		case 0x0D: return 512;
+		case 0x02: return 1024;
+		case 0x06: return 1536;
+		case 0x0A: return 2048;
+		case 0x03: return 4096;
+		default:   return 128;
+	}
+}
+
+// leading edge detection bias over received power in 2 dBm steps from -61 dBm
+// (user manual 4.7.2, same tables as DW1000Class::BIAS_*), in mm
+static const int16_t BIAS_500_16[] = {-198, -187, -179, -163, -143, -127, -109, -84, -59, -31, 0, 36, 65, 84, 97, 106, 110, 112};
+static const int16_t BIAS_500_64[] = {-110, -105, -100, -93, -82, -69, -51, -27, 0, 21, 35, 42, 49, 62, 71, 76, 81, 86};
+static const int16_t BIAS_900_16[] = {-274, -244, -210, -176, -138, -94, -50, 0, 42, 96, 158, 210, 254, 294, 320, 338, 356, 394};
+static const int16_t BIAS_900_64[] = {-294, -266, -234, -198, -150, -100, -58, 0, 48, 90, 126, 152, 174, 196, 232, 244, 264, 284};
+
+static int64_t rangeBiasTicks(double powerDbm, uint8_t channel, uint8_t prf) {
+	const int16_t* bias;
+	if(channel == 4 || channel == 7) {
+		bias = prf == SIM_PRF_64MHZ ? BIAS_900_64 : BIAS_900_16;
+	}
+	else {
+		bias = prf == SIM_PRF_64MHZ ? BIAS_500_64 : BIAS_500_16;
+	}
+	double step = -(powerDbm+61.0)*0.5;
+	int    low  = (int)step;
+	int    high = low+1;
+	if(low <= 0) {
+		low  = 0;
+		high = 0;
+	}
+	else if(high >= 17) {
+		low  = 17;
+		high = 17;
+	}
+	double mm = bias[low]+(step-low)*(bias[high]-bias[low]);
+	return (int64_t)(mm*0.001/DW1000SIM_SPEED_OF_LIGHT*1e6*DW1000SIM_TICKS_PER_US);
+}
+
+/* ###########################################################################
+ * #### DW1000Sim ############################################################
+ * ######################################################################### */
+
+DW1000Sim::DW1000Sim(const DW1000SimConfig& config, const char* libraryPath)
+	: _config(config), _now(0), _seq(0), _frameId(0), _airtimeNs(0), _rng(config.seed*0x9E3779B97F4A7C15ULL+1) {
+	if(libraryPath == nullptr) {
+		libraryPath = getenv("DW1000_SIM_NODE_LIB");
+	}
+	_libraryPath = libraryPath ? libraryPath : DW1000_SIM_NODE_LIB;
+}
+
+DW1000Sim::~DW1000Sim() {
+	for(DW1000SimNode* node : _nodes) {
+		delete node;
+	}
+}
+
+DW1000SimNode& DW1000Sim::addNode(double x, double y, double z, const char* libraryPath) {
+	DW1000SimNode* node = new DW1000SimNode(this, (int)_nodes.size(), libraryPath ? libraryPath : _libraryPath);
+	node->x = x;
+	node->y = y;
+	node->z = z;
+	if(_config.clockPpmSpread > 0) {
+		node->clockPpm = ((random()%20001)/10000.0-1.0)*_config.clockPpmSpread;
+	}
+	_nodes.push_back(node);
+	for(auto& row : _tofOverride) {
+		row.push_back(-1);
+	}
+	for(auto& row : _extraLoss) {
+		row.push_back(0.0);
+	}
+	_tofOverride.push_back(std::vector<int64_t>(_nodes.size(), -1));
+	_extraLoss.push_back(std::vector<double>(_nodes.size(), 0.0));
+	return *node;
+}
+
+void DW1000Sim::setTimeOfFlight(int a, int b, int64_t ticks) {
+	_tofOverride[a][b] = ticks;
+	_tofOverride[b][a] = ticks;
+}
+
+void DW1000Sim::setDistance(int a, int b, double meters) {
+	setTimeOfFlight(a, b, (int64_t)llround(meters/DW1000SIM_SPEED_OF_LIGHT*1e6*DW1000SIM_TICKS_PER_US));
+}
+
+void DW1000Sim::setLinkLoss(int a, int b, double extraLossDb) {
+	_extraLoss[a][b] = extraLossDb;
+	_extraLoss[b][a] = extraLossDb;
+}
+
+static double distance(const DW1000SimNode& a, const DW1000SimNode& b) {
+	double dx = a.x-b.x;
+	double dy = a.y-b.y;
+	double dz = a.z-b.z;
+	return sqrt(dx*dx+dy*dy+dz*dz);
+}
+
+int64_t DW1000Sim::timeOfFlight(int from, int to) const {
+	if(_tofOverride[from][to] >= 0) {
+		return _tofOverride[from][to];
+	}
+	double meters = distance(*_nodes[from], *_nodes[to]);
+	return (int64_t)llround(meters/DW1000SIM_SPEED_OF_LIGHT*1e6*DW1000SIM_TICKS_PER_US);
+}
+
+double DW1000Sim::receivedPower(int from, int to) const {
+	double meters = distance(*_nodes[from], *_nodes[to]);
+	if(_tofOverride[from][to] >= 0) {
+		meters = _tofOverride[from][to]/DW1000SIM_TICKS_PER_US*1e-6*DW1000SIM_SPEED_OF_LIGHT;
+	}
+	if(meters < 1.0) {
+		meters = 1.0;
+	}
+	return _config.txPowerDbm-_config.referenceLossDb-10.0*_config.pathLossExponent*log10(meters)-_extraLoss[from][to]-
+	       _nodes[from]->extraLossDb-_nodes[to]->extraLossDb;
+}
+
+DW1000SimChannelStats DW1000Sim::channelStats() const {
+	DW1000SimChannelStats stats;
+	memset(&stats, 0, sizeof(stats));
+	stats.airtimeNs = _airtimeNs;
+	for(const DW1000SimNode* node : _nodes) {
+		stats.framesSent     += node->stats.framesSent;
+		stats.framesReceived += node->stats.framesReceived;
+		stats.framesCollided += node->stats.framesCollided;
+		stats.framesMissed   += node->stats.framesMissed;
+		stats.framesLate     += node->stats.framesLate;
+	}
+	return stats;
+}
+
+int64_t DW1000Sim::airtime(uint8_t dataRate, uint8_t prf, uint16_t preambleSymbols, uint16_t length, int64_t* preambleSfd) {
+	// DW1000 user manual 3.4 / IEEE 802.15.4a symbol timings, channel 1-5 and 7
+	double symbolNs  = prf == SIM_PRF_64MHZ ? 1017.63 : 993.59;
+	int    sfd       = dataRate == SIM_RATE_110KBPS ? 64 : (dataRate == SIM_RATE_850KBPS ? 16 : 8);
+	double phrBitNs  = dataRate == SIM_RATE_110KBPS ? 8205.13 : 1025.64;
+	double dataBitNs = dataRate == SIM_RATE_110KBPS ? 8205.13 : (dataRate == SIM_RATE_850KBPS ? 1025.64 : 128.21);
+	// Reed-Solomon adds 48 parity bits per 330 data bits
+	uint32_t bits = (uint32_t)length*8;
+	bits += (bits+329)/330*48;
+	double shrNs = (preambleSymbols+sfd)*symbolNs;
+	if(preambleSfd) {
+		*preambleSfd = nsToTicks((uint64_t)shrNs);
+	}
+	return nsToTicks((uint64_t)(shrNs+21*phrBitNs+bits*dataBitNs));
+}
+
+uint32_t DW1000Sim::random() {
+	// splitmix64
+	uint64_t z = (_rng += 0x9E3779B97F4A7C15ULL);
+	z = (z^(z >> 30))*0xBF58476D1CE4E5B9ULL;
+	z = (z^(z >> 27))*0x94D049BB133111EBULL;
+	return (uint32_t)((z^(z >> 31)) >> 32);
+}
+
+DW1000SimNode* DW1000Sim::current() {
+	return _currentNode;
+}
+
+void DW1000Sim::schedule(int64_t t, int kind, int node) {
+	Event event = { t, _seq++, kind, node };
+	_events.push(event);
+}
+
+void DW1000Sim::runSlice(DW1000SimNode& node, int64_t start, const std::function<void()>& body) {
+	DW1000SimNode* previous = _currentNode;
+	_currentNode     = &node;
+	node._inSlice    = true;
+	node._sliceStart = start;
+	node._consumed   = 0;
+	body();
+	node._inSlice    = false;
+	node._busyUntil  = start+node._consumed;
+	node.stats.busyNs += ticksToNs(node._consumed);
+	_currentNode     = previous;
+}
+
+void DW1000Sim::transmit(DW1000SimNode& sender, const std::shared_ptr<DW1000SimFrame>& frame) {
+	_airtimeNs += ticksToNs(frame->end-frame->start);
+	double sensitivity = _config.sensitivityDbm[frame->dataRate > 2 ? 2 : frame->dataRate];
+	for(DW1000SimNode* receiver : _nodes) {
+		if(receiver == &sender) {
+			continue;
+		}
+		double power = receivedPower(sender._index, receiver->_index);
+		// too weak to be detected or to disturb anything
+		if(power < sensitivity-_config.captureDb) {
+			continue;
+		}
+		int64_t tof = timeOfFlight(sender._index, receiver->_index);
+		receiver->pushRadioEvent(frame->start+tof, DW1000SimNode::RADIO_RX_START, frame, power);
+		receiver->pushRadioEvent(frame->end+tof, DW1000SimNode::RADIO_RX_END, frame, power);
+	}
+	if(onTransmit) {
+		onTransmit(*frame);
+	}
+}
+
+void DW1000Sim::injectFrame(int sender, const std::vector<uint8_t>& data, uint64_t atNs) {
+	DW1000SimNode& node   = *_nodes[sender];
+	uint64_t       fctrl  = node.regValue(TX_FCTRL, 0, LEN_TX_FCTRL);
+	uint16_t       length = (uint16_t)data.size()+2;
+
+	std::shared_ptr<DW1000SimFrame> frame = std::make_shared<DW1000SimFrame>();
+	frame->id              = ++_frameId;
+	frame->sender          = sender;
+	frame->data            = data;
+	frame->dataRate        = (fctrl >> 13) & 0x03;
+	frame->prf             = (fctrl >> 16) & 0x03;
+	frame->preambleSymbols = preambleSymbols((fctrl >> 18) & 0x0F);
+	frame->channel         = node.regValue(CHAN_CTRL, 0, 1) & 0x0F;
+	frame->aborted         = false;
+	frame->abortedAt       = 0;
+
+	int64_t preambleSfd;
+	int64_t duration = airtime(frame->dataRate, frame->prf, frame->preambleSymbols, length, &preambleSfd);
+	frame->start   = std::max(_now, nsToTicks(atNs));
+	frame->rmarker = frame->start+preambleSfd;
+	frame->end     = frame->start+duration;
+	transmit(node, frame);
+}
+
+void DW1000Sim::step(const Event& event) {
+	if(event.t > _now) {
+		_now = event.t;
+	}
+	DW1000SimNode& node = *_nodes[event.node];
+	switch(event.kind) {
+		case EVENT_RADIO:
+			node.advanceRadio(event.t);
+			break;
+		case EVENT_LOOP:
+			if(!node._running) {
+				break;
+			}
+			if(node._busyUntil > event.t) {
+				schedule(node._busyUntil, EVENT_LOOP, event.node);
+				break;
+			}
+			runSlice(node, event.t, [&node, this]() {
+				node.consume(nsToTicks(_config.loopCostNs));
+				node.stats.loops++;
+				node._api->loop();
+			});
+			schedule(node._busyUntil+nsToTicks(_config.loopIntervalNs+node.extraLoopNs), EVENT_LOOP, event.node);
+			break;
+		case EVENT_ISR:
+			if(node._busyUntil > event.t) {
+				schedule(node._busyUntil, EVENT_ISR, event.node);
+				break;
+			}
+			node._isrPending = false;
+			if(node._isr != nullptr) {
+				runSlice(node, event.t, [&node]() {
+					node.stats.interrupts++;
+					node._isr();
+				});
+			}
+			break;
+	}
+}
+
+void DW1000Sim::runUntil(uint64_t ns) {
+	int64_t end = nsToTicks(ns);
+	while(!_events.empty() && _events.top().t <= end) {
+		Event event = _events.top();
+		_events.pop();
+		step(event);
+	}
+	if(end > _now) {
+		_now = end;
+	}
+}
+
+void DW1000Sim::runFor(uint64_t ns) {
+	runUntil(nowNs()+ns);
+}
+
+/* ###########################################################################
+ * #### DW1000SimNode: setup and hooks #######################################
+ * ######################################################################### */
+
+DW1000SimNode::DW1000SimNode(DW1000Sim* sim, int index, const std::string& libraryPath)
+	: x(0), y(0), z(0), clockPpm(0), extraLossDb(0), extraLoopNs(0), _sim(sim), _index(index), _handle(nullptr), _api(nullptr),
+	  _running(false), _inSlice(false), _sliceStart(0), _consumed(0), _busyUntil(0), _isr(nullptr),
+	  _isrPending(false), _pinRst(0xFF), _pinSs(0xFF), _pinIrq(0xFF), _spiClock(1000000), _spiIdle(0),
+	  _spiSelected(false), _spiHeaderLen(0), _spiWrite(false), _spiReg(0), _spiOffset(0), _spiIndex(0),
+	  _clockOffset(0), _irqLine(false), _state(RADIO_IDLE), _rxSince(0), _rxDoneAt(-1), _rxAfterTx(false),
+	  _lockedId(0), _hostBuffer(0), _icBuffer(0), _rxStalled(false), _radioTime(0) {
+	memset(&stats, 0, sizeof(stats));
+	_seed        = sim->random();
+	_clockOffset = ((int64_t)sim->random() << 8) & SIM_TIME_MASK;
+
+	// dlopen() returns the already loaded object for the same path, so every
+	// node gets its own copy of the library file
+	char path[] = "/tmp/dw1000node-XXXXXX";
+	int  out    = mkstemp(path);
+	int  in     = open(libraryPath.c_str(), O_RDONLY);
+	if(out < 0 || in < 0) {
+		throw std::runtime_error("cannot copy node library " + libraryPath);
+	}
+	char    buffer[65536];
+	ssize_t n;
+	while((n = read(in, buffer, sizeof(buffer))) > 0) {
+		if(write(out, buffer, n) != n) {
+			throw std::runtime_error("cannot copy node library " + libraryPath);
+		}
+	}
+	close(in);
+	close(out);
+	_libraryCopy = path;
+	_handle      = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	unlink(path);
+	if(_handle == nullptr) {
+		throw std::runtime_error(std::string("cannot load node library: ") + dlerror());
+	}
+	DW1000SimNodeApiEntry entry = (DW1000SimNodeApiEntry)dlsym(_handle, DW1000_SIM_NODE_API_SYMBOL);
+	if(entry == nullptr) {
+		throw std::runtime_error("node library has no " DW1000_SIM_NODE_API_SYMBOL);
+	}
+	_api = entry();
+
+	_hooks.ctx                 = this;
+	_hooks.nowNs               = hookNowNs;
+	_hooks.consumeNs           = hookConsumeNs;
+	_hooks.digitalWrite        = hookDigitalWrite;
+	_hooks.analogRead          = hookAnalogRead;
+	_hooks.attachInterrupt     = hookAttachInterrupt;
+	_hooks.spiBeginTransaction = hookSpiBeginTransaction;
+	_hooks.spiTransfer         = hookSpiTransfer;
+	_hooks.spiTransferBytes    = hookSpiTransferBytes;
+	_hooks.spiEndTransaction   = hookSpiEndTransaction;
+	_hooks.spiQueueWrite       = hookSpiQueueWrite;
+	_hooks.spiIdleNs           = hookSpiIdleNs;
+	_hooks.print               = hookPrint;
+	_api->bind(&_hooks);
+
+	resetChip();
+}
+
+DW1000SimNode::~DW1000SimNode() {
+	if(_handle != nullptr) {
+		dlclose(_handle);
+	}
+}
+
+uint64_t DW1000SimNode::hookNowNs(void* ctx) {
+	return DW1000Sim::ticksToNs(((DW1000SimNode*)ctx)->nowTicks());
+}
+
+void DW1000SimNode::hookConsumeNs(void* ctx, uint64_t ns) {
+	((DW1000SimNode*)ctx)->consume(DW1000Sim::nsToTicks(ns));
+}
+
+void DW1000SimNode::hookDigitalWrite(void* ctx, uint8_t pin, uint8_t val) {
+	DW1000SimNode* node = (DW1000SimNode*)ctx;
+	if(pin == node->_pinSs) {
+		if(val == 0) {
+			node->spiSelect();
+		}
+		else {
+			node->spiDeselect();
+		}
+	}
+	else if(pin == node->_pinRst && val == 0) {
+		node->resetChip();
+	}
+}
+
+int DW1000SimNode::hookAnalogRead(void* ctx, uint8_t pin) {
+	(void)pin;
+	// floating pin noise, used by the library as random seed
+	return (int)(((DW1000SimNode*)ctx)->_seed & 0x3FF)+1;
+}
+
+void DW1000SimNode::hookAttachInterrupt(void* ctx, uint8_t pin, void (*isr)(void)) {
+	DW1000SimNode* node = (DW1000SimNode*)ctx;
+	node->_pinIrq = pin;
+	node->_isr    = isr;
+}
+
+void DW1000SimNode::hookSpiBeginTransaction(void* ctx, uint32_t clockHz) {
+	DW1000SimNode* node = (DW1000SimNode*)ctx;
+	node->waitSpiIdle();
+	node->_spiClock = clockHz ? clockHz : 1000000;
+	node->consume(DW1000Sim::nsToTicks(node->_sim->_config.spiTransactionOverheadNs/2));
+}
+
+uint8_t DW1000SimNode::hookSpiTransfer(void* ctx, uint8_t out) {
+	DW1000SimNode* node = (DW1000SimNode*)ctx;
+	node->consume(DW1000Sim::nsToTicks(8000000000ULL/node->_spiClock+node->_sim->_config.spiByteOverheadNs));
+	node->stats.spiBytes++;
+	return node->_spiSelected ? node->spiByte(out) : 0;
+}
+
+void DW1000SimNode::hookSpiTransferBytes(void* ctx, uint8_t* buf, uint32_t count) {
+	DW1000SimNode* node = (DW1000SimNode*)ctx;
+	node->consume(DW1000Sim::nsToTicks(8000000000ULL*count/node->_spiClock+node->_sim->_config.spiByteOverheadNs));
+	node->stats.spiBytes += count;
+	for(uint32_t i = 0; i < count; i++) {
+		buf[i] = node->_spiSelected ? node->spiByte(buf[i]) : 0;
+	}
+}
+
+void DW1000SimNode::hookSpiEndTransaction(void* ctx) {
+	DW1000SimNode* node = (DW1000SimNode*)ctx;
+	node->consume(DW1000Sim::nsToTicks(node->_sim->_config.spiTransactionOverheadNs/2));
+	node->stats.spiTransactions++;
+}
+
+void DW1000SimNode::hookSpiQueueWrite(void* ctx, uint32_t clockHz, const uint8_t* out, uint32_t count) {
+	DW1000SimNode* node = (DW1000SimNode*)ctx;
+	node->consume(DW1000Sim::nsToTicks(node->_sim->_config.spiTransactionOverheadNs));
+	int64_t start = std::max(node->nowTicks(), node->_spiIdle);
+	int64_t end   = start+DW1000Sim::nsToTicks(8000000000ULL*count/(clockHz ? clockHz : 1000000));
+	// the chip sees the write when it is through, the CPU goes on meanwhile
+	int64_t consumed = node->_consumed;
+	node->_consumed  = end-node->_sliceStart;
+	node->spiSelect();
+	for(uint32_t i = 0; i < count; i++) {
+		node->spiByte(out[i]);
+	}
+	node->spiDeselect();
+	node->_consumed = consumed;
+	node->_spiIdle  = end;
+	node->stats.spiBytes += count;
+	node->stats.spiTransactions++;
+}
+
+uint64_t DW1000SimNode::hookSpiIdleNs(void* ctx) {
+	return DW1000Sim::ticksToNs(((DW1000SimNode*)ctx)->_spiIdle);
+}
+
+void DW1000SimNode::hookPrint(void* ctx, const char* text, uint32_t len) {
+	DW1000SimNode* node = (DW1000SimNode*)ctx;
+	if(node->_sim->_config.verbose) {
+		printf("[%d] %.*s", node->_index, (int)len, text);
+	}
+}
+
+void DW1000SimNode::consume(int64_t ticks) {
+	_consumed += ticks;
+}
+
+void DW1000SimNode::waitSpiIdle() {
+	if(_spiIdle > nowTicks()) {
+		consume(_spiIdle-nowTicks());
+	}
+}
+
+int64_t DW1000SimNode::nowTicks() const {
+	return _inSlice ? _sliceStart+_consumed : _sim->_now;
+}
+
+uint64_t DW1000SimNode::localTime(int64_t t) const {
+	int64_t drift = (int64_t)llroundl((long double)t*clockPpm*1e-6L);
+	return (uint64_t)(_clockOffset+t+drift) & SIM_TIME_MASK;
+}
+
+int64_t DW1000SimNode::globalTime(uint64_t local, int64_t reference) const {
+	uint64_t delta = (local-localTime(reference)) & SIM_TIME_MASK;
+	if(delta >= (SIM_TIME_MASK >> 1)) {
+		// more than half a period ahead means it already passed
+		return -1;
+	}
+	return reference+(int64_t)llroundl((long double)delta/(1.0L+clockPpm*1e-6L));
+}
+
+void DW1000SimNode::exec(const std::function<void(const DW1000SimNodeApi*)>& call) {
+	int64_t start = std::max(_sim->_now, _busyUntil);
+	_sim->runSlice(*this, start, [this, &call]() { call(_api); });
+}
+
+void DW1000SimNode::initCommunication(uint8_t rst, uint8_t ss, uint8_t irq) {
+	_pinRst = rst;
+	_pinSs  = ss;
+	_pinIrq = irq;
+	exec([=](const DW1000SimNodeApi* api) { api->initCommunication(rst, ss, irq); });
+}
+
+void DW1000SimNode::startAsTag(const char* address, const uint8_t mode[], bool randomShortAddress) {
+	std::string copy(address);
+	exec([&](const DW1000SimNodeApi* api) { api->startAsTag(&copy[0], mode, randomShortAddress); });
+	setRunning(true);
+}
+
+void DW1000SimNode::startAsAnchor(const char* address, const uint8_t mode[], bool randomShortAddress) {
+	std::string copy(address);
+	exec([&](const DW1000SimNodeApi* api) { api->startAsAnchor(&copy[0], mode, randomShortAddress); });
+	setRunning(true);
+}
+
+uint16_t DW1000SimNode::shortAddress() {
+	return _api->getCurrentShortAddress();
+}
+
+void DW1000SimNode::setRunning(bool running) {
+	if(running && !_running) {
+		_sim->schedule(std::max(_sim->_now, _busyUntil), DW1000Sim::EVENT_LOOP, _index);
+	}
+	_running = running;
+}
+
+/* ###########################################################################
+ * #### DW1000SimNode: register file #########################################
+ * ######################################################################### */
+
+uint8_t* DW1000SimNode::reg(uint8_t id, uint16_t offset, uint16_t len) {
+	std::vector<uint8_t>& r = _regs[id & 0x3F];
+	if(r.size() < (size_t)offset+len) {
+		r.resize((size_t)offset+len, 0);
+	}
+	return &r[offset];
+}
+
+uint64_t DW1000SimNode::regValue(uint8_t id, uint16_t offset, uint8_t len) {
+	uint8_t* bytes = reg(id, offset, len);
+	uint64_t value = 0;
+	for(int i = len-1; i >= 0; i--) {
+		value = (value << 8) | bytes[i];
+	}
+	return value;
+}
+
+void DW1000SimNode::setRegValue(uint8_t id, uint16_t offset, uint8_t len, uint64_t value) {
+	uint8_t* bytes = reg(id, offset, len);
+	for(uint8_t i = 0; i < len; i++) {
+		bytes[i] = (uint8_t)(value >> (8*i));
+	}
+}
+
+bool DW1000SimNode::statusBit(uint8_t bit) {
+	return (regValue(SYS_STATUS, 0, LEN_SYS_STATUS) >> bit) & 1;
+}
+
+void DW1000SimNode::setStatusBits(uint64_t bits, int64_t t) {
+	setRegValue(SYS_STATUS, 0, LEN_SYS_STATUS, regValue(SYS_STATUS, 0, LEN_SYS_STATUS) | bits);
+	updateIrq(t);
+}
+
+void DW1000SimNode::resetChip() {
+	for(auto& r : _regs) {
+		r.clear();
+	}
+	setRegValue(DEV_ID, 0, LEN_DEV_ID, 0xDECA0130);
+	if(_pendingTx) {
+		_pendingTx->aborted   = true;
+		_pendingTx->abortedAt = nowTicks();
+		_pendingTx.reset();
+	}
+	_state     = RADIO_IDLE;
+	_rxDoneAt  = -1;
+	_rxAfterTx = false;
+	_lockedId  = 0;
+	_irqLine   = false;
+	for(RxBufferSet& set : _rxSets) {
+		set.full   = false;
+		set.events = 0;
+	}
+	_hostBuffer = 0;
+	_icBuffer   = 0;
+	_rxStalled  = false;
+}
+
+/* ###########################################################################
+ * #### DW1000SimNode: SPI slave #############################################
+ * ######################################################################### */
+
+void DW1000SimNode::spiSelect() {
+	advanceRadio(nowTicks());
+	_spiSelected  = true;
+	_spiHeaderLen = 0;
+	_spiIndex     = 0;
+	_spiData.clear();
+}
+
+void DW1000SimNode::spiDeselect() {
+	if(!_spiSelected) {
+		return;
+	}
+	_spiSelected = false;
+	if(_spiWrite && !_spiData.empty()) {
+		advanceRadio(nowTicks());
+		commitWrite(_spiReg, _spiOffset, _spiData);
+	}
+}
+
+uint8_t DW1000SimNode::spiByte(uint8_t out) {
+	if(_spiHeaderLen < 3) {
+		// header: [R/W | sub-index | reg], [ext | offset low 7], [offset high 8]
+		bool complete = false;
+		_spiHeader[_spiHeaderLen++] = out;
+		if(_spiHeaderLen == 1) {
+			_spiWrite  = out & 0x80;
+			_spiReg    = out & 0x3F;
+			_spiOffset = 0;
+			complete   = !(out & 0x40);
+		}
+		else if(_spiHeaderLen == 2) {
+			_spiOffset = out & 0x7F;
+			complete   = !(out & 0x80);
+		}
+		else {
+			_spiOffset |= (uint16_t)out << 7;
+			complete    = true;
+		}
+		if(complete) {
+			_spiHeaderLen = 3;
+			if(!_spiWrite) {
+				advanceRadio(nowTicks());
+				prepareRead(_spiReg);
+			}
+		}
+		return 0;
+	}
+	if(_spiWrite) {
+		_spiData.push_back(out);
+		return 0;
+	}
+	return *reg(_spiReg, _spiOffset+_spiIndex++, 1);
+}
+
+void DW1000SimNode::prepareRead(uint8_t id) {
+	if(id == SYS_TIME) {
+		// the system counter runs with the low 9 bits always zero
+		setRegValue(SYS_TIME, 0, LEN_SYS_TIME, localTime(nowTicks()) & ~0x1FFULL);
+	}
+}
+
+void DW1000SimNode::commitWrite(uint8_t id, uint16_t offset, const std::vector<uint8_t>& bytes) {
+	int64_t t = nowTicks();
+	if(id == SYS_STATUS) {
+		// latched bits are cleared by writing 1
+		uint8_t* status = reg(SYS_STATUS, 0, LEN_SYS_STATUS);
+		for(size_t i = 0; i < bytes.size() && offset+i < LEN_SYS_STATUS; i++) {
+			status[offset+i] &= ~bytes[i];
+		}
+		// the events of the host side buffer are the ones cleared
+		_rxSets[_hostBuffer].events &= regValue(SYS_STATUS, 0, LEN_SYS_STATUS);
+		updateBufferPointers();
+		updateIrq(t);
+		return;
+	}
+	memcpy(reg(id, offset, (uint16_t)bytes.size()), bytes.data(), bytes.size());
+	if(id == SYS_CTRL) {
+		uint32_t sysctrl = (uint32_t)regValue(SYS_CTRL, 0, LEN_SYS_CTRL);
+		// command bits are self clearing
+		setRegValue(SYS_CTRL, 0, LEN_SYS_CTRL, 0);
+		systemControl(sysctrl);
+	}
+	else if(id == SYS_MASK) {
+		updateIrq(t);
+	}
+}
+
+bool DW1000SimNode::doubleBuffered() {
+	return !((regValue(SYS_CFG, 0, LEN_SYS_CFG) >> DIS_DRXB_BIT) & 1);
+}
+
+static const uint8_t RX_SET_REGS[4] = { RX_FINFO, RX_BUFFER, RX_FQUAL, RX_TIME };
+
+void DW1000SimNode::saveRxSet(RxBufferSet& set) {
+	for(int i = 0; i < 4; i++) {
+		set.regs[i] = _regs[RX_SET_REGS[i]];
+	}
+}
+
+void DW1000SimNode::loadRxSet(const RxBufferSet& set) {
+	for(int i = 0; i < 4; i++) {
+		_regs[RX_SET_REGS[i]] = set.regs[i];
+	}
+}
+
+void DW1000SimNode::receiveIntoBuffer(const Arrival& arrival, uint64_t events, int64_t t) {
+	RxBufferSet& set = _rxSets[_icBuffer];
+	if(_icBuffer == _hostBuffer) {
+		deliver(arrival);
+		saveRxSet(set);
+	}
+	else {
+		// the host is still on the other buffer
+		RxBufferSet visible;
+		saveRxSet(visible);
+		deliver(arrival);
+		saveRxSet(set);
+		loadRxSet(visible);
+	}
+	set.full   = true;
+	set.events = events;
+	bool hostSide = _icBuffer == _hostBuffer;
+	if(_rxSets[_icBuffer ^ 1].full) {
+		_state     = RADIO_IDLE;
+		_rxStalled = true;
+		_rxDoneAt  = t;
+	}
+	else {
+		_icBuffer ^= 1;
+		if(!((regValue(SYS_CFG, 0, LEN_SYS_CFG) >> RXAUTR_BIT) & 1)) {
+			_state    = RADIO_IDLE;
+			_rxDoneAt = t;
+		}
+	}
+	updateBufferPointers();
+	if(hostSide) {
+		setStatusBits(events, t);
+	}
+}
+
+void DW1000SimNode::toggleHostBuffer(int64_t t) {
+	const uint64_t rxEvents = (1ULL << SIM_RXPRD_BIT) | (1ULL << SIM_RXSFDD_BIT) | (1ULL << LDEDONE_BIT) |
+	                          (1ULL << SIM_RXPHD_BIT) | (1ULL << RXDFR_BIT) | (1ULL << RXFCG_BIT);
+	RxBufferSet& done = _rxSets[_hostBuffer];
+	done.full   = false;
+	done.events = 0;
+	_hostBuffer ^= 1;
+	loadRxSet(_rxSets[_hostBuffer]);
+	uint64_t status = regValue(SYS_STATUS, 0, LEN_SYS_STATUS) & ~rxEvents;
+	setRegValue(SYS_STATUS, 0, LEN_SYS_STATUS, status | _rxSets[_hostBuffer].events);
+	if(_rxStalled) {
+		// receives into the buffer just handed back
+		_rxStalled = false;
+		_icBuffer  = _hostBuffer ^ 1;
+		receiverOn(t);
+	}
+	updateBufferPointers();
+	updateIrq(t);
+}
+
+void DW1000SimNode::updateBufferPointers() {
+	uint64_t status = regValue(SYS_STATUS, 0, LEN_SYS_STATUS) & ~((1ULL << HSRBP_BIT) | (1ULL << ICRBP_BIT));
+	status |= ((uint64_t)_hostBuffer << HSRBP_BIT) | ((uint64_t)_icBuffer << ICRBP_BIT);
+	setRegValue(SYS_STATUS, 0, LEN_SYS_STATUS, status);
+}
+
+void DW1000SimNode::systemControl(uint32_t sysctrl) {
+	int64_t t = nowTicks();
+	if(sysctrl & (1UL << HRBPT_BIT)) {
+		toggleHostBuffer(t);
+	}
+	if(sysctrl & (1UL << TRXOFF_BIT)) {
+		goIdle(t);
+	}
+	if(sysctrl & (1UL << TXSTRT_BIT)) {
+		startTransmit(t, sysctrl & (1UL << TXDLYS_BIT));
+	}
+	if(sysctrl & (1UL << RXENAB_BIT)) {
+		enableReceiver(t);
+	}
+}
+
+/* ###########################################################################
+ * #### DW1000SimNode: transceiver ###########################################
+ * ######################################################################### */
+
+void DW1000SimNode::pushRadioEvent(int64_t t, int kind, const std::shared_ptr<DW1000SimFrame>& frame, double powerDbm) {
+	RadioEvent event;
+	event.t        = t;
+	event.seq      = _sim->_seq++;
+	event.kind     = kind;
+	event.frame    = frame;
+	event.powerDbm = powerDbm;
+	_radioEvents.push(event);
+	_sim->schedule(t, DW1000Sim::EVENT_RADIO, _index);
+}
+
+void DW1000SimNode::advanceRadio(int64_t t) {
+	while(!_radioEvents.empty() && _radioEvents.top().t <= t) {
+		RadioEvent event = _radioEvents.top();
+		_radioEvents.pop();
+		handleRadioEvent(event);
+	}
+	if(t > _radioTime) {
+		_radioTime = t;
+	}
+}
+
+void DW1000SimNode::handleRadioEvent(const RadioEvent& event) {
+	if(event.t > _radioTime) {
+		_radioTime = event.t;
+	}
+	switch(event.kind) {
+		case RADIO_TX_START:
+			if(_pendingTx == event.frame) {
+				_state = RADIO_TX;
+			}
+			break;
+		case RADIO_TX_DONE:
+			if(_pendingTx == event.frame) {
+				DW1000SimFrame& frame = *event.frame;
+				uint64_t stamp = localTime(frame.rmarker);
+				setRegValue(TX_TIME, TX_STAMP_SUB, LEN_TX_STAMP, stamp);
+				setRegValue(TX_TIME, TX_STAMP_SUB+LEN_TX_STAMP, LEN_TX_STAMP, stamp & ~0x1FFULL);
+				_pendingTx.reset();
+				stats.framesSent++;
+				if(_rxAfterTx) {
+					_rxAfterTx = false;
+					receiverOn(event.t+DW1000Sim::nsToTicks(_sim->_config.rxTurnaroundNs));
+				}
+				else {
+					_state = RADIO_IDLE;
+				}
+				setStatusBits((1ULL << TXFRB_BIT) | (1ULL << TXPRS_BIT) | (1ULL << TXPHS_BIT) | (1ULL << TXFRS_BIT), event.t);
+			}
+			break;
+		case RADIO_RX_START:
+			receiveStart(event);
+			break;
+		case RADIO_RX_END:
+			receiveEnd(event);
+			break;
+	}
+}
+
+void DW1000SimNode::goIdle(int64_t t) {
+	if(_pendingTx) {
+		_pendingTx->aborted   = true;
+		_pendingTx->abortedAt = t;
+		_pendingTx.reset();
+	}
+	if(_state == RADIO_RX && _lockedId != 0) {
+		stats.framesAborted++;
+	}
+	_lockedId  = 0;
+	_rxAfterTx = false;
+	_rxStalled = false;
+	_state     = RADIO_IDLE;
+}
+
+void DW1000SimNode::startTransmit(int64_t t, bool delayed) {
+	if(_state == RADIO_TX_WAIT || _state == RADIO_TX || _state == RADIO_TX_LATE) {
+		return;
+	}
+	if(_state == RADIO_RX) {
+		goIdle(t);
+	}
+	uint64_t fctrl  = regValue(TX_FCTRL, 0, LEN_TX_FCTRL);
+	uint16_t length = fctrl & 0x3FF;
+	_rxDoneAt = -1;
+
+	std::shared_ptr<DW1000SimFrame> frame = std::make_shared<DW1000SimFrame>();
+	frame->id              = ++_sim->_frameId;
+	frame->sender          = _index;
+	frame->dataRate        = (fctrl >> 13) & 0x03;
+	frame->prf             = (fctrl >> 16) & 0x03;
+	frame->preambleSymbols = preambleSymbols((fctrl >> 18) & 0x0F);
+	frame->channel         = regValue(CHAN_CTRL, 0, 1) & 0x0F;
+	frame->aborted         = false;
+	frame->abortedAt       = 0;
+	if(length > 2) {
+		uint8_t* payload = reg(TX_BUFFER, 0, length-2);
+		frame->data.assign(payload, payload+length-2);
+	}
+
+	int64_t preambleSfd;
+	int64_t duration = DW1000Sim::airtime(frame->dataRate, frame->prf, frame->preambleSymbols, length, &preambleSfd);
+	int64_t rmarker;
+	if(delayed) {
+		// RMARKER leaves at DX_TIME (low 9 bits ignored) plus the TX antenna delay
+		uint64_t dx      = regValue(DX_TIME, 0, LEN_DX_TIME) & ~0x1FFULL;
+		uint64_t antenna = regValue(TX_ANTD, 0, LEN_TX_ANTD);
+		rmarker = globalTime((dx+antenna) & SIM_TIME_MASK, t);
+		if(rmarker < 0 || rmarker-preambleSfd < t) {
+			// too late, the chip would wait for the next counter wrap (~17 s)
+			_state = RADIO_TX_LATE;
+			stats.framesLate++;
+			setStatusBits(1ULL << SIM_HPDWARN_BIT, t);
+			return;
+		}
+	}
+	else {
+		rmarker = t+DW1000Sim::nsToTicks(_sim->_config.txStartupNs)+preambleSfd;
+	}
+	frame->rmarker = rmarker;
+	frame->start   = rmarker-preambleSfd;
+	frame->end     = frame->start+duration;
+
+	_state     = RADIO_TX_WAIT;
+	_pendingTx = frame;
+	pushRadioEvent(frame->start, RADIO_TX_START, frame);
+	pushRadioEvent(frame->end, RADIO_TX_DONE, frame);
+	_sim->transmit(*this, frame);
+}
+
+void DW1000SimNode::enableReceiver(int64_t t) {
+	if(_state == RADIO_TX_WAIT || _state == RADIO_TX || _state == RADIO_TX_LATE) {
+		// receiver turns on once the frame is out
+		_rxAfterTx = true;
+		return;
+	}
+	if(_state == RADIO_RX) {
+		return;
+	}
+	receiverOn(t);
+}
+
+void DW1000SimNode::receiverOn(int64_t t) {
+	if(_rxStalled) {
+		// double buffered, no buffer to receive into
+		_state = RADIO_IDLE;
+		return;
+	}
+	if(_rxDoneAt >= 0) {
+		uint64_t ns = DW1000Sim::ticksToNs(t-_rxDoneAt);
+		stats.rxRearms++;
+		stats.rxRearmNs += ns;
+		stats.rxRearmMaxNs = std::max(stats.rxRearmMaxNs, ns);
+		_rxDoneAt = -1;
+	}
+	_state    = RADIO_RX;
+	_rxSince  = t;
+	_lockedId = 0;
+	// a frame already on the air is acquired while enough of its preamble is left
+	for(Arrival& arrival : _arrivals) {
+		if(arrival.missed && t <= arrival.start+(arrival.rmarker-arrival.start)/2) {
+			arrival.missed = false;
+			_lockedId      = arrival.frame->id;
+			stats.framesMissed--;
+			break;
+		}
+	}
+}
+
+void DW1000SimNode::receiveStart(const RadioEvent& event) {
+	const DW1000SimFrame& frame = *event.frame;
+	if(frame.aborted && frame.abortedAt <= frame.start) {
+		return;
+	}
+	Arrival arrival;
+	arrival.frame     = event.frame;
+	arrival.start     = event.t;
+	arrival.rmarker   = event.t+(frame.rmarker-frame.start);
+	arrival.end       = event.t+(frame.end-frame.start);
+	arrival.powerDbm  = event.powerDbm;
+	arrival.corrupted = false;
+	arrival.missed    = false;
+
+	// overlapping frames disturb each other unless one is captureDb stronger
+	double capture = _sim->_config.captureDb;
+	for(Arrival& other : _arrivals) {
+		if(other.powerDbm > arrival.powerDbm-capture) {
+			arrival.corrupted = true;
+		}
+		if(arrival.powerDbm > other.powerDbm-capture) {
+			other.corrupted = true;
+		}
+	}
+
+	uint8_t  channel     = (regValue(CHAN_CTRL, 0, 1) >> 4) & 0x0F;
+	uint8_t  prf         = (regValue(CHAN_CTRL, 2, 1) >> 2) & 0x03;
+	bool     rx110k      = (regValue(SYS_CFG, 0, LEN_SYS_CFG) >> RXM110K_BIT) & 1;
+	double   sensitivity = _sim->_config.sensitivityDbm[frame.dataRate > 2 ? 2 : frame.dataRate];
+	bool     decodable   = frame.channel == channel && frame.prf == prf &&
+	                       rx110k == (frame.dataRate == SIM_RATE_110KBPS) && arrival.powerDbm >= sensitivity;
+	if(decodable) {
+		// the receiver needs to see a good part of the preamble to acquire
+		bool listening = _state == RADIO_RX && _rxSince <= arrival.start+(arrival.rmarker-arrival.start)/2;
+		if(listening && _lockedId == 0) {
+			_lockedId = frame.id;
+		}
+		else if(_lockedId != 0) {
+			stats.framesCollided++;
+		}
+		else {
+			stats.framesMissed++;
+			arrival.missed = true;
+		}
+	}
+	_arrivals.push_back(arrival);
+}
+
+void DW1000SimNode::receiveEnd(const RadioEvent& event) {
+	const DW1000SimFrame& frame = *event.frame;
+	auto it = std::find_if(_arrivals.begin(), _arrivals.end(),
+	                       [&frame](const Arrival& a) { return a.frame->id == frame.id; });
+	if(it == _arrivals.end()) {
+		return;
+	}
+	Arrival arrival = *it;
+	_arrivals.erase(it);
+	if(_lockedId != frame.id) {
+		return;
+	}
+	_lockedId = 0;
+	if(arrival.corrupted || (frame.aborted && frame.abortedAt < frame.end)) {
+		stats.framesCollided++;
+		bool autoReenable = (regValue(SYS_CFG, 0, LEN_SYS_CFG) >> RXAUTR_BIT) & 1;
+		if(!autoReenable) {
+			_state    = RADIO_IDLE;
+			_rxDoneAt = event.t;
+		}
+		setStatusBits((1ULL << SIM_RXPRD_BIT) | (1ULL << SIM_RXSFDD_BIT) | (1ULL << RXFCE_BIT), event.t);
+		return;
+	}
+	stats.framesReceived++;
+	uint64_t events = (1ULL << SIM_RXPRD_BIT) | (1ULL << SIM_RXSFDD_BIT) | (1ULL << LDEDONE_BIT) |
+	                  (1ULL << SIM_RXPHD_BIT) | (1ULL << RXDFR_BIT) | (1ULL << RXFCG_BIT);
+	if(doubleBuffered()) {
+		receiveIntoBuffer(arrival, events, event.t);
+		return;
+	}
+	_state    = RADIO_IDLE;
+	_rxDoneAt = event.t;
+	deliver(arrival);
+	setStatusBits(events, event.t);
+}
+
+void DW1000SimNode::deliver(const Arrival& arrival) {
+	const DW1000SimFrame& frame = *arrival.frame;
+	uint16_t length = (uint16_t)frame.data.size()+2;
+	if(!frame.data.empty()) {
+		memcpy(reg(RX_BUFFER, 0, (uint16_t)frame.data.size()), frame.data.data(), frame.data.size());
+	}
+
+	// accumulated preamble symbols, a bit less than sent
+	uint16_t N = (uint16_t)std::min(4095, frame.preambleSymbols*15/16);
+	uint32_t finfo = (length & 0x3FF) | ((uint32_t)frame.dataRate << 13) | ((uint32_t)frame.prf << 16) |
+	                 ((uint32_t)N << 20);
+	setRegValue(RX_FINFO, 0, LEN_RX_FINFO, finfo);
+
+	// the chip reports the first path late (or early) depending on the signal level,
+	// DW1000Class::correctTimestamp() takes this out again
+	uint8_t  channel = (regValue(CHAN_CTRL, 0, 1) >> 4) & 0x0F;
+	uint64_t stamp   = (localTime(arrival.rmarker)+rangeBiasTicks(arrival.powerDbm, channel, frame.prf)) & SIM_TIME_MASK;
+	setRegValue(RX_TIME, RX_STAMP_SUB, LEN_RX_STAMP, stamp);
+	setRegValue(RX_TIME, 5, 2, 750 << 6); // FP_INDEX
+	setRegValue(RX_TIME, 9, LEN_RX_STAMP, stamp & ~0x1FFULL); // RX_RAWST
+
+	// invert the user manual 4.7 power estimates used by getReceivePower()/getFirstPathPower()
+	bool   prf64   = frame.prf == SIM_PRF_64MHZ;
+	double A       = prf64 ? 121.74 : 113.77;
+	double corrFac = prf64 ? 1.1667 : 2.3334;
+	auto raw = [corrFac](double dbm) { return dbm <= -88.0 ? dbm : (dbm-88.0*corrFac)/(1.0+corrFac); };
+	double n2  = (double)N*N;
+	double cir = n2*pow(10.0, (raw(arrival.powerDbm)+A)/10.0)/131072.0;
+	double fp  = sqrt(n2*pow(10.0, (raw(arrival.powerDbm-1.5)+A)/10.0)/3.0);
+	uint16_t C  = (uint16_t)std::max(1.0, std::min(65535.0, cir));
+	uint16_t F  = (uint16_t)std::max(1.0, std::min(65535.0, fp));
+	setRegValue(RX_TIME, FP_AMPL1_SUB, LEN_FP_AMPL1, F);
+	setRegValue(RX_FQUAL, STD_NOISE_SUB, LEN_STD_NOISE, 40);
+	setRegValue(RX_FQUAL, FP_AMPL2_SUB, LEN_FP_AMPL2, F);
+	setRegValue(RX_FQUAL, FP_AMPL3_SUB, LEN_FP_AMPL3, F);
+	setRegValue(RX_FQUAL, CIR_PWR_SUB, LEN_CIR_PWR, C);
+
+	// carrier integrator: the sender's clock relative to ours, negative if it
+	// runs faster, carrierInt/(k*2^27) with the channel frequency 499.2 MHz*k
+	// (2^30 at 110 kb/s), see DW1000Class::toLocalClock()
+	const DW1000SimNode& sender = _sim->node(frame.sender);
+	double   offset = (1.0+sender.clockPpm*1e-6)/(1.0+clockPpm*1e-6)-1.0;
+	int      k      = channel == 1 ? 7 : channel == 3 ? 9 : (channel == 5 || channel == 7) ? 13 : 8;
+	double   scale  = ldexp((double)k, frame.dataRate == SIM_RATE_110KBPS ? 30 : 27);
+	int32_t  carrierInt = (int32_t)std::max(-1048576.0, std::min(1048575.0, round(-offset*scale)));
+	setRegValue(DRX_TUNE, DRX_CAR_INT_SUB, LEN_DRX_CAR_INT, (uint32_t)carrierInt & 0x1FFFFF);
+}
+
+void DW1000SimNode::updateIrq(int64_t t) {
+	uint32_t status = (uint32_t)regValue(SYS_STATUS, 0, 4);
+	uint32_t mask   = (uint32_t)regValue(SYS_MASK, 0, LEN_SYS_MASK);
+	bool     line   = (status & mask) != 0;
+	if(line && !_irqLine && _isr != nullptr && !_isrPending) {
+		// rising edge
+		_isrPending = true;
+		_sim->schedule(t+DW1000Sim::nsToTicks(_sim->_config.isrLatencyNs), DW1000Sim::EVENT_ISR, _index);
+	}
+	_irqLine = line;
+}
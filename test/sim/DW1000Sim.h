@@ -0,0 +1,346 @@
+/*
+ * Register-level, discrete-event simulator for the DW1000 library.
+ *
+ * Each DW1000SimNode loads its own copy of the unmodified library (see
+ * DW1000SimNode.h) and drives a model of the transceiver through the same
+ * readBytes()/writeBytes() SPI traffic the real chip sees. The model keeps the
+ * register file, executes SYS_CTRL commands, raises the IRQ line (which calls
+ * the library's handleInterrupt()) and produces TX/RX timestamps from a
+ * per-node 40 bit clock.
+ *
+ * All nodes share one medium: frames are delivered after the propagation
+ * delay of the link, occupy the air for the duration given by their PHY
+ * settings (data rate, PRF, preamble length read back from TX_FCTRL), may
+ * collide at a receiver and are attenuated by a log-distance path loss.
+ *
+ * The global time base is DW1000 ticks (1 / (128 * 499.2 MHz), ~15.65 ps).
+ */
+
+#ifndef _DW1000Sim_H_INCLUDED
+#define _DW1000Sim_H_INCLUDED
+
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "DW1000SimNode.h"
+
+#define DW1000SIM_TICKS_PER_US 63897.6
+#define DW1000SIM_SPEED_OF_LIGHT 299792458.0
+
+struct DW1000SimConfig {
+	uint64_t seed = 1;
+	// node CPU model
+	uint32_t loopIntervalNs   = 100000; // idle time between two loop() calls
+	uint32_t loopCostNs       = 2000;   // fixed cost charged per loop() call
+	uint32_t isrLatencyNs     = 2000;   // IRQ edge to handler entry
+	// SPI bus model, on top of 8 bits per byte at the configured clock
+	uint32_t spiByteOverheadNs        = 1000; // software cost of one SPI.transfer() (byte or bulk)
+	uint32_t spiTransactionOverheadNs = 2000; // beginTransaction()/endTransaction() + CS, or a DMA setup
+	// radio model
+	uint32_t txStartupNs     = 10000;  // TXSTRT to first preamble symbol (immediate send)
+	uint32_t rxTurnaroundNs  = 6000;   // end of TX to receiver on, when RX was requested
+	double   txPowerDbm      = -14.3;
+	double   pathLossExponent = 2.0;
+	double   referenceLossDb = 48.7;   // free space loss at 1 m, channel 5
+	double   sensitivityDbm[3] = { -106.0, -102.0, -94.0 }; // 110k, 850k, 6.8M
+	double   captureDb       = 6.0;    // a frame survives interferers this much weaker
+	double   clockPpmSpread  = 0.0;    // random per node crystal offset, +-ppm
+	bool     verbose         = false;  // echo the nodes' Serial output
+};
+
+struct DW1000SimFrame {
+	uint64_t             id;
+	int                  sender;
+	std::vector<uint8_t> data;     // payload without FCS
+	uint8_t              dataRate; // TRX_RATE_*
+	uint8_t              prf;      // TX_PULSE_FREQ_*
+	uint8_t              channel;
+	uint16_t             preambleSymbols;
+	int64_t              start;    // first preamble symbol leaves the antenna
+	int64_t              rmarker;  // RMARKER (timestamped symbol) leaves the antenna
+	int64_t              end;      // last bit leaves the antenna
+	bool                 aborted;
+	int64_t              abortedAt; // TRXOFF on the sender cut the frame off here
+};
+
+struct DW1000SimNodeStats {
+	uint64_t loops;
+	uint64_t interrupts;
+	uint64_t spiTransactions;
+	uint64_t spiBytes;
+	uint64_t busyNs;           // CPU time spent in loop(), ISR and bus access
+	uint64_t framesSent;
+	uint64_t framesLate;       // delayed TX scheduled in the past (HPDWARN)
+	uint64_t framesReceived;
+	uint64_t framesCollided;   // lost at this receiver because of another frame
+	uint64_t framesMissed;     // arrived while the receiver was off or busy sending
+	uint64_t framesAborted;    // reception cut off by TRXOFF/TX
+	// receiver off after a received frame until the host enabled it again
+	uint64_t rxRearms;
+	uint64_t rxRearmNs;
+	uint64_t rxRearmMaxNs;
+};
+
+// whole medium, frames are counted once when sent, receptions once per receiver
+struct DW1000SimChannelStats {
+	uint64_t framesSent;
+	uint64_t airtimeNs;
+	uint64_t framesReceived;
+	uint64_t framesCollided;
+	uint64_t framesMissed;
+	uint64_t framesLate;
+};
+
+class DW1000Sim;
+
+class DW1000SimNode {
+public:
+	int index() const { return _index; }
+	const DW1000SimNodeApi* api() const { return _api; }
+
+	// environment
+	double x, y, z;
+	double clockPpm;
+	double extraLossDb; // added to every link of this node (obstruction, antenna off)
+	// CPU
+	uint32_t extraLoopNs; // added to the loop interval (a sketch doing more work)
+
+	DW1000SimNodeStats stats;
+
+	// convenience wrappers, executed as CPU time of this node at the current time
+	void initCommunication(uint8_t rst = 27, uint8_t ss = 4, uint8_t irq = 34);
+	void startAsTag(const char* address, const uint8_t mode[], bool randomShortAddress = false);
+	void startAsAnchor(const char* address, const uint8_t mode[], bool randomShortAddress = false);
+	// run arbitrary calls into the node's library as one slice of its CPU time
+	void exec(const std::function<void(const DW1000SimNodeApi*)>& call);
+
+	uint16_t shortAddress();
+	// stop calling loop() (e.g. to model a powered off device)
+	void setRunning(bool running);
+	bool running() const { return _running; }
+
+	// local clock of this node's transceiver at global tick t (40 bit)
+	uint64_t localTime(int64_t t) const;
+	int64_t  nowTicks() const;
+
+private:
+	friend class DW1000Sim;
+	DW1000SimNode(DW1000Sim* sim, int index, const std::string& libraryPath);
+	~DW1000SimNode();
+	DW1000SimNode(const DW1000SimNode&) = delete;
+	DW1000SimNode& operator=(const DW1000SimNode&) = delete;
+
+	enum RadioState { RADIO_IDLE, RADIO_RX, RADIO_TX_WAIT, RADIO_TX, RADIO_TX_LATE };
+
+	enum RadioEventKind { RADIO_TX_START, RADIO_TX_DONE, RADIO_RX_START, RADIO_RX_END };
+
+	struct RadioEvent {
+		int64_t  t;
+		uint64_t seq;
+		int      kind;
+		std::shared_ptr<DW1000SimFrame> frame;
+		double   powerDbm;
+		bool operator>(const RadioEvent& other) const { return t != other.t ? t > other.t : seq > other.seq; }
+	};
+
+	struct Arrival {
+		std::shared_ptr<DW1000SimFrame> frame;
+		int64_t start;
+		int64_t rmarker;
+		int64_t end;
+		double  powerDbm;
+		bool    corrupted;
+		bool    missed; // receiver was off when it started
+	};
+
+	// double buffered receive (SYS_CFG DIS_DRXB clear): the RX registers and
+	// the RX events exist twice, the host sees the set HSRBP points at, the
+	// receiver fills the one ICRBP points at and goes on with the other one
+	// while that is free
+	struct RxBufferSet {
+		bool                 full;
+		uint64_t             events;
+		std::vector<uint8_t> regs[4]; // RX_FINFO, RX_BUFFER, RX_FQUAL, RX_TIME
+	};
+
+	// hooks
+	static uint64_t hookNowNs(void* ctx);
+	static void     hookConsumeNs(void* ctx, uint64_t ns);
+	static void     hookDigitalWrite(void* ctx, uint8_t pin, uint8_t val);
+	static int      hookAnalogRead(void* ctx, uint8_t pin);
+	static void     hookAttachInterrupt(void* ctx, uint8_t pin, void (*isr)(void));
+	static void     hookSpiBeginTransaction(void* ctx, uint32_t clockHz);
+	static uint8_t  hookSpiTransfer(void* ctx, uint8_t out);
+	static void     hookSpiTransferBytes(void* ctx, uint8_t* buf, uint32_t count);
+	static void     hookSpiEndTransaction(void* ctx);
+	static void     hookSpiQueueWrite(void* ctx, uint32_t clockHz, const uint8_t* out, uint32_t count);
+	static uint64_t hookSpiIdleNs(void* ctx);
+	static void     hookPrint(void* ctx, const char* text, uint32_t len);
+
+	void consume(int64_t ticks);
+	void waitSpiIdle();
+
+	// register file
+	uint8_t* reg(uint8_t id, uint16_t offset, uint16_t len);
+	uint64_t regValue(uint8_t id, uint16_t offset, uint8_t len);
+	void     setRegValue(uint8_t id, uint16_t offset, uint8_t len, uint64_t value);
+	bool     statusBit(uint8_t bit);
+	void     setStatusBits(uint64_t bits, int64_t t);
+	void     resetChip();
+
+	// SPI slave
+	void    spiSelect();
+	void    spiDeselect();
+	uint8_t spiByte(uint8_t out);
+	void    prepareRead(uint8_t id);
+	void    commitWrite(uint8_t id, uint16_t offset, const std::vector<uint8_t>& bytes);
+	void    systemControl(uint32_t sysctrl);
+	bool    doubleBuffered();
+	void    saveRxSet(RxBufferSet& set);
+	void    loadRxSet(const RxBufferSet& set);
+	void    receiveIntoBuffer(const Arrival& arrival, uint64_t events, int64_t t);
+	void    toggleHostBuffer(int64_t t);
+	void    updateBufferPointers();
+
+	// transceiver
+	void advanceRadio(int64_t t);
+	void pushRadioEvent(int64_t t, int kind, const std::shared_ptr<DW1000SimFrame>& frame, double powerDbm = 0);
+	void handleRadioEvent(const RadioEvent& event);
+	void goIdle(int64_t t);
+	void startTransmit(int64_t t, bool delayed);
+	void enableReceiver(int64_t t);
+	void receiverOn(int64_t t);
+	void receiveStart(const RadioEvent& event);
+	void receiveEnd(const RadioEvent& event);
+	void deliver(const Arrival& arrival);
+	void updateIrq(int64_t t);
+	int64_t globalTime(uint64_t local, int64_t reference) const;
+
+	DW1000Sim*              _sim;
+	int                     _index;
+	std::string             _libraryCopy;
+	void*                   _handle;
+	const DW1000SimNodeApi* _api;
+	DW1000SimHooks          _hooks;
+
+	// CPU timeline
+	bool    _running;
+	bool    _inSlice;
+	int64_t _sliceStart;
+	int64_t _consumed;
+	int64_t _busyUntil;
+	void  (*_isr)(void);
+	bool    _isrPending;
+	uint8_t _pinRst, _pinSs, _pinIrq;
+	uint32_t _seed;
+
+	// SPI slave state
+	uint32_t             _spiClock;
+	int64_t              _spiIdle; // queued writes are through
+	bool                 _spiSelected;
+	uint8_t              _spiHeaderLen;
+	uint8_t              _spiHeader[3];
+	bool                 _spiWrite;
+	uint8_t              _spiReg;
+	uint16_t             _spiOffset;
+	uint16_t             _spiIndex;
+	std::vector<uint8_t> _spiData;
+
+	// chip
+	std::vector<uint8_t> _regs[64];
+	int64_t  _clockOffset;
+	bool     _irqLine;
+	RadioState _state;
+	int64_t  _rxSince;
+	int64_t  _rxDoneAt; // receiver off since this frame end, -1 if on or sent since
+	bool     _rxAfterTx;
+	std::shared_ptr<DW1000SimFrame> _pendingTx;
+	std::vector<Arrival> _arrivals;
+	uint64_t _lockedId; // frame the receiver is synchronised to, 0 if none
+	RxBufferSet _rxSets[2];
+	uint8_t  _hostBuffer; // HSRBP
+	uint8_t  _icBuffer;   // ICRBP
+	bool     _rxStalled;  // both buffers full, receiver off until one is handed back
+	int64_t  _radioTime;
+	std::priority_queue<RadioEvent, std::vector<RadioEvent>, std::greater<RadioEvent> > _radioEvents;
+};
+
+class DW1000Sim {
+public:
+	explicit DW1000Sim(const DW1000SimConfig& config = DW1000SimConfig(), const char* libraryPath = nullptr);
+	~DW1000Sim();
+
+	// libraryPath: node library to load instead of the simulator's default one
+	DW1000SimNode& addNode(double x, double y, double z = 0.0, const char* libraryPath = nullptr);
+	DW1000SimNode& node(int index) { return *_nodes[index]; }
+	int nodeCount() const { return (int)_nodes.size(); }
+
+	// override the geometric propagation delay / add attenuation for one link (both directions)
+	void setTimeOfFlight(int a, int b, int64_t ticks);
+	void setDistance(int a, int b, double meters);
+	void setLinkLoss(int a, int b, double extraLossDb);
+	int64_t timeOfFlight(int from, int to) const;
+	double  receivedPower(int from, int to) const;
+
+	DW1000SimChannelStats channelStats() const;
+
+	// put a frame (payload without FCS) on the air at atNs as if sent by node
+	// sender with its current TX settings, the sender's radio is not involved
+	// (frames closer together than its own transmitter could send them)
+	void injectFrame(int sender, const std::vector<uint8_t>& data, uint64_t atNs);
+
+	void    runFor(uint64_t ns);
+	void    runUntil(uint64_t ns);
+	int64_t nowTicks() const { return _now; }
+	uint64_t nowNs() const { return ticksToNs(_now); }
+
+	// node currently executing (inside a library callback), nullptr otherwise
+	static DW1000SimNode* current();
+
+	// observer for every frame put on the air
+	std::function<void(const DW1000SimFrame&)> onTransmit;
+
+	const DW1000SimConfig& config() const { return _config; }
+
+	static int64_t  nsToTicks(uint64_t ns) { return (int64_t)((ns*638976ULL)/10000ULL); }
+	static uint64_t ticksToNs(int64_t ticks) { return (uint64_t)(ticks*10000LL/638976LL); }
+	static int64_t  airtime(uint8_t dataRate, uint8_t prf, uint16_t preambleSymbols, uint16_t length, int64_t* preambleSfd = nullptr);
+
+	uint32_t random();
+
+private:
+	friend class DW1000SimNode;
+
+	enum EventKind { EVENT_LOOP, EVENT_ISR, EVENT_RADIO };
+
+	struct Event {
+		int64_t  t;
+		uint64_t seq;
+		int      kind;
+		int      node;
+		bool operator>(const Event& other) const { return t != other.t ? t > other.t : seq > other.seq; }
+	};
+
+	void schedule(int64_t t, int kind, int node);
+	void runSlice(DW1000SimNode& node, int64_t start, const std::function<void()>& body);
+	void transmit(DW1000SimNode& sender, const std::shared_ptr<DW1000SimFrame>& frame);
+	void step(const Event& event);
+
+	DW1000SimConfig _config;
+	std::string     _libraryPath;
+	std::vector<DW1000SimNode*> _nodes;
+	std::vector<std::vector<int64_t> > _tofOverride;
+	std::vector<std::vector<double> >  _extraLoss;
+	std::priority_queue<Event, std::vector<Event>, std::greater<Event> > _events;
+	int64_t  _now;
+	uint64_t _seq;
+	uint64_t _frameId;
+	uint64_t _airtimeNs;
+	uint64_t _rng;
+};
+
+#endif
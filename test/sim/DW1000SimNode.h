@@ -0,0 +1,100 @@
+/*
+ * Interface between the host simulator (DW1000Sim) and one simulated node.
+ *
+ * Every node is a private copy of the DW1000 library plus the Arduino shim,
+ * built as a shared object and loaded with dlopen() once per node, so that the
+ * library's static state (DW1000, DW1000Ranging, ...) exists once per device
+ * exactly as on real hardware. The simulator talks to a node only through the
+ * two tables below:
+ *  - DW1000SimHooks: hardware services the node calls into (time, pins, SPI).
+ *  - DW1000SimNodeApi: library entry points the simulator calls on the node.
+ *
+ * Devices of the library's device table are passed through as opaque
+ * DW1000SimDevice pointers and read back through the accessor entries, the
+ * host never links the library itself. A node library may be built with
+ * another DeviceState than DW1000Device (DW1000_SIM_DEVICE_STATE), the host
+ * does not see the difference.
+ */
+
+#ifndef _DW1000SimNode_H_INCLUDED
+#define _DW1000SimNode_H_INCLUDED
+
+#include <stdint.h>
+
+struct DW1000SimDevice;
+
+struct DW1000SimHooks {
+	void*    ctx;
+	// node local time in nanoseconds, advancing with consumed CPU/bus time
+	uint64_t (*nowNs)(void* ctx);
+	// busy-wait (delay(), delayMicroseconds()) or modelled CPU cost
+	void     (*consumeNs)(void* ctx, uint64_t ns);
+	void     (*digitalWrite)(void* ctx, uint8_t pin, uint8_t val);
+	int      (*analogRead)(void* ctx, uint8_t pin);
+	void     (*attachInterrupt)(void* ctx, uint8_t pin, void (*isr)(void));
+	void     (*spiBeginTransaction)(void* ctx, uint32_t clockHz);
+	uint8_t  (*spiTransfer)(void* ctx, uint8_t out);
+	// SPI.transfer(buf, count): one bulk transfer in place
+	void     (*spiTransferBytes)(void* ctx, uint8_t* buf, uint32_t count);
+	void     (*spiEndTransaction)(void* ctx);
+	// DMA: one complete write transaction (chip select included) which runs
+	// on the bus after the ones before, the CPU only pays for the setup
+	void     (*spiQueueWrite)(void* ctx, uint32_t clockHz, const uint8_t* out, uint32_t count);
+	// node local time in nanoseconds when the queued writes are through
+	uint64_t (*spiIdleNs)(void* ctx);
+	void     (*print)(void* ctx, const char* text, uint32_t len);
+};
+
+struct DW1000SimNodeApi {
+	void (*bind)(const DW1000SimHooks* hooks);
+
+	// DW1000RangingClass
+	void (*initCommunication)(uint8_t rst, uint8_t ss, uint8_t irq);
+	void (*startAsAnchor)(char address[], const uint8_t mode[], bool randomShortAddress);
+	void (*startAsTag)(char address[], const uint8_t mode[], bool randomShortAddress);
+	void (*loop)();
+	void (*useRangeFilter)(bool enabled);
+	void (*setReplyTime)(uint16_t replyDelayTimeUs);
+	void (*setResetPeriod)(uint32_t resetPeriod);
+	void (*setMessageBudget)(uint8_t budget);
+	// DW1000Class over a DMA transport (queued writes, see DW1000Transport.h)
+	void (*useDmaTransport)(bool enabled);
+	bool (*useDoubleBuffering)(bool enabled);
+	// RangingMode
+	bool (*setRangingMode)(uint8_t mode);
+	void (*useRangeReportInPollAck)(bool enabled);
+	void (*setCoordinator)(uint16_t slotMs);
+	void (*useSuperframe)(bool enabled);
+	void (*useAdaptiveReplyDelay)(bool enabled);
+	uint32_t (*getTurnaroundTime)();
+	uint32_t (*getCycleTime)();
+	uint8_t (*getMessageQueueMaxDepth)();
+	uint32_t (*getDroppedMessages)();
+	void (*resetMessageQueueStats)();
+	uint16_t (*getCurrentShortAddress)();
+	uint8_t (*getNetworkDevicesNumber)();
+	DW1000SimDevice* (*getNetworkDevice)(uint8_t index);
+	DW1000SimDevice* (*getDistantDevice)();
+
+	void (*attachNewRange)(void (*handler)(void));
+	void (*attachBlinkDevice)(void (*handler)(DW1000SimDevice*));
+	void (*attachNewDevice)(void (*handler)(DW1000SimDevice*));
+	void (*attachInactiveDevice)(void (*handler)(DW1000SimDevice*));
+	void (*attachRangeComplete)(void (*handler)(DW1000SimDevice*));
+	void (*attachProtocolError)(void (*handler)(DW1000SimDevice*, int));
+	void (*attachQueueLatency)(void (*handler)(uint32_t));
+
+	// device accessors
+	uint16_t (*deviceShortAddress)(DW1000SimDevice* device);
+	float (*deviceRange)(DW1000SimDevice* device);
+	float (*deviceRXPower)(DW1000SimDevice* device);
+	float (*deviceFPPower)(DW1000SimDevice* device);
+	float (*deviceQuality)(DW1000SimDevice* device);
+	int (*deviceProtocolState)(DW1000SimDevice* device);
+};
+
+#define DW1000_SIM_NODE_API_SYMBOL "dw1000SimNodeApi"
+
+typedef const DW1000SimNodeApi* (*DW1000SimNodeApiEntry)();
+
+#endif
@@ -0,0 +1,153 @@
+/*
+ * Node side of the simulator interface. Linked together with the library and
+ * the Arduino shim into the per-node shared object; the only exported symbol
+ * is the entry returning the API table.
+ *
+ * DW1000_SIM_CAPACITY and DW1000_SIM_DEVICE_STATE select the DW1000RangingT
+ * instantiation the node runs (default: DW1000RangingClass).
+ */
+
+#include "DW1000Ranging.h"
+#include "DW1000SimNode.h"
+
+#ifndef DW1000_SIM_CAPACITY
+#define DW1000_SIM_CAPACITY MAX_DEVICES
+#endif
+#ifndef DW1000_SIM_DEVICE_STATE
+#define DW1000_SIM_DEVICE_STATE DW1000Device
+#endif
+
+typedef DW1000RangingT<DW1000_SIM_CAPACITY, DW1000_SIM_DEVICE_STATE> Ranging;
+typedef Ranging::Device Device;
+
+static Ranging ranging;
+
+static DW1000SimDevice* toSim(Device* device) {
+	return reinterpret_cast<DW1000SimDevice*>(device);
+}
+
+static Device* fromSim(DW1000SimDevice* device) {
+	return reinterpret_cast<Device*>(device);
+}
+
+// host handlers take DW1000SimDevice*, the library calls these with Device*
+static void (*_blinkDevice)(DW1000SimDevice*);
+static void (*_newDevice)(DW1000SimDevice*);
+static void (*_inactiveDevice)(DW1000SimDevice*);
+static void (*_rangeComplete)(DW1000SimDevice*);
+static void (*_protocolError)(DW1000SimDevice*, int);
+
+static void onBlinkDevice(Device* device) { _blinkDevice(toSim(device)); }
+static void onNewDevice(Device* device) { _newDevice(toSim(device)); }
+static void onInactiveDevice(Device* device) { _inactiveDevice(toSim(device)); }
+static void onRangeComplete(Device* device) { _rangeComplete(toSim(device)); }
+static void onProtocolError(Device* device, int error) { _protocolError(toSim(device), error); }
+
+static void bind(const DW1000SimHooks* hooks) {
+	hostBindHooks(hooks);
+	// the ESP32's random() is a hardware generator, different on every node
+	randomSeed((unsigned long)analogRead(0)*2654435761UL);
+}
+
+// DW1000Esp32DmaTransport on the simulated bus: register accesses as the
+// default transport, writes queued to the bus in the background
+class SimDmaTransport : public DW1000SpiTransport {
+public:
+	void queueWrite(const SPISettings& settings, uint8_t ss, const byte header[], uint8_t headerLen,
+	                const byte data[], uint16_t n) override {
+		(void)ss;
+		byte buffer[3+LEN_EXT_UWB_FRAMES];
+		memcpy(buffer, header, headerLen);
+		memcpy(buffer+headerLen, data, n);
+		hostSpiQueueWrite(settings._clock, buffer, headerLen+n);
+	}
+	boolean busy() override {
+		return hostSpiIdleNs() > micros()*1000ULL;
+	}
+	void flush() override {
+		while(busy()) {
+			delayMicroseconds(1);
+		}
+	}
+};
+
+static SimDmaTransport dmaTransport;
+
+static const DW1000SimNodeApi _api = {
+	bind,
+
+	Ranging::initCommunication,
+	[](char address[], const uint8_t mode[], bool randomShortAddress) {
+		ranging.startAsAnchor(address, mode, randomShortAddress);
+	},
+	[](char address[], const uint8_t mode[], bool randomShortAddress) {
+		ranging.startAsTag(address, mode, randomShortAddress);
+	},
+	Ranging::loop,
+	[](bool enabled) { ranging.useRangeFilter(enabled); },
+	Ranging::setReplyTime,
+	Ranging::setResetPeriod,
+	Ranging::setMessageBudget,
+	[](bool enabled) { DW1000.setTransport(enabled ? &dmaTransport : nullptr); },
+	Ranging::useDoubleBuffering,
+	[](uint8_t mode) -> bool { return Ranging::setRangingMode((RangingMode)mode); },
+	Ranging::useRangeReportInPollAck,
+	Ranging::setCoordinator,
+	Ranging::useSuperframe,
+	Ranging::useAdaptiveReplyDelay,
+	Ranging::getTurnaroundTime,
+	Ranging::getCycleTime,
+	Ranging::getMessageQueueMaxDepth,
+	Ranging::getDroppedMessages,
+	Ranging::resetMessageQueueStats,
+	[]() -> uint16_t {
+		byte* shortAddress = ranging.getCurrentShortAddress();
+		return (uint16_t)shortAddress[0]*256+shortAddress[1];
+	},
+	[]() -> uint8_t { return ranging.getNetworkDevicesNumber(); },
+	[](uint8_t index) -> DW1000SimDevice* {
+		if(index >= ranging.getNetworkDevicesNumber()) {
+			return nullptr;
+		}
+		return toSim(ranging.getNetworkDevice(index));
+	},
+	[]() -> DW1000SimDevice* { return toSim(ranging.getDistantDevice()); },
+
+	Ranging::attachNewRange,
+	[](void (*handler)(DW1000SimDevice*)) {
+		_blinkDevice = handler;
+		ranging.attachBlinkDevice(handler ? onBlinkDevice : nullptr);
+	},
+	[](void (*handler)(DW1000SimDevice*)) {
+		_newDevice = handler;
+		ranging.attachNewDevice(handler ? onNewDevice : nullptr);
+	},
+	[](void (*handler)(DW1000SimDevice*)) {
+		_inactiveDevice = handler;
+		ranging.attachInactiveDevice(handler ? onInactiveDevice : nullptr);
+	},
+	[](void (*handler)(DW1000SimDevice*)) {
+		_rangeComplete = handler;
+		ranging.attachRangeComplete(handler ? onRangeComplete : nullptr);
+	},
+	[](void (*handler)(DW1000SimDevice*, int)) {
+		_protocolError = handler;
+		ranging.attachProtocolError(handler ? onProtocolError : nullptr);
+	},
+	Ranging::attachQueueLatency,
+
+	// same byte order as getCurrentShortAddress()
+	[](DW1000SimDevice* device) -> uint16_t {
+		byte* shortAddress = fromSim(device)->getByteShortAddress();
+		return (uint16_t)shortAddress[0]*256+shortAddress[1];
+	},
+	[](DW1000SimDevice* device) -> float { return fromSim(device)->getRange(); },
+	[](DW1000SimDevice* device) -> float { return fromSim(device)->getRXPower(); },
+	[](DW1000SimDevice* device) -> float { return fromSim(device)->getFPPower(); },
+	[](DW1000SimDevice* device) -> float { return fromSim(device)->getQuality(); },
+	[](DW1000SimDevice* device) -> int { return (int)fromSim(device)->getProtocolState(); },
+};
+
+extern "C" __attribute__((visibility("default"))) const DW1000SimNodeApi* dw1000SimNodeApi() {
+	return &_api;
+}